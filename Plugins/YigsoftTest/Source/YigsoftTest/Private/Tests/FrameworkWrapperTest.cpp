@@ -0,0 +1,107 @@
+// Automation tests of the framework wrapper, run with "Automation RunTests YigsoftTest"
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "UFrameworkWrapper.h"
+#include "Components/LineBatchComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+namespace FrameworkWrapperTest
+{
+    // Actor with a wrapper that has begun play, so it owns its line batch
+    static UFrameworkWrapper* SpawnWrapper(UWorld* World, bool bAsyncTick)
+    {
+        AActor* Actor = World->SpawnActor<AActor>();
+        UFrameworkWrapper* Wrapper = NewObject<UFrameworkWrapper>(Actor);
+        Wrapper->bAsyncTick = bAsyncTick;
+        Wrapper->RegisterComponent();
+        Actor->DispatchBeginPlay();
+        return Wrapper;
+    }
+
+    static const TArray<FBatchedLine>* GetLines(const UFrameworkWrapper* Wrapper)
+    {
+        const ULineBatchComponent* LineBatcher = Wrapper->GetOwner()->FindComponentByClass<ULineBatchComponent>();
+        return LineBatcher ? &LineBatcher->BatchedLines : nullptr;
+    }
+}
+
+// The async wrapper collects every tick one frame later, otherwise it has to end up exactly where the sync one is
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FFrameworkWrapperAsyncTickTest, "YigsoftTest.FrameworkWrapper.AsyncTick",
+    EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FFrameworkWrapperAsyncTickTest::RunTest(const FString& Parameters)
+{
+    using namespace FrameworkWrapperTest;
+
+    const float DeltaTime = 1.0f / 60.0f;
+    const int32 NumTicks = 4;
+
+    UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+    UFrameworkWrapper* Sync = SpawnWrapper(World, false);
+    UFrameworkWrapper* Async = SpawnWrapper(World, true);
+
+    TArray<FVector2D> SyncPositions;
+    TArray<FVector2D> AsyncPositions;
+
+    // Runs right away on both, nothing is in flight yet
+    Sync->AddFrameworkBody(0, 400.0f, 300.0f, 20.0f);
+    Async->AddFrameworkBody(0, 400.0f, 300.0f, 20.0f);
+
+    Sync->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+    Async->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+
+    // The first async tick is still running, nothing has been collected
+    Async->GetFrameworkBodyPositions(AsyncPositions);
+    TestEqual(TEXT("Bodies before the first collected tick"), AsyncPositions.Num(), 0);
+
+    // Queued while the async tick runs, executed before its next one
+    Sync->AddFrameworkBody(1, 600.0f, 300.0f, 20.0f);
+    Sync->HandleKeyInput('J');
+    Async->AddFrameworkBody(1, 600.0f, 300.0f, 20.0f);
+    Async->HandleKeyInput('J');
+
+    for (int32 Tick = 1; Tick < NumTicks; ++Tick)
+    {
+        Sync->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+        Async->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+    }
+
+    // Collects the last of the NumTicks async ticks (and starts one more)
+    Async->TickComponent(DeltaTime, LEVELTICK_All, nullptr);
+
+    Sync->GetFrameworkBodyPositions(SyncPositions);
+    Async->GetFrameworkBodyPositions(AsyncPositions);
+    TestTrue(TEXT("Queued body was added"), SyncPositions.Num() >= 2);
+    TestEqual(TEXT("Number of bodies"), AsyncPositions.Num(), SyncPositions.Num());
+    TestTrue(TEXT("Body positions"), AsyncPositions == SyncPositions);
+
+    const TArray<FBatchedLine>* SyncLines = GetLines(Sync);
+    const TArray<FBatchedLine>* AsyncLines = GetLines(Async);
+    if (TestNotNull(TEXT("Sync line batch"), SyncLines) && TestNotNull(TEXT("Async line batch"), AsyncLines))
+    {
+        TestTrue(TEXT("Collected frame has lines"), SyncLines->Num() > 0);
+        TestEqual(TEXT("Number of lines"), AsyncLines->Num(), SyncLines->Num());
+
+        bool bLinesMatch = (AsyncLines->Num() == SyncLines->Num());
+        for (int32 i = 0; bLinesMatch && i < SyncLines->Num(); ++i)
+        {
+            const FBatchedLine& A = (*AsyncLines)[i];
+            const FBatchedLine& B = (*SyncLines)[i];
+            bLinesMatch = (A.Start == B.Start && A.End == B.End && A.Color == B.Color && A.Thickness == B.Thickness);
+        }
+
+        TestTrue(TEXT("Lines of the collected frame"), bLinesMatch);
+    }
+
+    // EndPlay waits for the tick still in flight
+    Sync->GetOwner()->Destroy();
+    Async->GetOwner()->Destroy();
+    World->DestroyWorld(false);
+    return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -17,21 +17,21 @@
 #include "Engine/Canvas.h"
 #include "Engine/Font.h"
 #include "Engine/Engine.h" // Needed for GEngine
-#include "DrawDebugHelpers.h"
+#include "Components/LineBatchComponent.h"
 #include "Engine/World.h"
 #include "Kismet/GameplayStatics.h"
 #include "Internationalization/Text.h"
 // Added required math include for FVector, FLinearColor conversion
 #include "Math/Color.h" 
+#include "Misc/ScopeLock.h"
+#include "Stats/Stats.h"
 
 using namespace test;
 using namespace app;
 
-// If MAX_EDGES is not defined globally in a header, we define it here.
-#ifndef MAX_EDGES
-const int MAX_EDGES = 6;
-#endif 
-
+// Game thread part of the tick (the whole tick in the sync mode, the handoff in the async one) vs the simulation itself
+DECLARE_CYCLE_STAT(TEXT("Framework Tick (game thread)"), STAT_FrameworkGameThread, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Framework Simulation"), STAT_FrameworkSimulation, STATGROUP_Game);
 
 // --- Helper Functions for Color Conversion ---
 FColor ConvertExternalColor(unsigned int ExtColor)
@@ -59,11 +59,19 @@ UFrameworkWrapper::UFrameworkWrapper()
     PrimaryComponentTick.bCanEverTick = true;
     PrimaryComponentTick.TickGroup = TG_PrePhysics; // Ensure tick order if needed
     FrameworkApp = new test::App();
+    FramePool = new app::RenderFramePool();
+    LastFrame = nullptr;
+    PendingFrame = nullptr;
+    LineBatcher = nullptr;
+    bAsyncTick = false;
 }
 
 // --- NEW: EndPlay for Cleanup (CRUCIAL UNREAL LIFECYCLE) ---
 void UFrameworkWrapper::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
+    // The task still uses the app and the pending frame
+    WaitForTick();
+
     // Clean up external framework app
     if (FrameworkApp)
     {
@@ -71,6 +79,24 @@ void UFrameworkWrapper::EndPlay(const EEndPlayReason::Type EndPlayReason)
         FrameworkApp = nullptr;
     }
 
+    if (LineBatcher)
+    {
+        LineBatcher->DestroyComponent();
+        LineBatcher = nullptr;
+    }
+
+    // Return the last frame before the pool goes away
+    if (FramePool)
+    {
+        FramePool->Release(LastFrame);
+        LastFrame = nullptr;
+        FramePool->Release(PendingFrame);
+        PendingFrame = nullptr;
+
+        delete FramePool;
+        FramePool = nullptr;
+    }
+
     // Unset the static instance if it was this one
     if (Instance == this)
     {
@@ -90,6 +116,17 @@ void UFrameworkWrapper::BeginPlay()
     {
         // Init() call remains removed as it caused C2039.
     }
+
+    // Persistent line batch for the app's render frame, its line array is updated in place every tick
+    LineBatcher = NewObject<ULineBatchComponent>(GetOwner(), TEXT("FrameworkLineBatcher"));
+    if (LineBatcher)
+    {
+        LineBatcher->bCalculateAccurateBounds = false;
+        LineBatcher->RegisterComponent();
+
+        // Lifetime of the lines is managed here, no need to walk them every frame
+        LineBatcher->SetComponentTickEnabled(false);
+    }
 }
 
 // --- GetFrameworkWrapperInstance ---
@@ -101,19 +138,67 @@ UFrameworkWrapper* UFrameworkWrapper::GetFrameworkWrapperInstance()
 // --- AddFrameworkBody ---
 void UFrameworkWrapper::AddFrameworkBody(int ShapeType, float X, float Y, float R)
 {
-    if (FrameworkApp)
+    ExecuteCommand([ShapeType, X, Y, R](test::App& App)
     {
-        FrameworkApp->AddBody(ShapeType, X, Y, R);
-    }
+        App.AddBody(ShapeType, X, Y, R);
+    });
 }
 
 // --- HandleKeyInput ---
 void UFrameworkWrapper::HandleKeyInput(int32 KeyCode)
 {
-    if (FrameworkApp)
+    // Assuming testApp uses OnKeyPressed to handle external input
+    ExecuteCommand([KeyCode](test::App& App)
+    {
+        App.OnKeyPressed(KeyCode);
+    });
+}
+
+// --- GetFrameworkBodyPositions ---
+void UFrameworkWrapper::GetFrameworkBodyPositions(TArray<FVector2D>& OutPositions) const
+{
+    const int32 NumBodies = (int32)BodyX.size();
+    OutPositions.Reset(NumBodies);
+
+    for (int32 i = 0; i < NumBodies; ++i)
     {
-        // Assuming testApp uses OnKeyPressed to handle external input
-        FrameworkApp->OnKeyPressed(KeyCode);
+        OutPositions.Emplace(BodyX[i], BodyY[i]);
+    }
+}
+
+// --- ExecuteCommand ---
+void UFrameworkWrapper::ExecuteCommand(FFrameworkCommand&& Command)
+{
+    if (!FrameworkApp)
+    {
+        return;
+    }
+
+    // The app is busy on the task, the command runs before its next tick
+    if (PendingTick.IsValid())
+    {
+        FScopeLock Lock(&CommandLock);
+        QueuedCommands.Add(MoveTemp(Command));
+        return;
+    }
+
+    // Commands queued earlier go first to keep the order of the calls
+    RunQueuedCommands();
+    Command(*FrameworkApp);
+}
+
+// --- RunQueuedCommands ---
+void UFrameworkWrapper::RunQueuedCommands()
+{
+    TArray<FFrameworkCommand> Commands;
+    {
+        FScopeLock Lock(&CommandLock);
+        Commands = MoveTemp(QueuedCommands);
+    }
+
+    for (FFrameworkCommand& Command : Commands)
+    {
+        Command(*FrameworkApp);
     }
 }
 
@@ -122,59 +207,129 @@ void UFrameworkWrapper::TickComponent(float DeltaTime, ELevelTick TickType, FAct
 {
     Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
 
-    if (FrameworkApp)
+    if (!FrameworkApp || !FramePool)
     {
-        // Assuming OnTick handles the update/integration logic
-        FrameworkApp->OnTick(DeltaTime);
+        return;
+    }
 
-        // Run OnRender with a temporary frame to collect data
-        app::RenderFrame CurrentFrame;
-        FrameworkApp->OnRender(CurrentFrame);
+    SCOPE_CYCLE_COUNTER(STAT_FrameworkGameThread);
 
-        const std::vector<test::Body*>& Bodies = FrameworkApp->GetBodies();
+    // Results of the tick started in the previous frame, it has had the whole frame to finish
+    CollectTick();
 
-        const float DrawDuration = 0.0f;
-        const float LineThickness = 2.0f;
+    // Pooled frame, its vertex memory is reused every tick (at most the current and the pending one are out)
+    PendingFrame = FramePool->Acquire();
 
-        for (const test::Body* Body : Bodies)
+    if (bAsyncTick)
+    {
+        app::RenderFrame* Frame = PendingFrame;
+        PendingTick = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, Frame, DeltaTime]()
         {
-            if (!Body || !Body->m_shape || !GetWorld()) continue;
+            RunTick(DeltaTime, *Frame);
+        });
+    }
+    else
+    {
+        RunTick(DeltaTime, *PendingFrame);
+        CollectTick();
+    }
+}
+
+// --- RunTick ---
+void UFrameworkWrapper::RunTick(float DeltaTime, app::RenderFrame& Frame)
+{
+    SCOPE_CYCLE_COUNTER(STAT_FrameworkSimulation);
+
+    // Blueprint calls made since the last tick
+    RunQueuedCommands();
+
+    // Assuming OnTick handles the update/integration logic
+    FrameworkApp->OnTick(DeltaTime);
+    FrameworkApp->OnRender(Frame);
+
+    // Snapshot for the game thread, the app keeps moving the bodies during the next tick
+    if (!FrameworkApp->GetBodyPositions(PendingBodyX, PendingBodyY))
+    {
+        PendingBodyX.clear();
+        PendingBodyY.clear();
+    }
+
+    // Lines are built here too, collecting the tick only hands them over
+    BuildFrameLines(Frame, PendingLines);
+}
+
+// --- WaitForTick ---
+void UFrameworkWrapper::WaitForTick()
+{
+    if (PendingTick.IsValid())
+    {
+        PendingTick.Wait();
+        PendingTick = UE::Tasks::FTask();
+    }
+}
+
+// --- CollectTick ---
+void UFrameworkWrapper::CollectTick()
+{
+    WaitForTick();
 
-            unsigned int ExternalColorValue = Body->GetColor();
-            const FColor DrawColor = ConvertExternalColor(ExternalColorValue);
+    if (!PendingFrame)
+    {
+        return;
+    }
 
-            float BodyX = Body->GetX();
-            float BodyY = Body->GetY();
-            const test::IShape* Shape = Body->m_shape;
+    FramePool->Release(LastFrame);
+    LastFrame = PendingFrame;
+    PendingFrame = nullptr;
 
-            float ex[MAX_EDGES];
-            float ey[MAX_EDGES];
-            int numEdges = 0;
-            Shape->ComputeEdges(ex, ey, numEdges);
+    BodyX.swap(PendingBodyX);
+    BodyY.swap(PendingBodyY);
 
-            for (int i = 0; i < numEdges; ++i)
-            {
-                const float CurEdgeX = ex[i];
-                const float CurEdgeY = ey[i];
-                const float NextEdgeX = ex[(i + 1) % numEdges];
-                const float NextEdgeY = ey[(i + 1) % numEdges];
+    // Whole frame goes to the line batcher in one go, the previous lines keep their allocation for the next tick
+    if (LineBatcher)
+    {
+        Swap(LineBatcher->BatchedLines, PendingLines);
+        LineBatcher->MarkRenderStateDirty();
+    }
+}
+
+// --- AppendBatchedLines ---
+// Line list vertices to batched lines, the array grows once and the lines are constructed in place
+static void AppendBatchedLines(const app::RenderVertex* Vertices, int32 NumVertices, TArray<FBatchedLine>& Lines)
+{
+    const float LineThickness = 2.0f;
+    const float LineLifeTime = 0.0f; // kept until replaced by the next tick
+    const uint8 DepthPriority = 0;
 
-                // Note: Assuming a 2D simulation mapped to X/Y plane (Z=0)
-                FVector StartPoint(BodyX + CurEdgeX, BodyY + CurEdgeY, 0.0f);
-                FVector EndPoint(BodyX + NextEdgeX, BodyY + NextEdgeY, 0.0f);
+    const int32 FirstLine = Lines.AddUninitialized(NumVertices / 2);
+    FBatchedLine* Line = Lines.GetData() + FirstLine;
 
-                DrawDebugLine(
-                    GetWorld(),
-                    StartPoint,
-                    EndPoint,
-                    DrawColor,
-                    false,
-                    DrawDuration,
-                    0,
-                    LineThickness
-                );
-            }
-        }
+    // Note: Assuming a 2D simulation mapped to X/Y plane (Z=0)
+    for (int32 i = 0; i + 1 < NumVertices; i += 2, ++Line)
+    {
+        const FLinearColor DrawColor(ConvertExternalColor(Vertices[i].color));
+        new (Line) FBatchedLine(FVector(Vertices[i].x, Vertices[i].y, 0.0f), FVector(Vertices[i + 1].x, Vertices[i + 1].y, 0.0f), DrawColor, LineLifeTime, LineThickness, DepthPriority);
+    }
+}
+
+// --- BuildFrameLines ---
+void UFrameworkWrapper::BuildFrameLines(const app::RenderFrame& Frame, TArray<FBatchedLine>& OutLines)
+{
+    // All instances are expanded in one call, the vertex buffer keeps its capacity between ticks
+    const std::vector<app::RenderInstance>& Instances = Frame.GetInstances();
+    ExpandedVertices.resize(app::CountRenderInstanceVertices(Instances.data(), (int)Instances.size()));
+    const int NumExpanded = app::ExpandRenderInstances(Instances.data(), (int)Instances.size(), ExpandedVertices.data());
+
+    // Reset keeps the allocation, the array is refilled in place every tick
+    OutLines.Reset((NumExpanded + Frame.GetNumVertices()) / 2);
+
+    AppendBatchedLines(ExpandedVertices.data(), NumExpanded, OutLines);
+
+    for (int ChunkIndex = 0; ChunkIndex < Frame.GetNumUsedChunks(); ++ChunkIndex)
+    {
+        int NumVertices = 0;
+        const app::RenderVertex* Vertices = Frame.GetChunk(ChunkIndex, NumVertices);
+        AppendBatchedLines(Vertices, NumVertices, OutLines);
     }
 }
 
@@ -191,14 +346,18 @@ void UFrameworkWrapper::DrawUI(UCanvas* Canvas, APlayerController* PlayerControl
     // Get the required UFont object
     UFont* DefaultFont = GEngine->GetTinyFont();
 
-    // Resolves LNK2019 by accessing the framework instance's render frame
-    const app::RenderFrame& Frame = app::Framework::GetGlobalInstance().GetRenderFrame();
+    // Strings collected by the last tick
+    if (!LastFrame)
+    {
+        return;
+    }
+    const app::RenderFrame& Frame = *LastFrame;
 
     for (const app::RenderString& StringInfo : Frame.GetStrings())
     {
         // 1. Set up properties for FCanvasTextItem
         FLinearColor Color = ConvertExternalColorToFLinearColor(StringInfo.color);
-        FString TextString(StringInfo.text.c_str());
+        FString TextString(Frame.GetText(StringInfo));
 
         // 2. Create the FCanvasTextItem
         FCanvasTextItem TextItem(
@@ -4,8 +4,12 @@
 #include "app.h"
 #include "testShape.h"
 #include "testBody.h"
+#include "testNarrowphase.h"
+#include "testSnapshot.h"
 #include "physicsTestApp.h"
-#include "../external/framework/include/physicsTestApp.h"
+#include "profiler.h"
+
+#include <math.h>
 
 namespace test
 {
@@ -13,6 +17,13 @@ namespace test
 	const int KEY_1 = 49;
 	const int KEY_2 = 50;
 	const int KEY_3 = 51;
+	const int KEY_B = 'B';
+	const int KEY_J = 'J';
+	const int KEY_K = 'K';
+	const int KEY_L = 'L';
+
+	// Snapshot saved and loaded with K and L (working directory)
+	const char* const SNAPSHOT_PATH = "snapshot.bin";
 
 	// Define the radius for the new bodies (adjust as needed)
 	const float DEFAULT_RADIUS = 25.0f;
@@ -20,53 +31,193 @@ namespace test
 	const float SPAWN_X = 0.0f;
 	const float SPAWN_Y = 0.0f; // Correct spelling here
 
+	// Bodies per job system task
+	const int ATTRACTION_GRAIN_SIZE = 256;
+	const int INTEGRATE_GRAIN_SIZE = 2048;
+	const int SPAWN_GRAIN_SIZE = 2048;
+	const int COLLISION_GRAIN_SIZE = 256;
+
+	// Attraction directions gathered before the batched velocity update
+	const int ATTRACTION_BATCH_SIZE = 256;
+
+	namespace helper
+	{
+		/// body color of given shape type, 0 for unknown type
+		static inline unsigned int GetShapeColor(const int shapeType)
+		{
+			switch (shapeType)
+			{
+			case 0: return app::MakeColor(180, 64, 180);
+			case 1: return app::MakeColor(64, 180, 180);
+			case 2: return app::MakeColor(180, 180, 64);
+			}
+
+			return 0;
+		}
+	}
+
 	App::App()
 		: test::PhysicsTestApp("Your solution")
+		, m_inlineJobSystem(1)
+		, m_broadphase(Broadphase::Grid)
+		, m_collisionSolver(CollisionSolver::Sequential)
 	{
-		m_bodies.reserve(MaxBodies);
+		m_jobSystem = &m_inlineJobSystem;
+
+		m_bodies.Reserve(MaxBodies);
 	}
 
 	bool App::OnInit(const app::AppInitContext& initContext)
 	{
+		if (initContext.m_jobSystem)
+			m_jobSystem = initContext.m_jobSystem;
+
 		if (!PhysicsTestApp::OnInit(initContext))
 			return false;
 
 		return true;
 	}
 
-	// FIX 1: New helper function to delete all body objects and clear the list.
+	// FIX 1: New helper function to clear the list (body memory is kept for reuse).
 	void App::ClearAllBodies()
 	{
-		for (Body* body : m_bodies)
-		{
-			// The Body destructor is responsible for deleting its associated m_shape
-			delete body;
-		}
-		m_bodies.clear();
+		m_bodies.Truncate(0);
+		m_neighbourLists.Invalidate();
+
+		m_prevX.clear();
+		m_prevY.clear();
 	}
 
 
 	void App::OnTick(const float timeDelta)
 	{
+		PROFILE_ZONE("App::OnTick");
 
-		const int currentScenario = test::PhysicsTestApp::GetScenario();
+		StorePreviousPositions();
 
+		const int currentScenario = test::PhysicsTestApp::GetScenario();
 
-		test::PhysicsTestApp::SetNumBodies(GetNumBodies());
+		SpatialGrid* grid = nullptr;
+		if (m_broadphase == Broadphase::Grid)
+		{
+			PROFILE_ZONE("BuildGrid");
+			BuildGrid();
+			grid = &m_grid;
+		}
 
+		const bool useLists = (m_broadphase == Broadphase::NeighbourLists);
+		if (useLists)
+		{
+			PROFILE_ZONE("UpdateNeighbourLists");
+			UpdateNeighbourLists();
+		}
 
-		test::PhysicsTestApp::SetScenario(currentScenario);
+		const int numBodies = m_bodies.GetNumBodies();
+
+		// every worker counts into its own slot, merged after the tick
+		m_workerCounters.resize(m_jobSystem->GetNumWorkers());
+		for (auto& counters : m_workerCounters)
+			counters.Reset();
+
+		// attraction only writes the body's own velocity, bodies are independent
+		m_jobSystem->ParallelFor(0, numBodies, ATTRACTION_GRAIN_SIZE, [&](const int begin, const int end, const int workerIndex)
+			{
+				PROFILE_ZONE("Body::UpdateAttraction");
+				SimCounters counters;
+				float dirX[ATTRACTION_BATCH_SIZE];
+				float dirY[ATTRACTION_BATCH_SIZE];
+				for (int first = begin; first < end; first += ATTRACTION_BATCH_SIZE)
+				{
+					// the search reads only positions, so the velocities can be updated after the whole batch
+					const int count = (end - first < ATTRACTION_BATCH_SIZE) ? end - first : ATTRACTION_BATCH_SIZE;
+					for (int i = 0; i < count; ++i)
+					{
+						if (useLists)
+							Body(m_bodies, first + i, &counters).FindAttraction(m_neighbourLists, currentScenario, dirX[i], dirY[i]);
+						else
+							Body(m_bodies, first + i, &counters).FindAttraction(grid, currentScenario, dirX[i], dirY[i]);
+					}
+
+					Body::ApplyAttraction(m_bodies, first, count, dirX, dirY);
+				}
+
+				m_workerCounters[workerIndex].Add(counters);
+			});
+
+		SimCounters counters;
+		SolveCollisions(grid, counters);
+
+		m_jobSystem->ParallelFor(0, numBodies, INTEGRATE_GRAIN_SIZE, [&](const int begin, const int end, const int)
+			{
+				PROFILE_ZONE("Body::Integrate");
+				Body::Integrate(m_bodies, begin, end - begin, timeDelta);
+			});
+
+		for (const auto& workerCounters : m_workerCounters)
+			counters.Add(workerCounters);
+
+		counters.m_numBodies = numBodies;
+		SetCounters(counters);
+	}
 
+	void App::SolveCollisions(SpatialGrid* grid, SimCounters& counters)
+	{
+		if (m_collisionSolver == CollisionSolver::Jacobi)
+		{
+			SolveCollisionsJacobi(grid);
+			return;
+		}
 
+		PROFILE_ZONE("Body::UpdateCollision");
 
-		for (auto* body : m_bodies)
+		// collision corrections move the other body as well, keep it serial
+		const bool useLists = (m_broadphase == Broadphase::NeighbourLists);
+		const int numBodies = m_bodies.GetNumBodies();
+		for (int i = 0; i < numBodies; ++i)
 		{
-
-			body->Update(m_bodies, currentScenario);
+			if (useLists)
+				Body(m_bodies, i, &counters).UpdateCollision(m_neighbourLists, m_collisionScratch);
+			else
+				Body(m_bodies, i, &counters).UpdateCollision(grid, m_collisionScratch);
 		}
+	}
 
-		for (auto* body : m_bodies)
-			body->Integrate(timeDelta);
+	void App::SolveCollisionsJacobi(const SpatialGrid* grid)
+	{
+		const bool useLists = (m_broadphase == Broadphase::NeighbourLists);
+		const int numBodies = m_bodies.GetNumBodies();
+
+		m_correctionX.assign(numBodies, 0.0f);
+		m_correctionY.assign(numBodies, 0.0f);
+
+		// positions are only read, each body writes its own velocity and correction, the counters go to the worker slots
+		m_jobSystem->ParallelFor(0, numBodies, COLLISION_GRAIN_SIZE, [&](const int begin, const int end, const int workerIndex)
+			{
+				PROFILE_ZONE("Body::AccumulateCollision");
+				SimCounters counters;
+				std::vector< int >& scratch = m_jobSystem->GetScratch(workerIndex).GetArray< int >(); // collision candidates
+				for (int i = begin; i < end; ++i)
+				{
+					if (useLists)
+						Body(m_bodies, i, &counters).AccumulateCollision(m_neighbourLists, scratch, m_correctionX[i], m_correctionY[i]);
+					else
+						Body(m_bodies, i, &counters).AccumulateCollision(grid, scratch, m_correctionX[i], m_correctionY[i]);
+				}
+
+				m_workerCounters[workerIndex].Add(counters);
+			});
+
+		m_jobSystem->ParallelFor(0, numBodies, INTEGRATE_GRAIN_SIZE, [&](const int begin, const int end, const int)
+			{
+				PROFILE_ZONE("ApplyCorrections");
+				float* x = m_bodies.m_x.data();
+				float* y = m_bodies.m_y.data();
+				for (int i = begin; i < end; ++i)
+				{
+					x[i] += m_correctionX[i];
+					y[i] += m_correctionY[i];
+				}
+			});
 	}
 
 	void App::OnKeyPressed(const int keyCode)
@@ -92,6 +243,29 @@ namespace test
 			AddBody(shapeType, SPAWN_X, SPAWN_Y, DEFAULT_RADIUS);
 			break;
 		}
+		case KEY_B:
+		case 'b':
+		{
+			switch (m_broadphase)
+			{
+			case Broadphase::Grid: m_broadphase = Broadphase::NeighbourLists; break;
+			case Broadphase::NeighbourLists: m_broadphase = Broadphase::BruteForce; break;
+			default: m_broadphase = Broadphase::Grid; break;
+			}
+			break;
+		}
+		case KEY_J:
+		case 'j':
+			m_collisionSolver = (m_collisionSolver == CollisionSolver::Sequential) ? CollisionSolver::Jacobi : CollisionSolver::Sequential;
+			break;
+		case KEY_K:
+		case 'k':
+			SaveSnapshot(SNAPSHOT_PATH);
+			break;
+		case KEY_L:
+		case 'l':
+			LoadSnapshot(SNAPSHOT_PATH);
+			break;
 		// NOTE: If the base class uses SPACEBAR or ENTER to cycle scenarios, 
 		// you might need additional logic here to call ClearAllBodies() when those keys are pressed, 
 		// depending on how the base class handles body initialization.
@@ -100,11 +274,53 @@ namespace test
 
 	void App::OnRender(app::RenderFrame& frame) const
 	{
+		PROFILE_ZONE("App::OnRender");
+
 		// This base call handles rendering the debug overlay text (now updated in OnTick)
 		PhysicsTestApp::OnRender(frame);
 
-		for (auto* body : m_bodies)
-			body->Render(frame);
+		const char* broadphaseName = "brute force";
+		if (m_broadphase == Broadphase::Grid)
+			broadphaseName = "grid";
+		else if (m_broadphase == Broadphase::NeighbourLists)
+			broadphaseName = "neighbour lists";
+
+		frame.AddString(10, 130, app::MakeColor(200, 255, 200), "Broadphase: %s (B to change), collisions: %s (J to change)", broadphaseName,
+			(m_collisionSolver == CollisionSolver::Jacobi) ? "parallel Jacobi" : "sequential");
+
+		if (m_broadphase == Broadphase::NeighbourLists)
+		{
+			const NeighbourListStats stats = m_neighbourLists.GetStats();
+			frame.AddString(10, 150, app::MakeColor(200, 255, 200), "Lists: %d rebuilds in %d ticks, %d + %d entries, skin %.1f",
+				stats.m_numBuilds, stats.m_numUpdates, stats.m_numEntries, stats.m_numCollisionEntries, stats.m_skin);
+		}
+
+		// draw between the last two ticks, bodies that wrapped around or were just added are drawn as they are
+		const float alpha = frame.GetInterpolationAlpha();
+		const float maxStepX = 0.5f * (float)app::Resolution::WIDTH;
+		const float maxStepY = 0.5f * (float)app::Resolution::HEIGHT;
+
+		const BodyView bodies = m_bodies.GetView();
+		const int numPrev = (alpha < 1.0f) ? (int)m_prevX.size() : 0;
+		for (int i = 0; i < bodies.m_numBodies; ++i)
+		{
+			float x = bodies.m_x[i];
+			float y = bodies.m_y[i];
+			if (i < numPrev)
+			{
+				const float dx = x - m_prevX[i];
+				const float dy = y - m_prevY[i];
+				if (fabsf(dx) < maxStepX && fabsf(dy) < maxStepY)
+				{
+					x = m_prevX[i] + dx * alpha;
+					y = m_prevY[i] + dy * alpha;
+				}
+			}
+
+			const auto& geometry = bodies.m_geometry[bodies.m_shape[i]];
+			frame.SetColor(bodies.m_color[i]);
+			shape::Render(geometry.m_type, geometry.m_size, x, y, frame);
+		}
 
 		// you can have additional rendering here
 	}
@@ -113,57 +329,152 @@ namespace test
 
 	int App::GetNumBodies() const
 	{
-		return (int)m_bodies.size();
+		return m_bodies.GetNumBodies();
+	}
+
+	bool App::GetBodyPositions(std::vector< float >& outX, std::vector< float >& outY) const
+	{
+		// bodies are only ever removed from the end, the store keeps the spawn order
+		outX = m_bodies.m_x;
+		outY = m_bodies.m_y;
+		return true;
 	}
 
 	void App::AddBody(int shapeType, float x, float y, float r)
 	{
-		IShape* shape = nullptr;
-		unsigned int color = 0;
+		if (!shape::IsValidType(shapeType))
+			return;
+
+		// the shape geometry is interned in the store, the body only keeps a handle
+		app::Random& random = GetRandom();
+		const float velX = (float)((int)random.NextInt(200) - 100);
+		const float velY = (float)((int)random.NextInt(200) - 100);
+		m_bodies.Add(shapeType, r, helper::GetShapeColor(shapeType), x, y, velX, velY);
+		m_neighbourLists.Invalidate();
+	}
 
-		switch (shapeType)
-		{
-		case 0:
-		{
-			shape = new TriShape(r);
-			color = RGB(180, 64, 180);
-			break;
-		}
+	void App::SpawnBodies(const BodySpawn* spawns, int numSpawns)
+	{
+		if (numSpawns <= 0)
+			return;
+
+		// storage is reserved up front, the new bodies are filled in place
+		const int first = m_bodies.Grow(numSpawns);
+		m_neighbourLists.Invalidate();
 
-		case 1:
+		// shapes are interned serially (the cache is not thread safe), there are only few distinct ones
+		// invalid types are compacted away afterwards, they are rare (never for generated spawns)
+		int numInvalid = 0;
+		for (int i = 0; i < numSpawns; ++i)
 		{
-			shape = new QuadShape(r);
-			color = RGB(64, 180, 180);
-			break;
+			const TShapeHandle shape = m_bodies.m_shapes.Intern(spawns[i].m_shapeType, spawns[i].m_size);
+			m_bodies.m_shape[first + i] = shape;
+			numInvalid += (shape == INVALID_SHAPE) ? 1 : 0;
 		}
 
-		case 2:
+		if (numInvalid == 0)
 		{
-			shape = new HexShape(r);
-			color = RGB(180, 180, 64);
-			break;
-		}
+			const ShapeGeometry* geometry = m_bodies.m_shapes.GetGeometry();
+			m_jobSystem->ParallelFor(0, numSpawns, SPAWN_GRAIN_SIZE, [&](const int begin, const int end, const int)
+				{
+					for (int i = begin; i < end; ++i)
+					{
+						const BodySpawn& spawn = spawns[i];
+						const int index = first + i;
+						const ShapeGeometry& shape = geometry[m_bodies.m_shape[index]];
+
+						m_bodies.m_x[index] = spawn.m_x;
+						m_bodies.m_y[index] = spawn.m_y;
+						m_bodies.m_velX[index] = spawn.m_velX;
+						m_bodies.m_velY[index] = spawn.m_velY;
+						m_bodies.m_radius[index] = shape.m_radius;
+						m_bodies.m_color[index] = helper::GetShapeColor(shape.m_type);
+					}
+				});
+			return;
 		}
 
-		if (shape)
+		m_bodies.Truncate(first);
+		for (int i = 0; i < numSpawns; ++i)
 		{
-			// Pass the shapeType as the new shapeTypeID argument to the Body constructor
-			m_bodies.push_back(new Body(shape, color, x, y, shapeType));
+			const BodySpawn& spawn = spawns[i];
+			if (shape::IsValidType(spawn.m_shapeType))
+				m_bodies.Add(spawn.m_shapeType, spawn.m_size, helper::GetShapeColor(spawn.m_shapeType), spawn.m_x, spawn.m_y, spawn.m_velX, spawn.m_velY);
 		}
 	}
 
 	void App::RemoveBodies(int numObjects)
 	{
-		while (numObjects-- && !m_bodies.empty())
+		if (numObjects > 0)
 		{
-			delete m_bodies.back();
-			m_bodies.pop_back();
+			m_bodies.Truncate(m_bodies.GetNumBodies() - numObjects);
+			m_neighbourLists.Invalidate();
+
+			const int numBodies = m_bodies.GetNumBodies();
+			if ((int)m_prevX.size() > numBodies)
+			{
+				m_prevX.resize(numBodies);
+				m_prevY.resize(numBodies);
+			}
 		}
 	}
 
-	const std::vector< Body* >& App::GetBodies() const
+	void App::StorePreviousPositions()
+	{
+		m_prevX.assign(m_bodies.m_x.begin(), m_bodies.m_x.end());
+		m_prevY.assign(m_bodies.m_y.begin(), m_bodies.m_y.end());
+	}
+
+	void App::BuildGrid()
+	{
+		const float maxBound = m_bodies.GetMaxBound();
+
+		// collision candidates are gathered with a skin of one bound, a body that moves half of it while resolving
+		// gathers again (see Body::SolveCollision)
+		m_grid.Build(m_bodies.m_x.data(), m_bodies.m_y.data(), m_bodies.GetNumBodies(), Body::GetInteractionRange(maxBound, maxBound), maxBound);
+	}
+
+	void App::UpdateNeighbourLists()
+	{
+		const float maxBound = m_bodies.GetMaxBound();
+
+		// same margin for the collision candidates as the grid, the list skin comes on top of it
+		m_neighbourLists.Update(m_bodies.GetView(), Body::GetAttractionRange(), shape::GetOverlapReach(maxBound, maxBound), maxBound, *m_jobSystem);
+	}
+
+	bool App::SaveSnapshot(const char* path) const
+	{
+		SnapshotScene scene;
+		scene.m_scenario = GetScenario();
+		scene.m_seed = GetSeed();
+		scene.m_numSpawned = GetNumSpawned();
+		scene.m_randomCounter = GetRandomCounter();
+
+		return test::SaveSnapshot(path, m_bodies, scene);
+	}
+
+	bool App::LoadSnapshot(const char* path)
+	{
+		SnapshotScene scene;
+		if (!test::LoadSnapshot(path, m_bodies, scene))
+			return false;
+
+		RestoreSceneState(scene.m_scenario, scene.m_seed, scene.m_numSpawned, scene.m_randomCounter);
+		m_neighbourLists.Invalidate();
+
+		// keep the whole saved scene
+		if (GetNumBodies() > GetMaxBodies())
+			SetMaxBodies(GetNumBodies());
+
+		// nothing to interpolate from
+		m_prevX.clear();
+		m_prevY.clear();
+		return true;
+	}
+
+	BodyView App::GetBodies() const
 	{
-		return m_bodies;
+		return m_bodies.GetView();
 	}
 
 } // test
\ No newline at end of file
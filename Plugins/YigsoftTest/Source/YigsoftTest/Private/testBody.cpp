@@ -2,10 +2,16 @@
 
 #include "testBody.h"
 #include "testShape.h"
-#include "../external/framework/include/framework.h"
+#include "testGrid.h"
+#include "testNeighbourList.h"
+#include "testNarrowphase.h"
+#include "testKernels.h"
+#include "frameworkCore.h"
 
 #include <vector>
 #include <cmath>
+#include <climits>
+#include <algorithm>
 
 // Define the constants used throughout the physics system.
 // These definitions are required here to satisfy the linker (LNK2001).
@@ -17,175 +23,699 @@ const float test::AttractorRange = 150.0f;
 
 namespace test
 {
-
-	Body::Body(IShape* shape, const unsigned int color, float x, float y, int shapeTypeID) :
-		m_shape(shape),
-		m_color(color),
-		m_x(x),
-		m_y(y),
-		m_velX((float)(rand() % 200 - 100)),
-		m_velY((float)(rand() % 200 - 100)),
-		m_shapeTypeID(shapeTypeID)
+	namespace helper
 	{
+		/// distance filter of the collision candidates of one body, can the other body touch it before it moves by the margin
+		/// Uses the bounds of the shapes, not the radii, the vertices of a triangle reach further than its radius.
+		struct CandidateFilter
+		{
+			CandidateFilter(const BodyStore& store, const int index, const float margin)
+				: m_geometry(store.m_shapes.GetGeometry())
+				, m_shape(store.m_shape.data())
+				, m_bodyX(store.m_x.data())
+				, m_bodyY(store.m_y.data())
+				, m_x(store.m_x[index])
+				, m_y(store.m_y[index])
+				, m_bound(m_geometry[m_shape[index]].m_bound)
+				, m_margin(margin)
+			{}
+
+			inline bool IsCandidate(const int otherIndex) const
+			{
+				const float dx = m_bodyX[otherIndex] - m_x;
+				const float dy = m_bodyY[otherIndex] - m_y;
+				const float range = shape::GetOverlapReach(m_bound, m_geometry[m_shape[otherIndex]].m_bound) + m_margin;
+
+				return dx * dx + dy * dy < range * range;
+			}
+
+			const ShapeGeometry*	m_geometry;
+			const TShapeHandle*		m_shape;
+			const float*			m_bodyX;
+			const float*			m_bodyY;
+			const float				m_x;
+			const float				m_y;
+			const float				m_bound;
+			const float				m_margin;
+		};
 	}
 
-	Body::~Body()
+
+	void Body::UpdateAttraction(const SpatialGrid* grid, int currentScenario)
 	{
-		delete m_shape;
-		m_shape = nullptr;
+		float dirX = 0.0f;
+		float dirY = 0.0f;
+
+		if (FindAttraction(grid, currentScenario, dirX, dirY))
+			SolveAttraction(dirX, dirY);
 	}
 
-	void Body::Update(const std::vector< Body* >& otherBodies, int currentScenario)
+
+	void Body::UpdateAttraction(const NeighbourList& lists, int currentScenario)
 	{
 		float dirX = 0.0f;
 		float dirY = 0.0f;
 
-		if (FindAttractor(otherBodies, currentScenario, dirX, dirY))
-		{
+		if (FindAttraction(lists, currentScenario, dirX, dirY))
 			SolveAttraction(dirX, dirY);
-		}
+	}
 
-		SolveCollision(otherBodies);
 
+	bool Body::FindAttraction(const SpatialGrid* grid, int currentScenario, float& outDirX, float& outDirY) const
+	{
+		outDirX = 0.0f;
+		outDirY = 0.0f;
+
+		const bool hasAttractor = grid
+			? FindAttractor(*grid, currentScenario, outDirX, outDirY)
+			: FindAttractor(currentScenario, outDirX, outDirY);
+
+		if (hasAttractor && m_counters)
+			m_counters->m_numAttractorHits += 1;
+
+		return hasAttractor;
+	}
+
+
+	bool Body::FindAttraction(const NeighbourList& lists, int currentScenario, float& outDirX, float& outDirY) const
+	{
+		outDirX = 0.0f;
+		outDirY = 0.0f;
+
+		const bool hasAttractor = FindAttractor(lists, currentScenario, outDirX, outDirY);
+		if (hasAttractor && m_counters)
+			m_counters->m_numAttractorHits += 1;
+
+		return hasAttractor;
+	}
+
+
+	void Body::ApplyAttraction(BodyStore& store, int first, int count, const float* dirX, const float* dirY)
+	{
+		kernels::ApplyAttraction(store.m_velX.data() + first, store.m_velY.data() + first, dirX, dirY, count, test::Gravitation);
+	}
+
+
+	void Body::UpdateCollision(SpatialGrid* grid, std::vector< int >& scratch)
+	{
+		if (grid)
+			SolveCollision(*grid, scratch);
+		else
+			SolveCollision();
+	}
+
+
+	void Body::UpdateCollision(NeighbourList& lists, std::vector< int >& scratch)
+	{
+		SolveCollision(lists, scratch);
+	}
+
+
+	void Body::AccumulateCollision(const SpatialGrid* grid, std::vector< int >& scratch, float& outCorrectionX, float& outCorrectionY)
+	{
+		if (grid)
+			GatherCandidates(*grid, 0, scratch);
+		else
+			GatherAllCandidates(scratch);
+
+		AccumulateCandidates(scratch, outCorrectionX, outCorrectionY);
+	}
+
+
+	void Body::AccumulateCollision(const NeighbourList& lists, std::vector< int >& scratch, float& outCorrectionX, float& outCorrectionY)
+	{
+		GatherCandidates(lists, 0, scratch);
+		AccumulateCandidates(scratch, outCorrectionX, outCorrectionY);
 	}
 
 
 	void Body::Integrate(float deltaTime)
 	{
-		const float length = sqrtf(m_velY * m_velY + m_velX * m_velX);
+		Integrate(m_store, m_index, 1, deltaTime);
+	}
 
-		if (length > 0.0f)
-		{
-			m_velX /= length;
-			m_velY /= length;
-		}
 
-		m_x += m_velX * deltaTime * test::BodySpeed;
-		m_y += m_velY * deltaTime * test::BodySpeed;
+	void Body::Integrate(BodyStore& store, int first, int count, float deltaTime)
+	{
+		IntegrateParams params;
+		params.m_deltaTime = deltaTime;
+		params.m_speed = test::BodySpeed;
+		params.m_width = (float)app::Resolution::WIDTH;
+		params.m_height = (float)app::Resolution::HEIGHT;
+
+		kernels::Integrate(store.m_x.data() + first, store.m_y.data() + first, store.m_velX.data() + first, store.m_velY.data() + first, count, params);
+	}
+
 
-		WrapAround();
+	float Body::GetInteractionRange(float maxBound, float skin)
+	{
+		// two shapes can only overlap if their bounding circles do
+		const float collisionRange = shape::GetOverlapReach(maxBound, maxBound) + 2.0f * skin;
+		return (test::AttractorRange > collisionRange) ? test::AttractorRange : collisionRange;
 	}
 
 
-	void Body::Render(app::RenderFrame& frame)
+	float Body::GetAttractionRange()
 	{
-		frame.SetColor(m_color);
-		m_shape->Render(m_x, m_y, frame);
+		return test::AttractorRange;
 	}
 
 
-	bool Body::FindAttractor(const std::vector< Body* >& otherBodies, int currentScenario, float& outDirX, float& outDirY) const
+	bool Body::IsAttractor(int otherIndex, bool requiresSameShapeAttraction, float& outDx, float& outDy) const
+	{
+		if (otherIndex == m_index)
+			return false;
+
+		// If same-shape attraction is required (Scenario 1 or 2) AND the shapes are different, skip this body.
+		if (requiresSameShapeAttraction && (GetShapeTypeID() != m_store.m_shapes.Get(m_store.m_shape[otherIndex]).m_type))
+			return false;
+
+		outDx = m_store.m_x[otherIndex] - m_store.m_x[m_index];
+		outDy = m_store.m_y[otherIndex] - m_store.m_y[m_index];
+		const float distSq = outDx * outDx + outDy * outDy;
+
+		return distSq < test::AttractorRange * test::AttractorRange;
+	}
+
+
+	bool Body::FindAttractor(int currentScenario, float& outDirX, float& outDirY) const
 	{
 		// Scenarios 1 and 2 require "same shape only" attraction.
 		bool requiresSameShapeAttraction = (currentScenario == 1 || currentScenario == 2);
 
-		for (auto* otherBody : otherBodies)
+		const int numBodies = m_store.GetNumBodies();
+		for (int otherIndex = 0; otherIndex < numBodies; ++otherIndex)
 		{
-			if (otherBody == this)
-				continue;
+			float dx = 0.0f;
+			float dy = 0.0f;
 
-			// If same-shape attraction is required (Scenario 1 or 2) AND the shapes are different, skip this body.
-			if (requiresSameShapeAttraction && (GetShapeTypeID() != otherBody->GetShapeTypeID()))
+			if (IsAttractor(otherIndex, requiresSameShapeAttraction, dx, dy))
 			{
-				continue;
+				if (m_counters)
+					m_counters->m_numPairs += otherIndex + 1;
+
+				float dist = sqrtf(dx * dx + dy * dy);
+				outDirX = dx / dist;
+				outDirY = dy / dist;
+				return true;
 			}
+		}
+
+		if (m_counters)
+			m_counters->m_numPairs += numBodies;
+
+		return false;
+	}
+
+
+	bool Body::FindAttractor(const SpatialGrid& grid, int currentScenario, float& outDirX, float& outDirY) const
+	{
+		bool requiresSameShapeAttraction = (currentScenario == 1 || currentScenario == 2);
+
+		// the brute-force loop picks the first attractor in body order, so pick the lowest index here as well
+		int bestIndex = INT_MAX;
+		float bestDx = 0.0f;
+		float bestDy = 0.0f;
+		int numVisited = 0;
+
+		grid.ForEachNeighbourCell(m_store.m_x[m_index], m_store.m_y[m_index], [&](const int* indices, const int count)
+			{
+				for (int i = 0; i < count && indices[i] < bestIndex; ++i)
+				{
+					float dx = 0.0f;
+					float dy = 0.0f;
+
+					++numVisited;
+					if (IsAttractor(indices[i], requiresSameShapeAttraction, dx, dy))
+					{
+						bestIndex = indices[i];
+						bestDx = dx;
+						bestDy = dy;
+						break; // cells are sorted, nothing better in this one
+					}
+				}
+			});
+
+		if (m_counters)
+			m_counters->m_numPairs += numVisited;
+
+		if (bestIndex == INT_MAX)
+			return false;
+
+		float dist = sqrtf(bestDx * bestDx + bestDy * bestDy);
+		outDirX = bestDx / dist;
+		outDirY = bestDy / dist;
+		return true;
+	}
 
 
-			float dx = otherBody->m_x - m_x;
-			float dy = otherBody->m_y - m_y;
-			float distSq = dx * dx + dy * dy;
+	bool Body::FindAttractor(const NeighbourList& lists, int currentScenario, float& outDirX, float& outDirY) const
+	{
+		bool requiresSameShapeAttraction = (currentScenario == 1 || currentScenario == 2);
+
+		// lists are sorted, the first attractor is the one the brute-force loop finds
+		int count = 0;
+		const int* indices = lists.GetNeighbours(m_index, count);
+		for (int i = 0; i < count; ++i)
+		{
+			float dx = 0.0f;
+			float dy = 0.0f;
 
-			if (distSq < test::AttractorRange * test::AttractorRange)
+			if (IsAttractor(indices[i], requiresSameShapeAttraction, dx, dy))
 			{
-				float dist = sqrtf(distSq);
+				if (m_counters)
+					m_counters->m_numPairs += i + 1;
+
+				float dist = sqrtf(dx * dx + dy * dy);
 				outDirX = dx / dist;
 				outDirY = dy / dist;
 				return true;
 			}
 		}
 
+		if (m_counters)
+			m_counters->m_numPairs += count;
+
 		return false;
 	}
 
 
 	void Body::SolveAttraction(float dirX, float dirY)
 	{
-		m_velX += dirX * test::Gravitation;
-		m_velY += dirY * test::Gravitation;
+		m_store.m_velX[m_index] += dirX * test::Gravitation;
+		m_store.m_velY[m_index] += dirY * test::Gravitation;
 	}
 
 
-	void Body::SolveCollision(const std::vector< Body* >& otherBodies)
+	void Body::SolveCollision()
 	{
+		const int numBodies = m_store.GetNumBodies();
+		if (m_counters && numBodies > 0)
+		{
+			m_counters->m_numPairs += numBodies - 1;
+			m_counters->AddNeighbours(numBodies - 1);
+		}
 
-		// Increased from 0.2f to 0.4f to forcefully push apart bodies under high attraction force.
-		const float CorrectionBias = 0.4f;
+		for (int otherIndex = 0; otherIndex < numBodies; ++otherIndex)
+		{
+			if (otherIndex == m_index)
+				continue;
+
+			ResolveCollision(otherIndex);
+		}
+	}
 
 
-		const float RepulsionFactor = 0.1f;
+	void Body::SolveCollision(SpatialGrid& grid, std::vector< int >& scratch)
+	{
+		int firstIndex = 0;
+		for (;;)
+		{
+			GatherCandidates(grid, firstIndex, scratch);
+
+			// resolve in the body order, the corrections are applied in place so the order matters
+			const int numResolved = ResolveCandidates(scratch, grid.GetSkin());
+
+			// only this body and the resolved candidates could move
+			grid.UpdateBody(m_index, m_store.m_x[m_index], m_store.m_y[m_index]);
+			for (int i = 0; i < numResolved; ++i)
+				grid.UpdateBody(scratch[i], m_store.m_x[scratch[i]], m_store.m_y[scratch[i]]);
+
+			if (numResolved == (int)scratch.size())
+				break;
 
-		for (auto* otherBody : otherBodies)
+			// moved too far for the candidates, the rest is gathered again around the new position
+			firstIndex = scratch[numResolved - 1] + 1;
+		}
+	}
+
+
+	void Body::SolveCollision(NeighbourList& lists, std::vector< int >& scratch)
+	{
+		int firstIndex = 0;
+		for (;;)
 		{
-			if (otherBody == this)
-				continue;
+			GatherCandidates(lists, firstIndex, scratch);
+			const int numResolved = ResolveCandidates(scratch, lists.GetMargin());
+
+			lists.UpdateBody(m_index, m_store.m_x[m_index], m_store.m_y[m_index]);
+			for (int i = 0; i < numResolved; ++i)
+				lists.UpdateBody(scratch[i], m_store.m_x[scratch[i]], m_store.m_y[scratch[i]]);
 
-			if (IShape::TestOverlap(m_shape, m_x, m_y, otherBody->m_shape, otherBody->m_x, otherBody->m_y))
+			if (numResolved == (int)scratch.size())
+				break;
+
+			firstIndex = scratch[numResolved - 1] + 1;
+		}
+	}
+
+
+	void Body::GatherCandidates(const SpatialGrid& grid, int firstIndex, std::vector< int >& outCandidates) const
+	{
+		// gather everything that can possibly touch us, the skin covers our moves while resolving
+		const helper::CandidateFilter filter(m_store, m_index, grid.GetSkin());
+		int numVisited = 0;
+
+		outCandidates.clear();
+		grid.ForEachNeighbourCell(m_store.m_x[m_index], m_store.m_y[m_index], [&](const int* indices, const int count)
 			{
-				float dx = otherBody->m_x - m_x;
-				float dy = otherBody->m_y - m_y;
+				for (int i = 0; i < count; ++i)
+				{
+					const int otherIndex = indices[i];
+					if (otherIndex < firstIndex || otherIndex == m_index)
+						continue;
 
-				float distSq = dx * dx + dy * dy;
+					++numVisited;
+					if (filter.IsCandidate(otherIndex))
+						outCandidates.push_back(otherIndex);
+				}
+			});
 
-				if (distSq == 0.0f) continue;
+		std::sort(outCandidates.begin(), outCandidates.end());
 
-				float dist = sqrtf(distSq);
+		// bodies that left their cell can come from the cells as well
+		if (grid.HasEscaped())
+			outCandidates.erase(std::unique(outCandidates.begin(), outCandidates.end()), outCandidates.end());
 
+		if (m_counters)
+		{
+			m_counters->m_numPairs += numVisited;
+			m_counters->AddNeighbours((int)outCandidates.size());
+		}
+	}
 
-				float nx = dx / dist;
-				float ny = dy / dist;
 
-				float sumRadii = GetRadius() + otherBody->GetRadius();
-				float penetration = sumRadii - dist;
+	void Body::GatherCandidates(const NeighbourList& lists, int firstIndex, std::vector< int >& outCandidates) const
+	{
+		// same candidates as the grid query, the list only replaces the cell walk
+		const helper::CandidateFilter filter(m_store, m_index, lists.GetMargin());
+		int numVisited = 0;
 
-				if (penetration > 0.0f)
+		outCandidates.clear();
+		if (lists.IsEscaped(m_index))
+		{
+			// our list does not cover where we got, anything can be close
+			const int numBodies = m_store.GetNumBodies();
+			for (int otherIndex = firstIndex; otherIndex < numBodies; ++otherIndex)
+			{
+				if (otherIndex != m_index && filter.IsCandidate(otherIndex))
+					outCandidates.push_back(otherIndex);
+			}
+
+			numVisited = numBodies - firstIndex;
+		}
+		else
+		{
+			// already in the body order
+			int count = 0;
+			const int* indices = lists.GetCollisionNeighbours(m_index, count);
+			for (int i = (int)(std::lower_bound(indices, indices + count, firstIndex) - indices); i < count; ++i)
+			{
+				++numVisited;
+				if (filter.IsCandidate(indices[i]))
+					outCandidates.push_back(indices[i]);
+			}
+
+			// the escaped bodies may be missing in the list
+			int numEscaped = 0;
+			const int* escaped = lists.GetEscaped(numEscaped);
+			if (numEscaped)
+			{
+				const size_t numListed = outCandidates.size();
+				for (int i = (int)(std::lower_bound(escaped, escaped + numEscaped, firstIndex) - escaped); i < numEscaped; ++i)
 				{
+					++numVisited;
+					if (escaped[i] != m_index && filter.IsCandidate(escaped[i]))
+						outCandidates.push_back(escaped[i]);
+				}
 
-					float correctionMagnitude = penetration * CorrectionBias;
+				std::inplace_merge(outCandidates.begin(), outCandidates.begin() + numListed, outCandidates.end());
+				outCandidates.erase(std::unique(outCandidates.begin(), outCandidates.end()), outCandidates.end());
+			}
+		}
 
-					// Fixed declaration for correctionY to be float
-					float correctionX = correctionMagnitude * nx * 0.5f;
-					float correctionY = correctionMagnitude * ny * 0.5f;
+		if (m_counters)
+		{
+			m_counters->m_numPairs += numVisited;
+			m_counters->AddNeighbours((int)outCandidates.size());
+		}
+	}
 
-					m_x -= correctionX;
-					m_y -= correctionY;
 
-					otherBody->m_x += correctionX;
-					otherBody->m_y += correctionY;
+	void Body::GatherAllCandidates(std::vector< int >& outCandidates) const
+	{
+		const int numBodies = m_store.GetNumBodies();
+
+		outCandidates.clear();
+		for (int otherIndex = 0; otherIndex < numBodies; ++otherIndex)
+		{
+			if (otherIndex != m_index)
+				outCandidates.push_back(otherIndex);
+		}
+
+		if (m_counters)
+		{
+			m_counters->m_numPairs += (int)outCandidates.size();
+			m_counters->AddNeighbours((int)outCandidates.size());
+		}
+	}
+
+
+	int Body::ResolveCandidates(const std::vector< int >& candidates, float margin)
+	{
+		// overlaps are tested one SIMD batch at a time, once a correction moves us the rest of the batch is stale
+		// and gets tested again, so a wider batch would mostly waste work in the crowded areas
+		const int MAX_BATCH = 16;
+		const int batchSize = std::min(shape::GetOverlapBatchWidth(), MAX_BATCH);
+		OverlapPair pairs[MAX_BATCH];
+		bool overlaps[MAX_BATCH];
+
+		ShapeArrays shapes;
+		shapes.m_shape = m_store.m_shape.data();
+		shapes.m_geometry = m_store.m_shapes.GetGeometry();
+		shapes.m_x = m_store.m_x.data();
+		shapes.m_y = m_store.m_y.data();
+
+		// the candidates were gathered with the margin, they are complete while we stay within half of it
+		// (the other half is room for rounding)
+		const float startX = m_store.m_x[m_index];
+		const float startY = m_store.m_y[m_index];
+		const float maxMove = 0.5f * margin;
+		bool movedAway = false;
+
+		const int numCandidates = (int)candidates.size();
+		int first = 0;
+		while (first < numCandidates && !movedAway)
+		{
+			const int count = std::min(numCandidates - first, batchSize);
+			for (int i = 0; i < count; ++i)
+			{
+				pairs[i].m_a = m_index;
+				pairs[i].m_b = candidates[first + i];
+			}
+
+			shape::TestOverlapBatch(shapes, pairs, count, overlaps);
+
+			int next = first + count;
+			int numOverlaps = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				if (!overlaps[i])
+					continue;
+
+				++numOverlaps;
+				if (ApplyCollision(pairs[i].m_b))
+				{
+					const float movedX = m_store.m_x[m_index] - startX;
+					const float movedY = m_store.m_y[m_index] - startY;
+					movedAway = (movedX * movedX + movedY * movedY >= maxMove * maxMove);
+
+					next = first + i + 1;
+					break;
 				}
+			}
+
+			if (m_counters)
+			{
+				m_counters->m_numOverlapTests += count;
+				m_counters->m_numOverlaps += numOverlaps;
+			}
+
+			first = next;
+		}
+
+		return first;
+	}
 
 
-				m_velX -= dx * RepulsionFactor;
-				m_velY -= dy * RepulsionFactor;
+	void Body::AccumulateCandidates(const std::vector< int >& candidates, float& outCorrectionX, float& outCorrectionY)
+	{
+		// nothing moves during the pass, so unlike ResolveCandidates every candidate is tested exactly once
+		const int MAX_BATCH = 16;
+		const int batchSize = std::min(shape::GetOverlapBatchWidth(), MAX_BATCH);
+		OverlapPair pairs[MAX_BATCH];
+		bool overlaps[MAX_BATCH];
+
+		ShapeArrays shapes;
+		shapes.m_shape = m_store.m_shape.data();
+		shapes.m_geometry = m_store.m_shapes.GetGeometry();
+		shapes.m_x = m_store.m_x.data();
+		shapes.m_y = m_store.m_y.data();
+
+		// summed in the candidate order, the same for any number of threads
+		float correctionX = 0.0f;
+		float correctionY = 0.0f;
+		float repulsionX = 0.0f;
+		float repulsionY = 0.0f;
+		int numOverlaps = 0;
+		int numCorrections = 0;
+
+		const int numCandidates = (int)candidates.size();
+		for (int first = 0; first < numCandidates; first += batchSize)
+		{
+			const int count = std::min(numCandidates - first, batchSize);
+			for (int i = 0; i < count; ++i)
+			{
+				pairs[i].m_a = m_index;
+				pairs[i].m_b = candidates[first + i];
+			}
+
+			shape::TestOverlapBatch(shapes, pairs, count, overlaps);
+
+			for (int i = 0; i < count; ++i)
+			{
+				if (!overlaps[i])
+					continue;
+
+				float pushX = 0.0f;
+				float pushY = 0.0f;
+				float pullX = 0.0f;
+				float pullY = 0.0f;
+				if (ComputeCollision(pairs[i].m_b, pushX, pushY, pullX, pullY))
+				{
+					// the sequential loop resolves every pair from both bodies, the other body's visit pushes us by the same
+					// amount from the start positions, so take both halves here
+					correctionX -= 2.0f * pushX;
+					correctionY -= 2.0f * pushY;
+					++numCorrections;
+				}
+
+				repulsionX += pullX;
+				repulsionY += pullY;
+				++numOverlaps;
 			}
 		}
+
+		m_store.m_velX[m_index] -= repulsionX;
+		m_store.m_velY[m_index] -= repulsionY;
+
+		outCorrectionX += correctionX;
+		outCorrectionY += correctionY;
+
+		if (m_counters)
+		{
+			m_counters->m_numOverlapTests += numCandidates;
+			m_counters->m_numOverlaps += numOverlaps;
+			m_counters->m_numCorrections += numCorrections;
+		}
+	}
+
+
+	void Body::ResolveCollision(int otherIndex)
+	{
+		const auto& shapeA = m_store.m_shapes.Get(m_store.m_shape[m_index]);
+		const auto& shapeB = m_store.m_shapes.Get(m_store.m_shape[otherIndex]);
+
+		const bool overlap = shape::TestOverlap(shapeA.m_type, shapeA.m_size, m_store.m_x[m_index], m_store.m_y[m_index],
+			shapeB.m_type, shapeB.m_size, m_store.m_x[otherIndex], m_store.m_y[otherIndex]);
+
+		if (m_counters)
+		{
+			m_counters->m_numOverlapTests += 1;
+			m_counters->m_numOverlaps += overlap ? 1 : 0;
+		}
+
+		if (overlap)
+		{
+			ApplyCollision(otherIndex);
+		}
 	}
 
 
-	void Body::WrapAround()
+	bool Body::ApplyCollision(int otherIndex)
 	{
-		if (m_x > (float)app::Resolution::WIDTH)
-			m_x -= (float)app::Resolution::WIDTH;
-		else if (m_x < 0.0f)
-			m_x += (float)app::Resolution::WIDTH;
+		float correctionX = 0.0f;
+		float correctionY = 0.0f;
+		float repulsionX = 0.0f;
+		float repulsionY = 0.0f;
+		const bool penetrates = ComputeCollision(otherIndex, correctionX, correctionY, repulsionX, repulsionY);
+
+		if (penetrates)
+		{
+			m_store.m_x[m_index] -= correctionX;
+			m_store.m_y[m_index] -= correctionY;
 
-		if (m_y > (float)app::Resolution::HEIGHT)
-			m_y -= (float)app::Resolution::HEIGHT;
-		else if (m_y < 0.0f)
-			m_y += (float)app::Resolution::HEIGHT;
+			m_store.m_x[otherIndex] += correctionX;
+			m_store.m_y[otherIndex] += correctionY;
+
+			if (m_counters)
+				m_counters->m_numCorrections += 1;
+		}
+
+		m_store.m_velX[m_index] -= repulsionX;
+		m_store.m_velY[m_index] -= repulsionY;
+
+		return penetrates;
 	}
 
-	float Body::GetRadius() const
+
+	bool Body::ComputeCollision(int otherIndex, float& outCorrectionX, float& outCorrectionY, float& outRepulsionX, float& outRepulsionY) const
 	{
-		return m_shape ? m_shape->GetRadius() : 0.0f;
+
+		// Increased from 0.2f to 0.4f to forcefully push apart bodies under high attraction force.
+		const float CorrectionBias = 0.4f;
+
+
+		const float RepulsionFactor = 0.1f;
+
+		const float x = m_store.m_x[m_index];
+		const float y = m_store.m_y[m_index];
+
+		float dx = m_store.m_x[otherIndex] - x;
+		float dy = m_store.m_y[otherIndex] - y;
+
+		outCorrectionX = 0.0f;
+		outCorrectionY = 0.0f;
+		outRepulsionX = 0.0f;
+		outRepulsionY = 0.0f;
+
+		float distSq = dx * dx + dy * dy;
+
+		if (distSq == 0.0f) return false;
+
+		float dist = sqrtf(distSq);
+
+
+		float nx = dx / dist;
+		float ny = dy / dist;
+
+		float sumRadii = m_store.m_radius[m_index] + m_store.m_radius[otherIndex];
+		float penetration = sumRadii - dist;
+
+		if (penetration > 0.0f)
+		{
+
+			float correctionMagnitude = penetration * CorrectionBias;
+
+			// Fixed declaration for correctionY to be float
+			outCorrectionX = correctionMagnitude * nx * 0.5f;
+			outCorrectionY = correctionMagnitude * ny * 0.5f;
+		}
+
+
+		outRepulsionX = dx * RepulsionFactor;
+		outRepulsionY = dy * RepulsionFactor;
+
+		return penetration > 0.0f;
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,104 @@
+#include "testBodyStore.h"
+
+namespace test
+{
+
+	BodyStore::BodyStore()
+	{
+	}
+
+	void BodyStore::Reserve(const int numBodies)
+	{
+		m_x.reserve(numBodies);
+		m_y.reserve(numBodies);
+		m_velX.reserve(numBodies);
+		m_velY.reserve(numBodies);
+		m_radius.reserve(numBodies);
+		m_shape.reserve(numBodies);
+		m_color.reserve(numBodies);
+	}
+
+	int BodyStore::Add(const int shapeType, const float size, const unsigned int color, const float x, const float y, const float velX, const float velY)
+	{
+		const TShapeHandle shape = m_shapes.Intern(shapeType, size);
+		if (shape == INVALID_SHAPE)
+			return -1;
+
+		const int index = GetNumBodies();
+
+		m_x.push_back(x);
+		m_y.push_back(y);
+		m_velX.push_back(velX);
+		m_velY.push_back(velY);
+		m_radius.push_back(m_shapes.Get(shape).m_radius);
+		m_shape.push_back(shape);
+		m_color.push_back(color);
+
+		return index;
+	}
+
+	int BodyStore::Grow(const int numBodies)
+	{
+		const int index = GetNumBodies();
+		const size_t count = (size_t)index + (size_t)numBodies;
+
+		m_x.resize(count);
+		m_y.resize(count);
+		m_velX.resize(count);
+		m_velY.resize(count);
+		m_radius.resize(count);
+		m_shape.resize(count);
+		m_color.resize(count);
+
+		return index;
+	}
+
+	void BodyStore::Truncate(const int numBodies)
+	{
+		if (numBodies >= GetNumBodies())
+			return;
+
+		const size_t count = (numBodies > 0) ? (size_t)numBodies : 0;
+
+		m_x.resize(count);
+		m_y.resize(count);
+		m_velX.resize(count);
+		m_velY.resize(count);
+		m_radius.resize(count);
+		m_shape.resize(count);
+		m_color.resize(count);
+
+		if (count == 0)
+			m_shapes.Clear();
+	}
+
+	BodyView BodyStore::GetView() const
+	{
+		BodyView view;
+		view.m_numBodies = GetNumBodies();
+		view.m_x = m_x.data();
+		view.m_y = m_y.data();
+		view.m_velX = m_velX.data();
+		view.m_velY = m_velY.data();
+		view.m_radius = m_radius.data();
+		view.m_shape = m_shape.data();
+		view.m_color = m_color.data();
+		view.m_geometry = m_shapes.GetGeometry();
+		return view;
+	}
+
+	float BodyStore::GetMaxBound() const
+	{
+		const ShapeGeometry* geometry = m_shapes.GetGeometry();
+
+		float maxBound = 0.0f;
+		for (const TShapeHandle shape : m_shape)
+		{
+			if (geometry[shape].m_bound > maxBound)
+				maxBound = geometry[shape].m_bound;
+		}
+
+		return maxBound;
+	}
+
+} // test
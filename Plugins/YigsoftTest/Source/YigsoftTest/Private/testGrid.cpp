@@ -0,0 +1,95 @@
+#include "testGrid.h"
+#include "frameworkCore.h"
+
+#include <math.h>
+#include <algorithm>
+
+namespace test
+{
+
+	SpatialGrid::SpatialGrid()
+		: m_cellSize(1.0f)
+		, m_invCellSize(1.0f)
+		, m_skin(0.0f)
+		, m_numCellsX(1)
+		, m_numCellsY(1)
+	{
+	}
+
+	void SpatialGrid::Build(const float* x, const float* y, const int numBodies, const float range, const float skin)
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+
+		m_skin = skin;
+		m_cellSize = (range > 1.0f) ? range : 1.0f;
+		m_invCellSize = 1.0f / m_cellSize;
+
+		// cells are at least cellSize wide so the 3x3 block always covers the interaction distance
+		m_numCellsX = (int)(width * m_invCellSize);
+		m_numCellsY = (int)(height * m_invCellSize);
+		if (m_numCellsX < 1) m_numCellsX = 1;
+		if (m_numCellsY < 1) m_numCellsY = 1;
+
+		const int numCells = m_numCellsX * m_numCellsY;
+
+		m_cellStart.assign(numCells + 1, 0);
+		m_cellIndices.resize(numBodies);
+		m_bodyCells.resize(numBodies);
+
+		// count bodies per cell
+		for (int i = 0; i < numBodies; ++i)
+		{
+			int cellX = 0;
+			int cellY = 0;
+			GetCell(x[i], y[i], cellX, cellY);
+
+			const int cell = cellX + cellY * m_numCellsX;
+			m_bodyCells[i] = cell;
+			m_cellStart[cell + 1] += 1;
+		}
+
+		// prefix sum
+		for (int i = 0; i < numCells; ++i)
+			m_cellStart[i + 1] += m_cellStart[i];
+
+		// scatter, iterating in body order keeps every cell sorted
+		m_writePos.assign(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (int i = 0; i < numBodies; ++i)
+			m_cellIndices[m_writePos[m_bodyCells[i]]++] = i;
+
+		m_buildX.assign(x, x + numBodies);
+		m_buildY.assign(y, y + numBodies);
+		m_escaped.clear();
+	}
+
+	void SpatialGrid::UpdateBody(const int index, const float x, const float y)
+	{
+		// a body within the skin from where it was at the build is in the 3x3 block of any query it is in range of
+		const float dx = x - m_buildX[index];
+		const float dy = y - m_buildY[index];
+
+		// NaN fails the test, an escaped body is added only once
+		if (dx * dx + dy * dy > m_skin * m_skin)
+		{
+			m_buildX[index] = NAN;
+			m_escaped.insert(std::upper_bound(m_escaped.begin(), m_escaped.end(), index), index);
+		}
+	}
+
+	void SpatialGrid::GetCell(const float x, const float y, int& outCellX, int& outCellY) const
+	{
+		int cellX = (int)(x * m_invCellSize);
+		int cellY = (int)(y * m_invCellSize);
+
+		if (x < 0.0f || cellX < 0) cellX = 0;
+		else if (cellX >= m_numCellsX) cellX = m_numCellsX - 1;
+
+		if (y < 0.0f || cellY < 0) cellY = 0;
+		else if (cellY >= m_numCellsY) cellY = m_numCellsY - 1;
+
+		outCellX = cellX;
+		outCellY = cellY;
+	}
+
+} // test
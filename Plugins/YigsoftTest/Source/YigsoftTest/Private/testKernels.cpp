@@ -0,0 +1,464 @@
+#include "testKernels.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+	#define TEST_KERNELS_X86
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#include <immintrin.h>
+		#define TEST_KERNELS_TARGET(isa)
+	#else
+		#include <cpuid.h>
+		#include <immintrin.h>
+		// wider variants are compiled for their instruction set only, the rest of the build stays on the baseline
+		#define TEST_KERNELS_TARGET(isa) __attribute__((target(isa)))
+	#endif
+#endif
+
+// AVX-512 comes with FMA, fused multiply-adds round differently, so the compiler must not contract the kernels
+#if defined(__clang__)
+	#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+	#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+	#pragma fp_contract(off)
+#endif
+
+namespace test
+{
+	namespace helper
+	{
+		static void IntegrateScalar(float* x, float* y, float* velX, float* velY, const int first, const int end, const IntegrateParams& params)
+		{
+			for (int i = first; i < end; ++i)
+			{
+				float vx = velX[i];
+				float vy = velY[i];
+
+				const float length = sqrtf(vy * vy + vx * vx);
+				if (length > 0.0f)
+				{
+					vx /= length;
+					vy /= length;
+				}
+
+				velX[i] = vx;
+				velY[i] = vy;
+
+				float px = x[i] + vx * params.m_deltaTime * params.m_speed;
+				float py = y[i] + vy * params.m_deltaTime * params.m_speed;
+
+				if (px > params.m_width)
+					px -= params.m_width;
+				else if (px < 0.0f)
+					px += params.m_width;
+
+				if (py > params.m_height)
+					py -= params.m_height;
+				else if (py < 0.0f)
+					py += params.m_height;
+
+				x[i] = px;
+				y[i] = py;
+			}
+		}
+
+		static void ApplyAttractionScalar(float* velX, float* velY, const float* dirX, const float* dirY, const int first, const int end, const float gravitation)
+		{
+			for (int i = first; i < end; ++i)
+			{
+				// attractor directions are unit vectors, zero means there was none
+				if (dirX[i] != 0.0f || dirY[i] != 0.0f)
+				{
+					velX[i] += dirX[i] * gravitation;
+					velY[i] += dirY[i] * gravitation;
+				}
+			}
+		}
+
+		static void IntegrateScalarAll(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params)
+		{
+			IntegrateScalar(x, y, velX, velY, 0, count, params);
+		}
+
+		static void ApplyAttractionScalarAll(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation)
+		{
+			ApplyAttractionScalar(velX, velY, dirX, dirY, 0, count, gravitation);
+		}
+
+#if defined(TEST_KERNELS_X86)
+
+		//-----
+
+		TEST_KERNELS_TARGET("sse2")
+		static inline __m128 SelectSSE(const __m128 mask, const __m128 a, const __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+
+		TEST_KERNELS_TARGET("sse2")
+		static inline __m128 WrapSSE(const __m128 pos, const __m128 size, const __m128 zero)
+		{
+			const __m128 over = _mm_cmpgt_ps(pos, size);
+			const __m128 under = _mm_cmplt_ps(pos, zero);
+			return SelectSSE(over, _mm_sub_ps(pos, size), SelectSSE(under, _mm_add_ps(pos, size), pos));
+		}
+
+		TEST_KERNELS_TARGET("sse2")
+		static void IntegrateSSE2(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 deltaTime = _mm_set1_ps(params.m_deltaTime);
+			const __m128 speed = _mm_set1_ps(params.m_speed);
+			const __m128 width = _mm_set1_ps(params.m_width);
+			const __m128 height = _mm_set1_ps(params.m_height);
+
+			int i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128 vx = _mm_loadu_ps(velX + i);
+				__m128 vy = _mm_loadu_ps(velY + i);
+
+				const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vy, vy), _mm_mul_ps(vx, vx)));
+				const __m128 moving = _mm_cmpgt_ps(length, zero);
+				vx = SelectSSE(moving, _mm_div_ps(vx, length), vx);
+				vy = SelectSSE(moving, _mm_div_ps(vy, length), vy);
+
+				_mm_storeu_ps(velX + i, vx);
+				_mm_storeu_ps(velY + i, vy);
+
+				const __m128 px = _mm_add_ps(_mm_loadu_ps(x + i), _mm_mul_ps(_mm_mul_ps(vx, deltaTime), speed));
+				const __m128 py = _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_mul_ps(vy, deltaTime), speed));
+
+				_mm_storeu_ps(x + i, WrapSSE(px, width, zero));
+				_mm_storeu_ps(y + i, WrapSSE(py, height, zero));
+			}
+
+			IntegrateScalar(x, y, velX, velY, i, count, params);
+		}
+
+		TEST_KERNELS_TARGET("sse2")
+		static void ApplyAttractionSSE2(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation)
+		{
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 pull = _mm_set1_ps(gravitation);
+
+			int i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				const __m128 dx = _mm_loadu_ps(dirX + i);
+				const __m128 dy = _mm_loadu_ps(dirY + i);
+				const __m128 hit = _mm_or_ps(_mm_cmpneq_ps(dx, zero), _mm_cmpneq_ps(dy, zero));
+
+				const __m128 vx = _mm_loadu_ps(velX + i);
+				const __m128 vy = _mm_loadu_ps(velY + i);
+				_mm_storeu_ps(velX + i, SelectSSE(hit, _mm_add_ps(vx, _mm_mul_ps(dx, pull)), vx));
+				_mm_storeu_ps(velY + i, SelectSSE(hit, _mm_add_ps(vy, _mm_mul_ps(dy, pull)), vy));
+			}
+
+			ApplyAttractionScalar(velX, velY, dirX, dirY, i, count, gravitation);
+		}
+
+		//-----
+
+		TEST_KERNELS_TARGET("avx2")
+		static inline __m256 WrapAVX(const __m256 pos, const __m256 size, const __m256 zero)
+		{
+			const __m256 over = _mm256_cmp_ps(pos, size, _CMP_GT_OQ);
+			const __m256 under = _mm256_cmp_ps(pos, zero, _CMP_LT_OQ);
+			return _mm256_blendv_ps(_mm256_blendv_ps(pos, _mm256_add_ps(pos, size), under), _mm256_sub_ps(pos, size), over);
+		}
+
+		TEST_KERNELS_TARGET("avx2")
+		static void IntegrateAVX2(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params)
+		{
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 deltaTime = _mm256_set1_ps(params.m_deltaTime);
+			const __m256 speed = _mm256_set1_ps(params.m_speed);
+			const __m256 width = _mm256_set1_ps(params.m_width);
+			const __m256 height = _mm256_set1_ps(params.m_height);
+
+			int i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 vx = _mm256_loadu_ps(velX + i);
+				__m256 vy = _mm256_loadu_ps(velY + i);
+
+				const __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(vy, vy), _mm256_mul_ps(vx, vx)));
+				const __m256 moving = _mm256_cmp_ps(length, zero, _CMP_GT_OQ);
+				vx = _mm256_blendv_ps(vx, _mm256_div_ps(vx, length), moving);
+				vy = _mm256_blendv_ps(vy, _mm256_div_ps(vy, length), moving);
+
+				_mm256_storeu_ps(velX + i, vx);
+				_mm256_storeu_ps(velY + i, vy);
+
+				const __m256 px = _mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(_mm256_mul_ps(vx, deltaTime), speed));
+				const __m256 py = _mm256_add_ps(_mm256_loadu_ps(y + i), _mm256_mul_ps(_mm256_mul_ps(vy, deltaTime), speed));
+
+				_mm256_storeu_ps(x + i, WrapAVX(px, width, zero));
+				_mm256_storeu_ps(y + i, WrapAVX(py, height, zero));
+			}
+
+			IntegrateScalar(x, y, velX, velY, i, count, params);
+		}
+
+		TEST_KERNELS_TARGET("avx2")
+		static void ApplyAttractionAVX2(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation)
+		{
+			const __m256 zero = _mm256_setzero_ps();
+			const __m256 pull = _mm256_set1_ps(gravitation);
+
+			int i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				const __m256 dx = _mm256_loadu_ps(dirX + i);
+				const __m256 dy = _mm256_loadu_ps(dirY + i);
+				const __m256 hit = _mm256_or_ps(_mm256_cmp_ps(dx, zero, _CMP_NEQ_UQ), _mm256_cmp_ps(dy, zero, _CMP_NEQ_UQ));
+
+				const __m256 vx = _mm256_loadu_ps(velX + i);
+				const __m256 vy = _mm256_loadu_ps(velY + i);
+				_mm256_storeu_ps(velX + i, _mm256_blendv_ps(vx, _mm256_add_ps(vx, _mm256_mul_ps(dx, pull)), hit));
+				_mm256_storeu_ps(velY + i, _mm256_blendv_ps(vy, _mm256_add_ps(vy, _mm256_mul_ps(dy, pull)), hit));
+			}
+
+			ApplyAttractionScalar(velX, velY, dirX, dirY, i, count, gravitation);
+		}
+
+		//-----
+
+		// the tail is handled with masked loads and stores, lanes past the end are never touched
+
+		TEST_KERNELS_TARGET("avx512f")
+		static inline __m512 WrapAVX512(const __m512 pos, const __m512 size, const __m512 zero)
+		{
+			const __mmask16 over = _mm512_cmp_ps_mask(pos, size, _CMP_GT_OQ);
+			const __mmask16 under = _mm512_cmp_ps_mask(pos, zero, _CMP_LT_OQ);
+			const __m512 wrapped = _mm512_mask_add_ps(pos, under, pos, size);
+			return _mm512_mask_sub_ps(wrapped, over, pos, size);
+		}
+
+		TEST_KERNELS_TARGET("avx512f")
+		static void IntegrateAVX512(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params)
+		{
+			const __m512 zero = _mm512_setzero_ps();
+			const __m512 deltaTime = _mm512_set1_ps(params.m_deltaTime);
+			const __m512 speed = _mm512_set1_ps(params.m_speed);
+			const __m512 width = _mm512_set1_ps(params.m_width);
+			const __m512 height = _mm512_set1_ps(params.m_height);
+
+			for (int i = 0; i < count; i += 16)
+			{
+				const int numLanes = (count - i < 16) ? count - i : 16;
+				const __mmask16 lanes = (__mmask16)((1u << numLanes) - 1u);
+
+				__m512 vx = _mm512_maskz_loadu_ps(lanes, velX + i);
+				__m512 vy = _mm512_maskz_loadu_ps(lanes, velY + i);
+
+				const __m512 length = _mm512_sqrt_ps(_mm512_add_ps(_mm512_mul_ps(vy, vy), _mm512_mul_ps(vx, vx)));
+				const __mmask16 moving = _mm512_cmp_ps_mask(length, zero, _CMP_GT_OQ);
+				vx = _mm512_mask_div_ps(vx, moving, vx, length);
+				vy = _mm512_mask_div_ps(vy, moving, vy, length);
+
+				_mm512_mask_storeu_ps(velX + i, lanes, vx);
+				_mm512_mask_storeu_ps(velY + i, lanes, vy);
+
+				const __m512 px = _mm512_add_ps(_mm512_maskz_loadu_ps(lanes, x + i), _mm512_mul_ps(_mm512_mul_ps(vx, deltaTime), speed));
+				const __m512 py = _mm512_add_ps(_mm512_maskz_loadu_ps(lanes, y + i), _mm512_mul_ps(_mm512_mul_ps(vy, deltaTime), speed));
+
+				_mm512_mask_storeu_ps(x + i, lanes, WrapAVX512(px, width, zero));
+				_mm512_mask_storeu_ps(y + i, lanes, WrapAVX512(py, height, zero));
+			}
+		}
+
+		TEST_KERNELS_TARGET("avx512f")
+		static void ApplyAttractionAVX512(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation)
+		{
+			const __m512 zero = _mm512_setzero_ps();
+			const __m512 pull = _mm512_set1_ps(gravitation);
+
+			for (int i = 0; i < count; i += 16)
+			{
+				const int numLanes = (count - i < 16) ? count - i : 16;
+				const __mmask16 lanes = (__mmask16)((1u << numLanes) - 1u);
+
+				const __m512 dx = _mm512_maskz_loadu_ps(lanes, dirX + i);
+				const __m512 dy = _mm512_maskz_loadu_ps(lanes, dirY + i);
+				const __mmask16 hit = (__mmask16)(_mm512_cmp_ps_mask(dx, zero, _CMP_NEQ_UQ) | _mm512_cmp_ps_mask(dy, zero, _CMP_NEQ_UQ)) & lanes;
+
+				const __m512 vx = _mm512_maskz_loadu_ps(lanes, velX + i);
+				const __m512 vy = _mm512_maskz_loadu_ps(lanes, velY + i);
+				_mm512_mask_storeu_ps(velX + i, hit, _mm512_add_ps(vx, _mm512_mul_ps(dx, pull)));
+				_mm512_mask_storeu_ps(velY + i, hit, _mm512_add_ps(vy, _mm512_mul_ps(dy, pull)));
+			}
+		}
+
+		//-----
+
+		static void CpuId(const int leaf, const int subleaf, unsigned int* outRegs)
+		{
+#if defined(_MSC_VER)
+			__cpuidex((int*)outRegs, leaf, subleaf);
+#else
+			__cpuid_count(leaf, subleaf, outRegs[0], outRegs[1], outRegs[2], outRegs[3]);
+#endif
+		}
+
+		/// register state the OS saves on a context switch (XCR0)
+		static uint64_t GetEnabledState()
+		{
+#if defined(_MSC_VER)
+			return _xgetbv(0);
+#else
+			unsigned int low = 0;
+			unsigned int high = 0;
+			__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return ((uint64_t)high << 32) | low;
+#endif
+		}
+
+		static SimdLevel DetectLevel()
+		{
+			unsigned int regs[4] = {};
+			CpuId(0, 0, regs);
+			const unsigned int maxLeaf = regs[0];
+
+			CpuId(1, 0, regs);
+			const bool hasSSE2 = (regs[3] & (1u << 26)) != 0;
+			const bool hasOSXSave = (regs[2] & (1u << 27)) != 0;
+			const bool hasAVX = (regs[2] & (1u << 28)) != 0;
+			if (!hasSSE2)
+				return SimdLevel::Scalar;
+
+			if (!hasOSXSave || !hasAVX || maxLeaf < 7)
+				return SimdLevel::SSE2;
+
+			const uint64_t state = GetEnabledState();
+			const uint64_t YMM_STATE = 0x6; // XMM and YMM
+			const uint64_t ZMM_STATE = 0xE6; // and the opmask and ZMM registers
+			if ((state & YMM_STATE) != YMM_STATE)
+				return SimdLevel::SSE2;
+
+			CpuId(7, 0, regs);
+			const bool hasAVX2 = (regs[1] & (1u << 5)) != 0;
+			const bool hasAVX512 = (regs[1] & (1u << 16)) != 0;
+			if (!hasAVX2)
+				return SimdLevel::SSE2;
+
+			if (hasAVX512 && (state & ZMM_STATE) == ZMM_STATE)
+				return SimdLevel::AVX512;
+
+			return SimdLevel::AVX2;
+		}
+
+#else
+
+		static SimdLevel DetectLevel()
+		{
+			return SimdLevel::Scalar;
+		}
+
+#endif
+
+		//-----
+
+		/// kernels of one level
+		struct KernelTable
+		{
+			SimdLevel	m_level;
+			void		(*m_integrate)(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params);
+			void		(*m_applyAttraction)(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation);
+		};
+
+		static KernelTable MakeTable(const SimdLevel level)
+		{
+			KernelTable table;
+			table.m_level = SimdLevel::Scalar;
+			table.m_integrate = &IntegrateScalarAll;
+			table.m_applyAttraction = &ApplyAttractionScalarAll;
+
+#if defined(TEST_KERNELS_X86)
+			if (level == SimdLevel::SSE2)
+			{
+				table.m_level = level;
+				table.m_integrate = &IntegrateSSE2;
+				table.m_applyAttraction = &ApplyAttractionSSE2;
+			}
+			else if (level == SimdLevel::AVX2)
+			{
+				table.m_level = level;
+				table.m_integrate = &IntegrateAVX2;
+				table.m_applyAttraction = &ApplyAttractionAVX2;
+			}
+			else if (level == SimdLevel::AVX512)
+			{
+				table.m_level = level;
+				table.m_integrate = &IntegrateAVX512;
+				table.m_applyAttraction = &ApplyAttractionAVX512;
+			}
+#endif
+
+			return table;
+		}
+
+		static SimdLevel GetDetectedLevel()
+		{
+			static const SimdLevel st_level = DetectLevel();
+			return st_level;
+		}
+
+		static KernelTable& GetTable()
+		{
+			static KernelTable st_table = MakeTable(GetDetectedLevel());
+			return st_table;
+		}
+	} // helper
+
+	namespace kernels
+	{
+		SimdLevel GetSupportedLevel()
+		{
+			return helper::GetDetectedLevel();
+		}
+
+		SimdLevel GetLevel()
+		{
+			return helper::GetTable().m_level;
+		}
+
+		SimdLevel SetLevel(const SimdLevel level)
+		{
+			const SimdLevel supported = GetSupportedLevel();
+			helper::GetTable() = helper::MakeTable((level > supported) ? supported : level);
+			return GetLevel();
+		}
+
+		const char* GetLevelName(const SimdLevel level)
+		{
+			switch (level)
+			{
+			case SimdLevel::SSE2:
+				return "sse2";
+			case SimdLevel::AVX2:
+				return "avx2";
+			case SimdLevel::AVX512:
+				return "avx512";
+			default:
+				return "scalar";
+			}
+		}
+
+		void Integrate(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params)
+		{
+			helper::GetTable().m_integrate(x, y, velX, velY, count, params);
+		}
+
+		void ApplyAttraction(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation)
+		{
+			helper::GetTable().m_applyAttraction(velX, velY, dirX, dirY, count, gravitation);
+		}
+	}
+
+} // test
@@ -0,0 +1,143 @@
+#include "testNarrowphase.h"
+#include "testShape.h"
+#include "testKernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+	#define TEST_NARROWPHASE_X86
+	#include <immintrin.h>
+
+	// both widths are compiled for their instruction set only and picked at run time by the kernel level (see testKernels.h)
+	#if defined(_MSC_VER)
+		#define TEST_NARROWPHASE_TARGET_BEGIN(isa)
+		#define TEST_NARROWPHASE_TARGET_END()
+	#else
+		#define TEST_NARROWPHASE_PRAGMA(text) _Pragma(#text)
+		#if defined(__clang__)
+			#define TEST_NARROWPHASE_TARGET_BEGIN(isa) TEST_NARROWPHASE_PRAGMA(clang attribute push(__attribute__((target(isa))), apply_to = function))
+			#define TEST_NARROWPHASE_TARGET_END() TEST_NARROWPHASE_PRAGMA(clang attribute pop)
+		#else
+			#define TEST_NARROWPHASE_TARGET_BEGIN(isa) TEST_NARROWPHASE_PRAGMA(GCC push_options) TEST_NARROWPHASE_PRAGMA(GCC target(isa))
+			#define TEST_NARROWPHASE_TARGET_END() TEST_NARROWPHASE_PRAGMA(GCC pop_options)
+		#endif
+	#endif
+#endif
+
+namespace test
+{
+	namespace helper
+	{
+		const int MAX_VERTICES = shape::MAX_EDGES;
+
+		static inline float MaskBits(const bool set)
+		{
+			union { unsigned int u; float f; } bits;
+			bits.u = set ? 0xFFFFFFFFu : 0u;
+			return bits.f;
+		}
+
+#if defined(TEST_NARROWPHASE_X86)
+
+TEST_NARROWPHASE_TARGET_BEGIN("sse2")
+		namespace sse
+		{
+			struct Simd
+			{
+				static const int WIDTH = 4;
+				typedef __m128 TVec;
+
+				static inline TVec Load(const float* ptr) { return _mm_load_ps(ptr); }
+				static inline TVec Zero() { return _mm_setzero_ps(); }
+				static inline TVec AllOnes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+				static inline TVec Add(TVec a, TVec b) { return _mm_add_ps(a, b); }
+				static inline TVec Sub(TVec a, TVec b) { return _mm_sub_ps(a, b); }
+				static inline TVec Mul(TVec a, TVec b) { return _mm_mul_ps(a, b); }
+				static inline TVec Less(TVec a, TVec b) { return _mm_cmplt_ps(a, b); }
+				static inline TVec And(TVec a, TVec b) { return _mm_and_ps(a, b); }
+				static inline TVec Or(TVec a, TVec b) { return _mm_or_ps(a, b); }
+				static inline int Mask(TVec a) { return _mm_movemask_ps(a); }
+			};
+
+			#include "testNarrowphaseBatch.inl"
+		}
+TEST_NARROWPHASE_TARGET_END()
+
+		// no FMA in the target, the products are rounded like in the scalar path
+TEST_NARROWPHASE_TARGET_BEGIN("avx2")
+		namespace avx2
+		{
+			struct Simd
+			{
+				static const int WIDTH = 8;
+				typedef __m256 TVec;
+
+				static inline TVec Load(const float* ptr) { return _mm256_load_ps(ptr); }
+				static inline TVec Zero() { return _mm256_setzero_ps(); }
+				static inline TVec AllOnes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+				static inline TVec Add(TVec a, TVec b) { return _mm256_add_ps(a, b); }
+				static inline TVec Sub(TVec a, TVec b) { return _mm256_sub_ps(a, b); }
+				static inline TVec Mul(TVec a, TVec b) { return _mm256_mul_ps(a, b); }
+				static inline TVec Less(TVec a, TVec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+				static inline TVec And(TVec a, TVec b) { return _mm256_and_ps(a, b); }
+				static inline TVec Or(TVec a, TVec b) { return _mm256_or_ps(a, b); }
+				static inline int Mask(TVec a) { return _mm256_movemask_ps(a); }
+			};
+
+			#include "testNarrowphaseBatch.inl"
+		}
+TEST_NARROWPHASE_TARGET_END()
+
+#endif
+
+		static void TestOverlapPairsScalar(const ShapeArrays& shapes, const OverlapPair* pairs, const int numPairs, bool* outOverlaps)
+		{
+			for (int i = 0; i < numPairs; ++i)
+			{
+				const int a = pairs[i].m_a;
+				const int b = pairs[i].m_b;
+				const auto& shapeA = shapes.m_geometry[shapes.m_shape[a]];
+				const auto& shapeB = shapes.m_geometry[shapes.m_shape[b]];
+
+				outOverlaps[i] = shape::TestOverlap(
+					shapeA.m_type, shapeA.m_size, shapes.m_x[a], shapes.m_y[a],
+					shapeB.m_type, shapeB.m_size, shapes.m_x[b], shapes.m_y[b]);
+			}
+		}
+
+	} // helper
+
+	namespace shape
+	{
+		int GetOverlapBatchWidth()
+		{
+#if defined(TEST_NARROWPHASE_X86)
+			// AVX-512 gains nothing over AVX2 here, the lanes are mostly spent on setting up the shapes
+			const SimdLevel level = kernels::GetLevel();
+			if (level >= SimdLevel::AVX2)
+				return test::helper::avx2::W;
+			if (level >= SimdLevel::SSE2)
+				return test::helper::sse::W;
+#endif
+			return 1;
+		}
+
+		void TestOverlapBatch(const ShapeArrays& shapes, const OverlapPair* pairs, const int numPairs, bool* outOverlaps)
+		{
+#if defined(TEST_NARROWPHASE_X86)
+			const SimdLevel level = kernels::GetLevel();
+			if (level >= SimdLevel::AVX2)
+			{
+				test::helper::avx2::TestOverlapPairs(shapes, pairs, numPairs, outOverlaps);
+				return;
+			}
+
+			if (level >= SimdLevel::SSE2)
+			{
+				test::helper::sse::TestOverlapPairs(shapes, pairs, numPairs, outOverlaps);
+				return;
+			}
+#endif
+			test::helper::TestOverlapPairsScalar(shapes, pairs, numPairs, outOverlaps);
+		}
+	}
+
+} // test
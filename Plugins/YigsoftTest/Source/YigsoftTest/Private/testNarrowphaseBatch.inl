@@ -0,0 +1,131 @@
+// batched point-in-polygon tests, included once per instruction set by testNarrowphase.cpp
+// The including namespace defines Simd, everything here is compiled for its target.
+
+const int W = Simd::WIDTH;
+
+/// one side of the batch, lane k holds the shape of pair k
+struct alignas(32) BatchShapes
+{
+	float	m_posX[W];
+	float	m_posY[W];
+	float	m_vx[MAX_VERTICES][W];
+	float	m_vy[MAX_VERTICES][W];
+	float	m_nx[MAX_VERTICES][W];
+	float	m_ny[MAX_VERTICES][W];
+	float	m_valid[MAX_VERTICES][W]; // all bits set for existing vertices
+	float	m_invalid[MAX_VERTICES][W]; // all bits set for padding
+};
+
+static inline void SetupLane(BatchShapes& batch, const int lane, const ShapeArrays& shapes, const int index)
+{
+	// geometry is already scaled and its unused slots are zero, so they need no special handling here
+	const auto& geometry = shapes.m_geometry[shapes.m_shape[index]];
+
+	batch.m_posX[lane] = shapes.m_x[index];
+	batch.m_posY[lane] = shapes.m_y[index];
+
+	for (int i = 0; i < MAX_VERTICES; ++i)
+	{
+		const bool valid = i < geometry.m_numEdges;
+
+		batch.m_vx[i][lane] = geometry.m_x[i];
+		batch.m_vy[i][lane] = geometry.m_y[i];
+		batch.m_nx[i][lane] = geometry.m_nx[i];
+		batch.m_ny[i][lane] = geometry.m_ny[i];
+		batch.m_valid[i][lane] = MaskBits(valid);
+		batch.m_invalid[i][lane] = MaskBits(!valid);
+	}
+}
+
+/// is any vertex of shape "p" inside the shape "q", per lane
+static inline Simd::TVec CheckCollision(const BatchShapes& p, const BatchShapes& q)
+{
+	const auto zero = Simd::Zero();
+	const auto pPosX = Simd::Load(p.m_posX);
+	const auto pPosY = Simd::Load(p.m_posY);
+	const auto qPosX = Simd::Load(q.m_posX);
+	const auto qPosY = Simd::Load(q.m_posY);
+
+	auto result = zero;
+
+	for (int i = 0; i < MAX_VERTICES; ++i)
+	{
+		// point relative to q, same operation order as the scalar path
+		const auto x = Simd::Sub(Simd::Add(Simd::Load(p.m_vx[i]), pPosX), qPosX);
+		const auto y = Simd::Sub(Simd::Add(Simd::Load(p.m_vy[i]), pPosY), qPosY);
+
+		auto inside = Simd::AllOnes();
+		for (int j = 0; j < MAX_VERTICES; ++j)
+		{
+			const auto dot = Simd::Add(
+				Simd::Mul(Simd::Load(q.m_nx[j]), Simd::Sub(x, Simd::Load(q.m_vx[j]))),
+				Simd::Mul(Simd::Load(q.m_ny[j]), Simd::Sub(y, Simd::Load(q.m_vy[j]))));
+
+			// padding edges never reject the point
+			inside = Simd::And(inside, Simd::Or(Simd::Less(dot, zero), Simd::Load(q.m_invalid[j])));
+		}
+
+		result = Simd::Or(result, Simd::And(inside, Simd::Load(p.m_valid[i])));
+	}
+
+	return result;
+}
+
+/// full test of up to W pairs that passed the bounding circle reject
+static int TestOverlapLanes(const ShapeArrays& shapes, const OverlapPair* pairs, const int* lanePairs, const int numLanes)
+{
+	BatchShapes a;
+	BatchShapes b;
+
+	// unused lanes repeat the last pair, their results are ignored
+	for (int lane = 0; lane < W; ++lane)
+	{
+		const auto& pair = pairs[lanePairs[(lane < numLanes) ? lane : numLanes - 1]];
+		SetupLane(a, lane, shapes, pair.m_a);
+		SetupLane(b, lane, shapes, pair.m_b);
+	}
+
+	return Simd::Mask(Simd::Or(CheckCollision(a, b), CheckCollision(b, a)));
+}
+
+static void TestOverlapPairs(const ShapeArrays& shapes, const OverlapPair* pairs, const int numPairs, bool* outOverlaps)
+{
+	int lanePairs[W];
+	int numLanes = 0;
+
+	for (int i = 0; i < numPairs; ++i)
+	{
+		const int indexA = pairs[i].m_a;
+		const int indexB = pairs[i].m_b;
+
+		// bounding circle reject, only the close pairs take a lane
+		const float boundA = shapes.m_geometry[shapes.m_shape[indexA]].m_bound;
+		const float boundB = shapes.m_geometry[shapes.m_shape[indexB]].m_bound;
+		const float reach = shape::GetOverlapReach(boundA, boundB);
+
+		const float dx = shapes.m_x[indexB] - shapes.m_x[indexA];
+		const float dy = shapes.m_y[indexB] - shapes.m_y[indexA];
+
+		outOverlaps[i] = false;
+		if (dx * dx + dy * dy >= reach * reach)
+			continue;
+
+		lanePairs[numLanes++] = i;
+
+		if (numLanes == W)
+		{
+			const int mask = TestOverlapLanes(shapes, pairs, lanePairs, numLanes);
+			for (int lane = 0; lane < numLanes; ++lane)
+				outOverlaps[lanePairs[lane]] = (mask >> lane) & 1;
+
+			numLanes = 0;
+		}
+	}
+
+	if (numLanes > 0)
+	{
+		const int mask = TestOverlapLanes(shapes, pairs, lanePairs, numLanes);
+		for (int lane = 0; lane < numLanes; ++lane)
+			outOverlaps[lanePairs[lane]] = (mask >> lane) & 1;
+	}
+}
@@ -0,0 +1,461 @@
+#include "testNeighbourList.h"
+#include "frameworkCore.h"
+#include "jobSystem.h"
+
+#include <math.h>
+#include <climits>
+#include <algorithm>
+
+namespace test
+{
+	namespace helper
+	{
+		// Bodies per job system task
+		const int NEIGHBOUR_BLOCK_SIZE = 256;
+		const int DISPLACEMENT_GRAIN_SIZE = 4096;
+
+		/// shortest offset between two coordinates of the wrapping world
+		static inline float MinimumImage(float delta, const float size)
+		{
+			if (delta > 0.5f * size)
+				delta -= size;
+			else if (delta < -0.5f * size)
+				delta += size;
+
+			return delta;
+		}
+
+		static inline int WrapCell(int cell, const int numCells)
+		{
+			cell %= numCells;
+			return (cell < 0) ? cell + numCells : cell;
+		}
+
+		/// cells to visit around given one, all of them if there are less than three
+		static inline int GetCellRange(const int cell, const int numCells, int* outCells)
+		{
+			if (numCells < 3)
+			{
+				for (int i = 0; i < numCells; ++i)
+					outCells[i] = i;
+				return numCells;
+			}
+
+			outCells[0] = WrapCell(cell - 1, numCells);
+			outCells[1] = cell;
+			outCells[2] = WrapCell(cell + 1, numCells);
+			return 3;
+		}
+
+		/// merge consecutive sorted runs of the data in place, runStarts has numRuns + 1 entries
+		static void MergeRuns(int* data, int* runStarts, int numRuns, std::vector< int >& scratch)
+		{
+			if (numRuns < 2)
+				return;
+
+			scratch.resize(runStarts[numRuns]);
+
+			// bottom-up, merge neighbouring runs pairwise until only one is left
+			while (numRuns > 1)
+			{
+				int numMerged = 0;
+				for (int i = 0; i < numRuns; i += 2)
+				{
+					const int begin = runStarts[i];
+					if (i + 1 < numRuns)
+					{
+						std::merge(data + begin, data + runStarts[i + 1], data + runStarts[i + 1], data + runStarts[i + 2], scratch.data() + begin);
+						std::copy(scratch.data() + begin, scratch.data() + runStarts[i + 2], data + begin);
+					}
+
+					runStarts[numMerged++] = begin;
+				}
+
+				runStarts[numMerged] = runStarts[numRuns];
+				numRuns = numMerged;
+			}
+		}
+
+		/// can the position not reach the world edges (and wrap around) by moving given distance
+		static inline bool IsAwayFromEdges(const float x, const float y, const float distance)
+		{
+			return x > distance && x < (float)app::Resolution::WIDTH - distance
+				&& y > distance && y < (float)app::Resolution::HEIGHT - distance;
+		}
+	}
+
+	const float NeighbourList::DEFAULT_SKIN = 20.0f;
+
+	NeighbourList::NeighbourList()
+		: m_skin(DEFAULT_SKIN)
+		, m_margin(0.0f)
+		, m_attractionRange(0.0f)
+		, m_cutoff(0.0f)
+		, m_collisionCutoff(0.0f)
+		, m_valid(false)
+	{
+		m_offsets.push_back(0);
+		m_collisionOffsets.push_back(0);
+
+		m_stats.m_numEntries = 0;
+		m_stats.m_numCollisionEntries = 0;
+		m_stats.m_maxNeighbours = 0;
+		m_stats.m_skin = m_skin;
+		m_stats.m_maxDisplacement = 0.0f;
+		ResetStats();
+	}
+
+	void NeighbourList::SetSkin(const float skin)
+	{
+		m_skin = (skin > 0.0f) ? skin : 0.0f;
+		m_valid = false;
+	}
+
+	bool NeighbourList::Update(const BodyView& bodies, const float attractionRange, const float collisionRange, const float margin, app::JobSystem& jobSystem)
+	{
+		m_stats.m_numUpdates += 1;
+
+		// changed ranges (bigger bodies) are not covered by the old lists, neither are the escaped bodies
+		bool rebuild = !m_valid || !m_escaped.empty() || (bodies.m_numBodies != (int)m_buildX.size()) || (margin > m_margin)
+			|| (attractionRange != m_attractionRange) || (collisionRange + 2.0f * margin + m_skin > m_collisionCutoff);
+
+		if (!rebuild)
+		{
+			// two bodies get closer by at most twice the largest displacement
+			m_stats.m_maxDisplacement = GetMaxDisplacement(bodies, jobSystem);
+			rebuild = 2.0f * m_stats.m_maxDisplacement > m_skin;
+		}
+
+		if (!rebuild)
+			return false;
+
+		app::ScopedTimer timer;
+
+		// collision candidates are filtered with the margin, the other margin and the skin cover the displacements
+		m_margin = margin;
+		m_attractionRange = attractionRange;
+		m_cutoff = attractionRange + m_skin;
+		m_collisionCutoff = collisionRange + 2.0f * margin + m_skin;
+		Build(bodies, jobSystem);
+
+		m_stats.m_numBuilds += 1;
+		m_stats.m_maxDisplacement = 0.0f;
+		m_stats.m_buildTime += timer.GetElaspedTime();
+		return true;
+	}
+
+	void NeighbourList::UpdateBody(const int index, const float x, const float y)
+	{
+		if (m_isEscaped[index])
+			return;
+
+		// a pair is missing in the lists only if the bodies moved more than the skin and one margin together since
+		// the build, so it's enough if one of them escapes once it's past half of that
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+		const float dx = helper::MinimumImage(x - m_buildX[index], width);
+		const float dy = helper::MinimumImage(y - m_buildY[index], height);
+		const float maxDisplacement = 0.5f * (m_skin + m_margin);
+
+		if (dx * dx + dy * dy > maxDisplacement * maxDisplacement)
+		{
+			m_isEscaped[index] = 1;
+			m_escaped.insert(std::upper_bound(m_escaped.begin(), m_escaped.end(), index), index);
+		}
+	}
+
+	float NeighbourList::GetMaxDisplacement(const BodyView& bodies, app::JobSystem& jobSystem)
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+
+		m_workerDisplacement.assign(jobSystem.GetNumWorkers(), 0.0f);
+
+		jobSystem.ParallelFor(0, bodies.m_numBodies, helper::DISPLACEMENT_GRAIN_SIZE, [&](const int begin, const int end, const int workerIndex)
+			{
+				float maxDistSq = 0.0f;
+				for (int i = begin; i < end; ++i)
+				{
+					const float dx = helper::MinimumImage(bodies.m_x[i] - m_buildX[i], width);
+					const float dy = helper::MinimumImage(bodies.m_y[i] - m_buildY[i], height);
+					maxDistSq = std::max(maxDistSq, dx * dx + dy * dy);
+				}
+
+				m_workerDisplacement[workerIndex] = std::max(m_workerDisplacement[workerIndex], maxDistSq);
+			});
+
+		float maxDistSq = 0.0f;
+		for (const float distSq : m_workerDisplacement)
+			maxDistSq = std::max(maxDistSq, distSq);
+
+		return sqrtf(maxDistSq);
+	}
+
+	void NeighbourList::Build(const BodyView& bodies, app::JobSystem& jobSystem)
+	{
+		const int numBodies = bodies.m_numBodies;
+
+		m_cells.Build(bodies, m_cutoff);
+		m_collisionCells.Build(bodies, m_collisionCutoff);
+
+		// rows are gathered per block of bodies in parallel, the row lengths go to the offsets
+		const int numBlocks = (numBodies + helper::NEIGHBOUR_BLOCK_SIZE - 1) / helper::NEIGHBOUR_BLOCK_SIZE;
+		if ((int)m_blocks.size() < numBlocks)
+			m_blocks.resize(numBlocks);
+
+		m_offsets.assign(numBodies + 1, 0);
+		m_collisionOffsets.assign(numBodies + 1, 0);
+
+		jobSystem.ParallelFor(0, numBlocks, 1, [&](const int begin, const int end, const int)
+			{
+				for (int block = begin; block < end; ++block)
+				{
+					Block& rows = m_blocks[block];
+					rows.m_neighbours.clear();
+					rows.m_collisionNeighbours.clear();
+
+					const int first = block * helper::NEIGHBOUR_BLOCK_SIZE;
+					const int last = std::min(first + helper::NEIGHBOUR_BLOCK_SIZE, numBodies);
+					for (int i = first; i < last; ++i)
+					{
+						const size_t start = rows.m_neighbours.size();
+						const size_t collisionStart = rows.m_collisionNeighbours.size();
+						GatherNeighbours(i, bodies, rows);
+						GatherCollisionNeighbours(i, bodies, rows);
+
+						m_offsets[i + 1] = (int)(rows.m_neighbours.size() - start);
+						m_collisionOffsets[i + 1] = (int)(rows.m_collisionNeighbours.size() - collisionStart);
+					}
+				}
+			});
+
+		int maxNeighbours = 0;
+		for (int i = 0; i < numBodies; ++i)
+		{
+			maxNeighbours = std::max(maxNeighbours, m_collisionOffsets[i + 1]);
+			m_offsets[i + 1] += m_offsets[i];
+			m_collisionOffsets[i + 1] += m_collisionOffsets[i];
+		}
+
+		m_neighbours.resize(m_offsets[numBodies]);
+		m_collisionNeighbours.resize(m_collisionOffsets[numBodies]);
+
+		jobSystem.ParallelFor(0, numBlocks, 1, [&](const int begin, const int end, const int)
+			{
+				for (int block = begin; block < end; ++block)
+				{
+					const Block& rows = m_blocks[block];
+					const int first = block * helper::NEIGHBOUR_BLOCK_SIZE;
+
+					std::copy(rows.m_neighbours.begin(), rows.m_neighbours.end(), m_neighbours.begin() + m_offsets[first]);
+					std::copy(rows.m_collisionNeighbours.begin(), rows.m_collisionNeighbours.end(), m_collisionNeighbours.begin() + m_collisionOffsets[first]);
+				}
+			});
+
+		m_buildX.assign(bodies.m_x, bodies.m_x + numBodies);
+		m_buildY.assign(bodies.m_y, bodies.m_y + numBodies);
+		m_escaped.clear();
+		m_isEscaped.assign(numBodies, 0);
+		m_valid = true;
+
+		m_stats.m_numEntries = (int)m_neighbours.size();
+		m_stats.m_numCollisionEntries = (int)m_collisionNeighbours.size();
+		m_stats.m_maxNeighbours = maxNeighbours;
+	}
+
+	void NeighbourList::GatherNeighbours(const int body, const BodyView& bodies, Block& outRows) const
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+		const float cutoffSq = m_cutoff * m_cutoff;
+
+		const float* x = bodies.m_x;
+		const float* y = bodies.m_y;
+		const float bodyX = x[body];
+		const float bodyY = y[body];
+		const int bodyType = bodies.m_geometry[bodies.m_shape[body]].m_type;
+
+		// other body stays an attractor while the lists are valid if it's close enough and neither of them can wrap
+		// around (the attraction does not reach across the world edges), the list ends with the first such body
+		const float edgeDistance = 0.5f * m_skin + 1.0f;
+		const float sureRange = m_attractionRange - m_skin;
+		const float sureRangeSq = (sureRange > 0.0f) ? sureRange * sureRange : 0.0f;
+		const bool canEnd = helper::IsAwayFromEdges(bodyX, bodyY, edgeDistance);
+
+		// walk the cells in the body order (merge of the sorted cells), so the walk stops at the end of the list
+		int cells[3 * 3];
+		const int numCells = m_cells.GetNeighbourCells(body, cells);
+
+		int cursors[3 * 3];
+		int ends[3 * 3];
+		for (int i = 0; i < numCells; ++i)
+		{
+			cursors[i] = m_cells.m_cellStart[cells[i]];
+			ends[i] = m_cells.m_cellStart[cells[i] + 1];
+		}
+
+		for (;;)
+		{
+			int best = -1;
+			int bestIndex = INT_MAX;
+			for (int i = 0; i < numCells; ++i)
+			{
+				if (cursors[i] < ends[i] && m_cells.m_cellIndices[cursors[i]] < bestIndex)
+				{
+					best = i;
+					bestIndex = m_cells.m_cellIndices[cursors[i]];
+				}
+			}
+
+			if (best < 0)
+				break;
+
+			cursors[best] += 1;
+
+			const int index = bestIndex;
+			if (index == body)
+				continue;
+
+			const float dx = helper::MinimumImage(x[index] - bodyX, width);
+			const float dy = helper::MinimumImage(y[index] - bodyY, height);
+			if (dx * dx + dy * dy >= cutoffSq)
+				continue;
+
+			outRows.m_neighbours.push_back(index);
+
+			const float rawDx = x[index] - bodyX;
+			const float rawDy = y[index] - bodyY;
+			if (canEnd && rawDx * rawDx + rawDy * rawDy < sureRangeSq
+				&& bodies.m_geometry[bodies.m_shape[index]].m_type == bodyType
+				&& helper::IsAwayFromEdges(x[index], y[index], edgeDistance))
+			{
+				break;
+			}
+		}
+	}
+
+	void NeighbourList::GatherCollisionNeighbours(const int body, const BodyView& bodies, Block& outRows) const
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+		const float cutoffSq = m_collisionCutoff * m_collisionCutoff;
+
+		const float* x = bodies.m_x;
+		const float* y = bodies.m_y;
+		const float bodyX = x[body];
+		const float bodyY = y[body];
+
+		auto& neighbours = outRows.m_collisionNeighbours;
+		const size_t start = neighbours.size();
+
+		int cells[3 * 3];
+		const int numCells = m_collisionCells.GetNeighbourCells(body, cells);
+
+		// every cell adds an already sorted run, merged at the end
+		int runStarts[3 * 3 + 1];
+		for (int c = 0; c < numCells; ++c)
+		{
+			runStarts[c] = (int)(neighbours.size() - start);
+
+			for (int i = m_collisionCells.m_cellStart[cells[c]]; i < m_collisionCells.m_cellStart[cells[c] + 1]; ++i)
+			{
+				const int index = m_collisionCells.m_cellIndices[i];
+				if (index == body)
+					continue;
+
+				const float dx = helper::MinimumImage(x[index] - bodyX, width);
+				const float dy = helper::MinimumImage(y[index] - bodyY, height);
+				if (dx * dx + dy * dy < cutoffSq)
+					neighbours.push_back(index);
+			}
+		}
+
+		runStarts[numCells] = (int)(neighbours.size() - start);
+		helper::MergeRuns(neighbours.data() + start, runStarts, numCells, outRows.m_mergeScratch);
+	}
+
+	//-----
+
+	NeighbourList::PeriodicCells::PeriodicCells()
+		: m_numCellsX(1)
+		, m_numCellsY(1)
+		, m_invCellWidth(1.0f)
+		, m_invCellHeight(1.0f)
+	{
+	}
+
+	void NeighbourList::PeriodicCells::Build(const BodyView& bodies, const float minCellSize)
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+		const int numBodies = bodies.m_numBodies;
+
+		// cells tile the world exactly and are at least the cutoff wide, so neighbours are in the 3x3 block
+		const float cellSize = (minCellSize > 1.0f) ? minCellSize : 1.0f;
+		m_numCellsX = std::max(1, (int)(width / cellSize));
+		m_numCellsY = std::max(1, (int)(height / cellSize));
+		m_invCellWidth = (float)m_numCellsX / width;
+		m_invCellHeight = (float)m_numCellsY / height;
+
+		const int numCells = m_numCellsX * m_numCellsY;
+
+		// same counting sort as the grid
+		m_cellStart.assign(numCells + 1, 0);
+		m_cellIndices.resize(numBodies);
+		m_bodyCells.resize(numBodies);
+
+		for (int i = 0; i < numBodies; ++i)
+		{
+			const int cellX = helper::WrapCell((int)floorf(bodies.m_x[i] * m_invCellWidth), m_numCellsX);
+			const int cellY = helper::WrapCell((int)floorf(bodies.m_y[i] * m_invCellHeight), m_numCellsY);
+			const int cell = cellX + cellY * m_numCellsX;
+
+			m_bodyCells[i] = cell;
+			m_cellStart[cell + 1] += 1;
+		}
+
+		for (int i = 0; i < numCells; ++i)
+			m_cellStart[i + 1] += m_cellStart[i];
+
+		std::vector< int > writePos(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (int i = 0; i < numBodies; ++i)
+			m_cellIndices[writePos[m_bodyCells[i]]++] = i;
+	}
+
+	int NeighbourList::PeriodicCells::GetNeighbourCells(const int body, int* outCells) const
+	{
+		const int cell = m_bodyCells[body];
+
+		int cellsX[3];
+		int cellsY[3];
+		const int numX = helper::GetCellRange(cell % m_numCellsX, m_numCellsX, cellsX);
+		const int numY = helper::GetCellRange(cell / m_numCellsX, m_numCellsY, cellsY);
+
+		int numCells = 0;
+		for (int iy = 0; iy < numY; ++iy)
+		{
+			for (int ix = 0; ix < numX; ++ix)
+				outCells[numCells++] = cellsX[ix] + cellsY[iy] * m_numCellsX;
+		}
+
+		return numCells;
+	}
+
+	//-----
+
+	NeighbourListStats NeighbourList::GetStats() const
+	{
+		NeighbourListStats stats = m_stats;
+		stats.m_skin = m_skin;
+		return stats;
+	}
+
+	void NeighbourList::ResetStats()
+	{
+		// the list sizes describe the current lists and are kept
+		m_stats.m_numUpdates = 0;
+		m_stats.m_numBuilds = 0;
+		m_stats.m_buildTime = 0.0;
+	}
+
+} // test
@@ -1,215 +1,151 @@
-
-
-// IMPORTANT: Use the correct path for your header. Assuming it's in the Public folder.
-#include "../Public/testShape.h"
-
-#undef SAFE_RELEASE
-
-#include "../external/framework/include/framework.h"
-
-// NOTE: MAX_EDGES constant is likely already defined in testShape.h. 
-// If it is, delete the line 'const int MAX_EDGES = 6;' below to avoid redefinition errors.
+#include "testShape.h"
+#include "frameworkCore.h"
 
 namespace test
 {
-	// If MAX_EDGES is NOT in the header, define it here:
-	const int MAX_EDGES = 6;
-
 	namespace helper
 	{
-		// Definition of the helper function (must be here, or static inline in the header)
-		static bool IsBehindEdge(float startX, float startY, float endX, float endY, float x, float y)
-		{
-			float nx = -(endY - startY);
-			float ny = endX - startX;
-			float dot = nx * (x - startX) + ny * (y - startY);
-			return dot < 0;
-		}
-	}
+		typedef bool (*TOverlapFunc)(float sizeA, float ax, float ay, float sizeB, float bx, float by);
 
-	// --- IShape Implementations ---
+		template< typename TSequence >
+		struct OverlapDispatch;
 
-	void IShape::Render(float x, float y, app::RenderFrame& frame) const
-	{
-		float ex[MAX_EDGES];
-		float ey[MAX_EDGES];
-
-		int numEdges = 0;
-		ComputeEdges(ex, ey, numEdges);
-
-		for (int i = 0; i < numEdges; ++i)
+		/// table of the specialized overlap tests, indexed by typeA * NUM_TYPES + typeB
+		template< int... PAIRS >
+		struct OverlapDispatch< std::integer_sequence< int, PAIRS... > >
 		{
-			const float curX = ex[i];
-			const float curY = ey[i];
+			static constexpr TOverlapFunc FUNCTIONS[sizeof...(PAIRS)] = { &shape::TestOverlap< PAIRS / shape::NUM_TYPES, PAIRS % shape::NUM_TYPES >... };
+		};
 
-			const float nextX = ex[(i + 1) % numEdges];
-			const float nextY = ey[(i + 1) % numEdges];
+		typedef OverlapDispatch< std::make_integer_sequence< int, shape::NUM_TYPES * shape::NUM_TYPES > > TOverlapDispatch;
 
-			frame.AddLine(x + curX, y + curY, x + nextX, y + nextY);
-		}
-	}
+		typedef bool (*TContainsFunc)(float size, float x, float y);
 
-	bool IShape::Contains(float x, float y) const
-	{
-		float ex[MAX_EDGES];
-		float ey[MAX_EDGES];
-
-		int numEdges = 0;
-		ComputeEdges(ex, ey, numEdges);
-
-		for (int i = 0; i < numEdges; ++i)
+		template< int TYPE >
+		static bool Contains(float size, float x, float y)
 		{
-			const float curX = ex[i];
-			const float curY = ey[i];
-
-			const float nextX = ex[(i + 1) % numEdges];
-			const float nextY = ey[(i + 1) % numEdges];
-
-			if (!helper::IsBehindEdge(curX, curY, nextX, nextY, x, y))
-				return false;
+			return shape::detail::ScaledPolygon< TYPE >(size).Contains(x, y);
 		}
 
-		return true;
-	}
-
-	bool IShape::CheckCollision(float thisShapeX, float thisShapeY, float otherShapeX, float otherShapeY, const IShape* otherShape) const
-	{
-		float ex[MAX_EDGES];
-		float ey[MAX_EDGES];
-
-		int numEdges = 0;
-		ComputeEdges(ex, ey, numEdges);
+		template< typename TSequence >
+		struct ContainsDispatch;
 
-		for (int i = 0; i < numEdges; ++i)
+		template< int... TYPES >
+		struct ContainsDispatch< std::integer_sequence< int, TYPES... > >
 		{
-			const float curX = ex[i] + thisShapeX;
-			const float curY = ey[i] + thisShapeY;
-
-			if (otherShape->Contains(curX - otherShapeX, curY - otherShapeY))
-				return true;
-		}
-
-		return false;
-	}
+			static constexpr TContainsFunc FUNCTIONS[sizeof...(TYPES)] = { &Contains< TYPES >... };
+		};
 
-	bool IShape::TestOverlap(const IShape* a, float ax, float ay, const IShape* b, float bx, float by)
-	{
-		if (a->CheckCollision(ax, ay, bx, by, b))
-			return true;
-
-		if (b->CheckCollision(bx, by, ax, ay, a))
-			return true;
-
-		return false;
-	}
-
-	// --- TriShape Implementations ---
+		typedef ContainsDispatch< std::make_integer_sequence< int, shape::NUM_TYPES > > TContainsDispatch;
 
-	TriShape::TriShape(const float size)
-		: m_size(size)
-		// FIX: Initialize m_radius member variable
-		, m_radius(size / 2.0f)
-	{
-	}
-
-	void TriShape::ComputeEdges(float* x, float* y, int& numEdges) const
-	{
-		numEdges = 3;
+		static_assert(shape::MAX_EDGES <= app::RenderOutline::MAX_POINTS, "Shape outline does not fit the render outline");
 
-		x[0] = -m_size / 2.0f;
-		y[0] = m_size / 2.0f;
-
-		x[1] = m_size / 2.0f;
-		y[1] = m_size / 2.0f;
-
-		x[2] = 0.0f;
-		y[2] = -m_size / 2.0f;
-	}
-
-	// NOTE: GetRadius should be defined inline in the header for cleaner code,
-	// but if it MUST be here, it should be defined correctly (and cannot be 
-	// defined here AND inline in the header). Assuming it's defined in the header.
-	/*
-	float TriShape::GetRadius() const
-	{
-		return m_size / 2.0f;
+		/// outlines of all shape types, registered once
+		struct ShapeOutlines
+		{
+			int m_index[shape::NUM_TYPES];
+
+			ShapeOutlines()
+			{
+				for (int type = 0; type < shape::NUM_TYPES; ++type)
+				{
+					const auto& unit = shape::GetUnitPolygon(type);
+
+					// unit polygon is in half size units, same scaling as ComputeEdges
+					app::RenderOutline outline;
+					outline.m_numPoints = unit.m_numEdges;
+					outline.m_sizeScale = 0.5f;
+					for (int i = 0; i < unit.m_numEdges; ++i)
+					{
+						outline.m_x[i] = unit.m_x[i];
+						outline.m_y[i] = unit.m_y[i];
+					}
+
+					m_index[type] = app::RenderOutlineTable::GetInstance().Register(outline);
+				}
+			}
+		};
 	}
-	*/
-
-	// --- QuadShape Implementations (Square) ---
 
-	QuadShape::QuadShape(const float size)
-		: m_size(size)
-		// FIX: Initialize m_radius member variable
-		, m_radius(size * 0.70710678f) // R = size * sqrt(2) / 2
-	{
-	}
+	// --- Inline shape geometry ---
 
-	void QuadShape::ComputeEdges(float* x, float* y, int& numEdges) const
+	namespace shape
 	{
-		numEdges = 4;
-
-		x[0] = m_size / 2.0f;
-		y[0] = m_size / 2.0f;
-
-		x[1] = m_size / 2.0f;
-		y[1] = -m_size / 2.0f;
-
-		x[2] = -m_size / 2.0f;
-		y[2] = -m_size / 2.0f;
+		float ComputeRadius(int shapeType, float size)
+		{
+			if (!IsValidType(shapeType))
+				return 0.0f;
 
-		x[3] = -m_size / 2.0f;
-		y[3] = m_size / 2.0f;
-	}
+			return size * GetUnitPolygon(shapeType).m_radiusScale;
+		}
 
-	// NOTE: GetRadius should be defined inline in the header.
-	/*
-	float QuadShape::GetRadius() const
-	{
-		return m_size * 0.70710678f; 
-	}
-	*/
+		void ComputeEdges(int shapeType, float size, float* x, float* y, int& numEdges)
+		{
+			if (!IsValidType(shapeType))
+			{
+				numEdges = 0;
+				return;
+			}
+
+			const auto& unit = GetUnitPolygon(shapeType);
+			const float halfSize = size / 2.0f;
+
+			numEdges = unit.m_numEdges;
+			for (int i = 0; i < numEdges; ++i)
+			{
+				x[i] = halfSize * unit.m_x[i];
+				y[i] = halfSize * unit.m_y[i];
+			}
+		}
 
-	// --- HexShape Implementations ---
+		int GetRenderOutline(int shapeType)
+		{
+			static const helper::ShapeOutlines outlines;
+			return IsValidType(shapeType) ? outlines.m_index[shapeType] : -1;
+		}
 
-	HexShape::HexShape(const float size)
-		: m_size(size)
-		// FIX: Initialize m_radius member variable
-		, m_radius(size / 2.0f)
-	{
-	}
+		void Render(int shapeType, float size, float x, float y, app::RenderFrame& frame)
+		{
+			const int outline = GetRenderOutline(shapeType);
+			if (outline >= 0)
+				frame.AddInstance(x, y, size, outline);
+		}
 
-	void HexShape::ComputeEdges(float* x, float* y, int& numEdges) const
-	{
-		numEdges = 6;
+		void RenderEdges(int shapeType, float size, float x, float y, app::RenderFrame& frame)
+		{
+			float ex[MAX_EDGES];
+			float ey[MAX_EDGES];
 
-		const float R = m_size / 2.0f;
+			int numEdges = 0;
+			ComputeEdges(shapeType, size, ex, ey, numEdges);
 
-		x[0] = 0.0f;
-		y[0] = R;
+			for (int i = 0; i < numEdges; ++i)
+			{
+				const float curX = ex[i];
+				const float curY = ey[i];
 
-		x[1] = R * 0.866f;
-		y[1] = R * 0.5f;
+				const float nextX = ex[(i + 1) % numEdges];
+				const float nextY = ey[(i + 1) % numEdges];
 
-		x[2] = R * 0.866f;
-		y[2] = R * -0.5f;
+				frame.AddLine(x + curX, y + curY, x + nextX, y + nextY);
+			}
+		}
 
-		x[3] = 0.0f;
-		y[3] = -R;
+		bool Contains(int shapeType, float size, float x, float y)
+		{
+			if (!IsValidType(shapeType))
+				return false;
 
-		x[4] = R * -0.866f;
-		y[4] = R * -0.5f;
+			return helper::TContainsDispatch::FUNCTIONS[shapeType](size, x, y);
+		}
 
-		x[5] = R * -0.866f;
-		y[5] = R * 0.5f;
-	}
+		bool TestOverlap(int typeA, float sizeA, float ax, float ay, int typeB, float sizeB, float bx, float by)
+		{
+			if (!IsValidType(typeA) || !IsValidType(typeB))
+				return false;
 
-	// NOTE: GetRadius should be defined inline in the header.
-	/*
-	float HexShape::GetRadius() const
-	{
-		return m_size / 2.0f;
+			return helper::TOverlapDispatch::FUNCTIONS[typeA * NUM_TYPES + typeB](sizeA, ax, ay, sizeB, bx, by);
+		}
 	}
-	*/
 
-} // test
\ No newline at end of file
+} // test
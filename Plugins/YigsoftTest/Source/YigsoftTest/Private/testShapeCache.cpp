@@ -0,0 +1,96 @@
+#include "testShapeCache.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace test
+{
+	namespace helper
+	{
+		static inline uint64_t MakeShapeKey(const int shapeType, const float size)
+		{
+			uint32_t bits;
+			memcpy(&bits, &size, sizeof(bits));
+			return ((uint64_t)(uint32_t)shapeType << 32) | bits;
+		}
+	}
+
+	const float ShapeCache::DEFAULT_QUANTUM = 1.0f / 16.0f;
+
+	ShapeCache::ShapeCache(const float quantum)
+	{
+		SetQuantum(quantum);
+	}
+
+	void ShapeCache::SetQuantum(const float quantum)
+	{
+		m_quantum = (quantum > 0.0f) ? quantum : 0.0f;
+	}
+
+	float ShapeCache::Quantize(const float size) const
+	{
+		if (m_quantum <= 0.0f)
+			return size;
+
+		// never snap down to nothing
+		const float steps = floorf(size / m_quantum + 0.5f);
+		return ((steps > 1.0f) ? steps : 1.0f) * m_quantum;
+	}
+
+	TShapeHandle ShapeCache::Intern(const int shapeType, const float size)
+	{
+		return InternExact(shapeType, Quantize(size));
+	}
+
+	TShapeHandle ShapeCache::InternExact(const int shapeType, const float quantizedSize)
+	{
+		if (!shape::IsValidType(shapeType))
+			return INVALID_SHAPE;
+
+		const uint64_t key = helper::MakeShapeKey(shapeType, quantizedSize);
+
+		const auto it = m_lookup.find(key);
+		if (it != m_lookup.end())
+			return (TShapeHandle)it->second;
+
+		if ((int)m_geometry.size() >= MAX_SHAPES)
+		{
+			fprintf(stderr, "Shape cache is full, use a larger size quantum\n");
+			return INVALID_SHAPE;
+		}
+
+		// same arithmetic as shape::detail::ScaledPolygon, the geometry is bit exact with the inline shapes
+		const auto& unit = shape::GetUnitPolygon(shapeType);
+		const float halfSize = quantizedSize / 2.0f;
+
+		ShapeGeometry geometry;
+		memset(&geometry, 0, sizeof(geometry));
+		geometry.m_type = shapeType;
+		geometry.m_numEdges = unit.m_numEdges;
+		geometry.m_size = quantizedSize;
+		geometry.m_radius = shape::ComputeRadius(shapeType, quantizedSize);
+		geometry.m_bound = halfSize * unit.m_boundScale;
+		geometry.m_mass = geometry.m_radius * geometry.m_radius;
+
+		for (int i = 0; i < unit.m_numEdges; ++i)
+		{
+			geometry.m_x[i] = halfSize * unit.m_x[i];
+			geometry.m_y[i] = halfSize * unit.m_y[i];
+			geometry.m_nx[i] = halfSize * unit.m_nx[i];
+			geometry.m_ny[i] = halfSize * unit.m_ny[i];
+		}
+
+		const int index = (int)m_geometry.size();
+		m_geometry.push_back(geometry);
+		m_lookup[key] = index;
+		return (TShapeHandle)index;
+	}
+
+	void ShapeCache::Clear()
+	{
+		m_geometry.clear();
+		m_lookup.clear();
+	}
+
+} // test
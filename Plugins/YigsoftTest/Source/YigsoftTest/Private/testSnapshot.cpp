@@ -0,0 +1,231 @@
+#include "testSnapshot.h"
+#include "mappedFile.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace test
+{
+	static_assert(sizeof(SnapshotHeader) == 128, "Snapshot header layout changed, bump the version");
+
+	namespace helper
+	{
+		static inline uint64_t AlignOffset(const uint64_t offset)
+		{
+			return (offset + SnapshotHeader::ALIGNMENT - 1) & ~(uint64_t)(SnapshotHeader::ALIGNMENT - 1);
+		}
+
+		/// bytes taken by every array of the snapshot
+		static void GetArraySizes(const SnapshotHeader& header, uint64_t* outSizes)
+		{
+			const uint64_t numBodies = header.m_numBodies;
+			const uint64_t numShapes = header.m_numShapes;
+
+			outSizes[SnapshotHeader::X] = numBodies * sizeof(float);
+			outSizes[SnapshotHeader::Y] = numBodies * sizeof(float);
+			outSizes[SnapshotHeader::VEL_X] = numBodies * sizeof(float);
+			outSizes[SnapshotHeader::VEL_Y] = numBodies * sizeof(float);
+			outSizes[SnapshotHeader::RADIUS] = numBodies * sizeof(float);
+			outSizes[SnapshotHeader::SHAPE] = numBodies * sizeof(TShapeHandle);
+			outSizes[SnapshotHeader::COLOR] = numBodies * sizeof(unsigned int);
+			outSizes[SnapshotHeader::SHAPE_TYPE] = numShapes * sizeof(int32_t);
+			outSizes[SnapshotHeader::SHAPE_SIZE] = numShapes * sizeof(float);
+		}
+
+		/// check the header of a file with given size, arrays must be aligned and inside of the file
+		static bool ValidateHeader(const SnapshotHeader& header, const uint64_t fileSize, const char* path)
+		{
+			if (header.m_magic != SnapshotHeader::MAGIC)
+			{
+				fprintf(stderr, "Snapshot '%s': not a snapshot file\n", path);
+				return false;
+			}
+
+			if (header.m_version != SnapshotHeader::VERSION || header.m_headerSize != sizeof(SnapshotHeader))
+			{
+				fprintf(stderr, "Snapshot '%s': unsupported version %u\n", path, header.m_version);
+				return false;
+			}
+
+			if (header.m_numBodies > (uint32_t)INT32_MAX || header.m_numShapes > (uint32_t)ShapeCache::MAX_SHAPES)
+			{
+				fprintf(stderr, "Snapshot '%s': invalid counts\n", path);
+				return false;
+			}
+
+			uint64_t sizes[SnapshotHeader::NUM_ARRAYS];
+			GetArraySizes(header, sizes);
+
+			for (int i = 0; i < SnapshotHeader::NUM_ARRAYS; ++i)
+			{
+				const uint64_t offset = header.m_offsets[i];
+				if ((offset % SnapshotHeader::ALIGNMENT) != 0 || offset < sizeof(SnapshotHeader) || offset > fileSize || sizes[i] > fileSize - offset)
+				{
+					fprintf(stderr, "Snapshot '%s': truncated or corrupted file\n", path);
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	bool SaveSnapshot(const char* path, const BodyStore& bodies, const SnapshotScene& scene)
+	{
+		const ShapeCache& shapes = bodies.m_shapes;
+		const int numShapes = shapes.GetNumShapes();
+
+		// only the shape keys are stored, the geometry is rebuilt on load
+		std::vector< int32_t > shapeTypes(numShapes);
+		std::vector< float > shapeSizes(numShapes);
+		for (int i = 0; i < numShapes; ++i)
+		{
+			shapeTypes[i] = shapes.Get((TShapeHandle)i).m_type;
+			shapeSizes[i] = shapes.Get((TShapeHandle)i).m_size;
+		}
+
+		SnapshotHeader header;
+		memset(&header, 0, sizeof(header));
+		header.m_magic = SnapshotHeader::MAGIC;
+		header.m_version = SnapshotHeader::VERSION;
+		header.m_headerSize = sizeof(SnapshotHeader);
+		header.m_numBodies = (uint32_t)bodies.GetNumBodies();
+		header.m_numShapes = (uint32_t)numShapes;
+		header.m_scenario = scene.m_scenario;
+		header.m_seed = scene.m_seed;
+		header.m_numSpawned = scene.m_numSpawned;
+		header.m_randomCounter = scene.m_randomCounter;
+		header.m_shapeQuantum = shapes.GetQuantum();
+
+		uint64_t sizes[SnapshotHeader::NUM_ARRAYS];
+		helper::GetArraySizes(header, sizes);
+
+		uint64_t offset = helper::AlignOffset(sizeof(SnapshotHeader));
+		for (int i = 0; i < SnapshotHeader::NUM_ARRAYS; ++i)
+		{
+			header.m_offsets[i] = offset;
+			offset = helper::AlignOffset(offset + sizes[i]);
+		}
+
+		const void* arrays[SnapshotHeader::NUM_ARRAYS];
+		arrays[SnapshotHeader::X] = bodies.m_x.data();
+		arrays[SnapshotHeader::Y] = bodies.m_y.data();
+		arrays[SnapshotHeader::VEL_X] = bodies.m_velX.data();
+		arrays[SnapshotHeader::VEL_Y] = bodies.m_velY.data();
+		arrays[SnapshotHeader::RADIUS] = bodies.m_radius.data();
+		arrays[SnapshotHeader::SHAPE] = bodies.m_shape.data();
+		arrays[SnapshotHeader::COLOR] = bodies.m_color.data();
+		arrays[SnapshotHeader::SHAPE_TYPE] = shapeTypes.data();
+		arrays[SnapshotHeader::SHAPE_SIZE] = shapeSizes.data();
+
+		FILE* f = fopen(path, "wb");
+		if (!f)
+		{
+			fprintf(stderr, "Snapshot '%s': unable to write the file\n", path);
+			return false;
+		}
+
+		static const uint8_t padding[SnapshotHeader::ALIGNMENT] = {};
+
+		bool ok = (1 == fwrite(&header, sizeof(header), 1, f));
+		uint64_t written = sizeof(header);
+		for (int i = 0; ok && i < SnapshotHeader::NUM_ARRAYS; ++i)
+		{
+			const size_t paddingSize = (size_t)(header.m_offsets[i] - written);
+			if (paddingSize)
+				ok = (paddingSize == fwrite(padding, 1, paddingSize, f));
+
+			if (ok && sizes[i])
+				ok = (1 == fwrite(arrays[i], (size_t)sizes[i], 1, f));
+
+			written = header.m_offsets[i] + sizes[i];
+		}
+
+		if (0 != fclose(f))
+			ok = false;
+
+		if (!ok)
+			fprintf(stderr, "Snapshot '%s': write failed\n", path);
+
+		return ok;
+	}
+
+	bool LoadSnapshot(const char* path, BodyStore& outBodies, SnapshotScene& outScene)
+	{
+		app::MappedFile file;
+		if (!file.Open(path))
+		{
+			fprintf(stderr, "Snapshot '%s': unable to open the file\n", path);
+			return false;
+		}
+
+		SnapshotHeader header;
+		if (file.GetSize() < sizeof(header))
+		{
+			fprintf(stderr, "Snapshot '%s': not a snapshot file\n", path);
+			return false;
+		}
+
+		memcpy(&header, file.GetData(), sizeof(header));
+		if (!helper::ValidateHeader(header, file.GetSize(), path))
+			return false;
+
+		const uint8_t* data = file.GetData();
+		const int numBodies = (int)header.m_numBodies;
+		const int numShapes = (int)header.m_numShapes;
+
+		// rebuild the shapes first, the store is not touched until everything checks out
+		const int32_t* shapeTypes = (const int32_t*)(data + header.m_offsets[SnapshotHeader::SHAPE_TYPE]);
+		const float* shapeSizes = (const float*)(data + header.m_offsets[SnapshotHeader::SHAPE_SIZE]);
+
+		ShapeCache shapes(header.m_shapeQuantum);
+		for (int i = 0; i < numShapes; ++i)
+		{
+			if (shapes.InternExact(shapeTypes[i], shapeSizes[i]) != (TShapeHandle)i)
+			{
+				fprintf(stderr, "Snapshot '%s': invalid shape %d\n", path, i);
+				return false;
+			}
+		}
+
+		const TShapeHandle* bodyShapes = (const TShapeHandle*)(data + header.m_offsets[SnapshotHeader::SHAPE]);
+		for (int i = 0; i < numBodies; ++i)
+		{
+			if (bodyShapes[i] >= numShapes)
+			{
+				fprintf(stderr, "Snapshot '%s': invalid shape of body %d\n", path, i);
+				return false;
+			}
+		}
+
+		outBodies.Truncate(0);
+		outBodies.m_shapes = std::move(shapes);
+		outBodies.Grow(numBodies);
+
+		uint64_t sizes[SnapshotHeader::NUM_ARRAYS];
+		helper::GetArraySizes(header, sizes);
+
+		void* arrays[SnapshotHeader::SHAPE_TYPE];
+		arrays[SnapshotHeader::X] = outBodies.m_x.data();
+		arrays[SnapshotHeader::Y] = outBodies.m_y.data();
+		arrays[SnapshotHeader::VEL_X] = outBodies.m_velX.data();
+		arrays[SnapshotHeader::VEL_Y] = outBodies.m_velY.data();
+		arrays[SnapshotHeader::RADIUS] = outBodies.m_radius.data();
+		arrays[SnapshotHeader::SHAPE] = outBodies.m_shape.data();
+		arrays[SnapshotHeader::COLOR] = outBodies.m_color.data();
+
+		// body arrays are stored in the store layout
+		for (int i = 0; i < SnapshotHeader::SHAPE_TYPE; ++i)
+		{
+			if (sizes[i])
+				memcpy(arrays[i], data + header.m_offsets[i], (size_t)sizes[i]);
+		}
+
+		outScene.m_scenario = header.m_scenario;
+		outScene.m_seed = header.m_seed;
+		outScene.m_numSpawned = header.m_numSpawned;
+		outScene.m_randomCounter = header.m_randomCounter;
+		return true;
+	}
+
+} // test
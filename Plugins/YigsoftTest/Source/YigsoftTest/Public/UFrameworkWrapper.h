@@ -2,15 +2,23 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h" // Required for UActorComponent base class
+#include "Components/LineBatchComponent.h" // FBatchedLine is held by value
+#include "HAL/CriticalSection.h"
+#include "Tasks/Task.h"
+#include "Templates/Function.h"
+#include <vector>
+#include "frameworkCore.h" // RenderVertex is held by value
 #include "UFrameworkWrapper.generated.h" 
 
 // Forward Declarations for Unreal types used in the UI function
 class UCanvas;
 class APlayerController;
+class ULineBatchComponent;
 
 // --- FORWARD DECLARATIONS FOR EXTERNAL FRAMEWORK ---
 namespace app {
 	class RenderFrame;
+	class RenderFramePool;
 	class Framework;
 	struct RenderString;
 }
@@ -36,10 +44,18 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Framework")
 	void HandleKeyInput(int32 KeyCode);
 
+	// Positions of the bodies after the last collected tick, safe to read while the next tick runs
+	UFUNCTION(BlueprintCallable, Category = "Framework")
+	void GetFrameworkBodyPositions(TArray<FVector2D>& OutPositions) const;
+
+	// Blocks until the tick running on the task is done, the app can be used directly afterwards
+	void WaitForTick();
+
 	// --- Static Accessor for the active Framework instance ---
 	static UFrameworkWrapper* GetFrameworkWrapperInstance();
 
 	// --- Accessor for the external App (used for data, like GetRenderFrame) ---
+	// NOTE: in the async mode the app belongs to the tick task, call WaitForTick() before touching it
 	test::App* GetFrameworkApp() const { return FrameworkApp; }
 
 	// --- Custom UI Draw Hook (Requires an AHUD class to call this) ---
@@ -54,9 +70,56 @@ protected:
 public:
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisFunction) override;
 
+	// Run the simulation on a worker task: the tick started in one frame is collected at the start of the next one,
+	// so the game thread only hands the work over and the drawn frame lags the simulation by one tick
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Framework")
+	bool bAsyncTick;
+
 private:
+	typedef TUniqueFunction<void(test::App&)> FFrameworkCommand;
+
+	// Tick, render and read back the bodies, runs on the task in the async mode
+	void RunTick(float DeltaTime, app::RenderFrame& Frame);
+
+	// Waits for the pending tick and makes its frame and bodies the current ones
+	void CollectTick();
+
+	// Runs the command right away, or queues it for the next tick while the app is busy
+	void ExecuteCommand(FFrameworkCommand&& Command);
+	void RunQueuedCommands();
+
+	// Converts the frame's instances and lines into batched lines, runs on the task in the async mode
+	void BuildFrameLines(const app::RenderFrame& Frame, TArray<FBatchedLine>& OutLines);
+
 	test::App* FrameworkApp;
 
+	UPROPERTY(Transient)
+	ULineBatchComponent* LineBatcher;
+
+	// Outline vertices of the frame's instances, reused by every tick (only touched by the tick)
+	std::vector<app::RenderVertex> ExpandedVertices;
+
+	// Frames are recycled between ticks, the last one is kept for DrawUI
+	app::RenderFramePool* FramePool;
+	app::RenderFrame* LastFrame;
+
+	// Tick in flight and the frame it fills, only touched on the game thread
+	UE::Tasks::FTask PendingTick;
+	app::RenderFrame* PendingFrame;
+
+	// Blueprint calls made while a tick runs
+	FCriticalSection CommandLock;
+	TArray<FFrameworkCommand> QueuedCommands;
+
+	// Body positions of the current frame and of the pending one
+	std::vector<float> BodyX;
+	std::vector<float> BodyY;
+	std::vector<float> PendingBodyX;
+	std::vector<float> PendingBodyY;
+
+	// Lines of the pending frame, swapped with the line batch's array when the tick is collected
+	TArray<FBatchedLine> PendingLines;
+
 	// --- NEW: Static Instance Pointer ---
 	static UFrameworkWrapper* Instance;
 };
\ No newline at end of file
@@ -1,9 +1,13 @@
 #pragma once
 
-#include "../external/framework/include/app.h"
-#include "../external/framework/include/physicsTestApp.h"
+#include "app.h"
+#include "physicsTestApp.h"
 #include <vector>
-#include "framework.h"
+#include "frameworkCore.h"
+#include "testGrid.h"
+#include "testNeighbourList.h"
+#include "testBodyStore.h"
+#include "jobSystem.h"
 
 namespace test
 {
@@ -12,7 +16,20 @@ namespace test
 	extern const float BodySpeed;
 
 
-	class Body;
+	/// how the bodies find their neighbours
+	enum class Broadphase
+	{
+		BruteForce,	// every body visits every other body
+		Grid,		// bodies visit only the neighbouring grid cells
+		NeighbourLists,	// bodies visit their Verlet neighbour lists, rebuilt only every few ticks
+	};
+
+	/// how the overlapping bodies are pushed apart
+	enum class CollisionSolver
+	{
+		Sequential,	// Gauss-Seidel, every correction is applied right away, serial
+		Jacobi,		// corrections from the positions at the start of the pass, parallel and independent of the thread count
+	};
 
 	class App : public PhysicsTestApp
 	{
@@ -29,13 +46,64 @@ namespace test
 		virtual int GetNumBodies() const override;
 		virtual void AddBody(int shapeType, float x, float y, float r) override;
 		virtual void RemoveBodies(int numObjects) override;
+		virtual void SpawnBodies(const BodySpawn* spawns, int numSpawns) override;
+		virtual bool GetBodyPositions(std::vector< float >& outX, std::vector< float >& outY) const override;
+
+		/// view of all body arrays, valid until bodies are added or removed
+		BodyView GetBodies() const;
+
+		/// switch between the grid and brute-force neighbour search (for A/B testing, results are the same)
+		void SetBroadphase(Broadphase broadphase) { m_broadphase = broadphase; }
+		Broadphase GetBroadphase() const { return m_broadphase; }
+
+		/// switch the collision solver, the two give different (but each reproducible) results
+		void SetCollisionSolver(CollisionSolver solver) { m_collisionSolver = solver; }
+		CollisionSolver GetCollisionSolver() const { return m_collisionSolver; }
+
+		/// skin of the neighbour lists, trades list length for rebuild frequency
+		void SetNeighbourSkin(float skin) { m_neighbourLists.SetSkin(skin); }
+		NeighbourListStats GetNeighbourListStats() const { return m_neighbourLists.GetStats(); }
 
-		const std::vector< Body* >& GetBodies() const;
+		/// save bodies and scene state to a binary snapshot, see testSnapshot.h
+		bool SaveSnapshot(const char* path) const;
+
+		/// replace the scene with the one from a snapshot, returns false (scene unchanged) on error
+		bool LoadSnapshot(const char* path);
 
 	private:
 		// Helper function to clean up scene
 		void ClearAllBodies();
 
-		std::vector< Body* > m_bodies;
+		// Rebuilds the broadphase grid from current body positions
+		void BuildGrid();
+
+		// Rebuilds the neighbour lists if the bodies moved too far
+		void UpdateNeighbourLists();
+
+		// Pushes the overlapping bodies apart, the grid is null unless the grid broadphase is used
+		void SolveCollisions(SpatialGrid* grid, SimCounters& counters);
+
+		// Jacobi pass of SolveCollisions
+		void SolveCollisionsJacobi(const SpatialGrid* grid);
+
+		// Keeps the positions from before the tick for render interpolation
+		void StorePreviousPositions();
+
+		BodyStore m_bodies;
+
+		app::JobSystem*			m_jobSystem; // shared pool from the framework or m_inlineJobSystem
+		app::JobSystem			m_inlineJobSystem; // single threaded fallback
+
+		Broadphase				m_broadphase;
+		SpatialGrid				m_grid;
+		NeighbourList			m_neighbourLists;
+		std::vector< int >		m_collisionScratch;
+		CollisionSolver			m_collisionSolver;
+		std::vector< float >	m_correctionX; // summed push of every body (Jacobi)
+		std::vector< float >	m_correctionY;
+		std::vector< SimCounters >	m_workerCounters; // attraction counters of each worker
+
+		std::vector< float >	m_prevX; // positions before the last tick, may be shorter than the body list
+		std::vector< float >	m_prevY;
 	};
 }
\ No newline at end of file
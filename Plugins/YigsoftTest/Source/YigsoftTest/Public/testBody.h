@@ -1,15 +1,9 @@
-
-
 #pragma once
 
 // FIX: Ensured no trailing invisible characters exist after this line
 #include "testShape.h"
-
-namespace std {
-	// This allows the compiler to see the reference type without the definition
-	template <typename T, typename Allocator>
-	class vector;
-}
+#include "testBodyStore.h"
+#include "simCounters.h"
 
 namespace app
 {
@@ -19,61 +13,113 @@ namespace app
 
 namespace test
 {
-	class Body;
-
-	template <typename T>
-	class vector;
+	class SpatialGrid;
+	class NeighbourList;
 
 	extern const float BodySpeed;
 	extern const float AttractorRange;
 	extern const float Gravitation;
 
+	/// Lightweight handle to a single body in the body store
+	/// The state lives in the store arrays, the handle only carries the simulation logic.
+	/// Work done by the updates is added to the counters if given, they must not be shared between threads.
 	class Body
 	{
 	public:
-		Body(IShape* shape, const unsigned int color, float x, float y, int shapeTypeID);
-		// Declaring the destructor
-		~Body();
-		int GetShapeTypeID() const { return m_shapeTypeID; }
+		Body(BodyStore& store, int index, SimCounters* counters = nullptr)
+			: m_store(store)
+			, m_index(index)
+			, m_counters(counters)
+		{}
+
+		int GetShapeTypeID() const { return m_store.m_shapes.Get(m_store.m_shape[m_index]).m_type; }
+
+		/// steer body towards its attractor, with a grid only the neighbouring cells are visited
+		/// reads other bodies and writes only this body's velocity, safe to run in parallel
+		void UpdateAttraction(const SpatialGrid* grid, int currentScenario);
+
+		/// same as above, only the bodies from the neighbour list are visited
+		void UpdateAttraction(const NeighbourList& lists, int currentScenario);
+
+		/// search of UpdateAttraction without the velocity change, outputs the direction to the attractor (zero if
+		/// there is none) for ApplyAttraction, returns true if one was found
+		bool FindAttraction(const SpatialGrid* grid, int currentScenario, float& outDirX, float& outDirY) const;
+		bool FindAttraction(const NeighbourList& lists, int currentScenario, float& outDirX, float& outDirY) const;
+
+		/// apply directions from FindAttraction to bodies [first, first + count) at once, see kernels::ApplyAttraction
+		static void ApplyAttraction(BodyStore& store, int first, int count, const float* dirX, const float* dirY);
+
+		/// push overlapping bodies apart, with a grid only the neighbouring cells are visited
+		/// writes other bodies, must run serially, scratch is a temporary buffer for the collision candidates
+		/// The moved bodies are reported to the grid, so the same grid keeps working for the rest of the pass.
+		void UpdateCollision(SpatialGrid* grid, std::vector< int >& scratch);
 
-		void Update(const std::vector< Body* >& otherBodies, int currentScenario);
+		/// same as above, only the bodies from the neighbour list are visited
+		void UpdateCollision(NeighbourList& lists, std::vector< int >& scratch);
 
-		void Render(app::RenderFrame& frame);
-		float GetRadius() const;
+		/// Jacobi variant of UpdateCollision, overlaps are resolved from the positions at the start of the pass
+		/// Writes only this body's velocity, the push of every overlap is added to outCorrectionX/Y to be applied once
+		/// all bodies are done. Safe to run in parallel, the result does not depend on the body order.
+		void AccumulateCollision(const SpatialGrid* grid, std::vector< int >& scratch, float& outCorrectionX, float& outCorrectionY);
+		void AccumulateCollision(const NeighbourList& lists, std::vector< int >& scratch, float& outCorrectionX, float& outCorrectionY);
+
+		float GetRadius() const { return m_store.m_radius[m_index]; }
 		void Integrate(float deltaTime);
 
-		float GetX() const { return m_x; }
-		float GetY() const { return m_y; }
-		const IShape* GetShape() const { return m_shape; }
-		unsigned int GetColor() const { return m_color; }
+		/// integrate and wrap bodies [first, first + count) at once, same results as Integrate of each of them
+		static void Integrate(BodyStore& store, int first, int count, float deltaTime);
+
+		/// grid range that covers both attraction and collision for given largest body bound (BodyStore::GetMaxBound)
+		/// and skin, the collision candidates are gathered within the skin and the bodies escape after moving by it
+		static float GetInteractionRange(float maxBound, float skin);
+
+		/// distance within which other bodies attract
+		static float GetAttractionRange();
+
+		float GetX() const { return m_store.m_x[m_index]; }
+		float GetY() const { return m_store.m_y[m_index]; }
+		unsigned int GetColor() const { return m_store.m_color[m_index]; }
 
 	private:
 		// Finds the direction to the strongest attractor
-		bool FindAttractor(const std::vector< Body* >& otherBodies, int currentScenario, float& outDirX, float& outDirY) const;
+		bool FindAttractor(int currentScenario, float& outDirX, float& outDirY) const;
+		bool FindAttractor(const SpatialGrid& grid, int currentScenario, float& outDirX, float& outDirY) const;
+		bool FindAttractor(const NeighbourList& lists, int currentScenario, float& outDirX, float& outDirY) const;
+
+		// Is the other body an attractor for this one, outputs the offset to it
+		bool IsAttractor(int otherIndex, bool requiresSameShapeAttraction, float& outDx, float& outDy) const;
 
 		// Calculates the acceleration based on the direction vector
 		void SolveAttraction(float dirX, float dirY);
-		void SolveCollision(const std::vector< Body* >& otherBodies);
-		void WrapAround();
+		void SolveCollision();
+		void SolveCollision(SpatialGrid& grid, std::vector< int >& scratch);
+		void SolveCollision(NeighbourList& lists, std::vector< int >& scratch);
 
-	public:
-		IShape* m_shape;
-		unsigned int m_color;
+		// Gathers the bodies from firstIndex on that can touch this one before it moves by the margin, in ascending order
+		void GatherCandidates(const SpatialGrid& grid, int firstIndex, std::vector< int >& outCandidates) const;
+		void GatherCandidates(const NeighbourList& lists, int firstIndex, std::vector< int >& outCandidates) const;
+		void GatherAllCandidates(std::vector< int >& outCandidates) const;
+
+
+		// Resolves collisions with the candidates, they must be in ascending order, returns the number of resolved
+		// candidates, less than all of them if this body moved half of the margin (the rest must be gathered again)
+		int ResolveCandidates(const std::vector< int >& candidates, float margin);
 
-		// Position
-		float m_x;
-		float m_y;
+		// Sums the responses to all overlaps with the candidates without moving any body (Jacobi)
+		void AccumulateCandidates(const std::vector< int >& candidates, float& outCorrectionX, float& outCorrectionY);
 
-		// Velocity
-		float m_velX;
-		float m_velY;
+		// Pushes this and the other body apart if they overlap
+		void ResolveCollision(int otherIndex);
 
-		// Shape Type ID (for Scenario 2 grouping)
-		int m_shapeTypeID;
+		// Applies the correction for an already detected overlap, returns true if the positions changed
+		bool ApplyCollision(int otherIndex);
 
-		// Required physics state variables for Update/Integrate
-		float m_accelX; // Acceleration X
-		float m_accelY; // Acceleration Y
-		float m_mass;   // Mass (calculated from shape->getMass())
+		// Push of this body (the other one gets the opposite) and the repulsion of its velocity for an overlap,
+		// returns true if the bounding circles penetrate, the push is zero otherwise
+		bool ComputeCollision(int otherIndex, float& outCorrectionX, float& outCorrectionY, float& outRepulsionX, float& outRepulsionY) const;
+
+		BodyStore&	m_store;
+		int			m_index;
+		SimCounters*	m_counters;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "testShapeCache.h"
+
+#include <vector>
+
+namespace test
+{
+	/// Read-only view of the body arrays, valid until the store is modified
+	struct BodyView
+	{
+		int						m_numBodies;
+
+		const float*			m_x;
+		const float*			m_y;
+		const float*			m_velX;
+		const float*			m_velY;
+		const float*			m_radius;
+		const TShapeHandle*		m_shape;
+		const unsigned int*		m_color;
+
+		const ShapeGeometry*	m_geometry; // indexed by the shape handle
+	};
+
+	/// Contiguous structure-of-arrays storage of all bodies
+	/// Bodies only hold a handle of their shape, the geometry is interned in the shape cache and shared.
+	class BodyStore
+	{
+	public:
+		BodyStore();
+
+		inline int GetNumBodies() const { return (int)m_x.size(); }
+
+		/// reserve memory for given number of bodies
+		void Reserve(const int numBodies);
+
+		/// append body, returns its index (or -1 for unknown shape type)
+		/// The size is snapped to the quantum of the shape cache.
+		int Add(const int shapeType, const float size, const unsigned int color, const float x, const float y, const float velX, const float velY);
+
+		/// append given number of uninitialized bodies for bulk filling, returns index of the first one
+		int Grow(const int numBodies);
+
+		/// drop bodies past given count (no memory is released), dropping all bodies also forgets the shapes
+		void Truncate(const int numBodies);
+
+		/// get view for iterating the bodies
+		BodyView GetView() const;
+
+		/// largest distance of a vertex from the body center over all bodies, the broadphases are sized by it
+		float GetMaxBound() const;
+
+		// Position
+		std::vector< float >		m_x;
+		std::vector< float >		m_y;
+
+		// Velocity
+		std::vector< float >		m_velX;
+		std::vector< float >		m_velY;
+
+		// Shape
+		std::vector< float >		m_radius; // copy of the shape radius for the broadphase
+		std::vector< TShapeHandle >	m_shape;
+
+		std::vector< unsigned int >	m_color;
+
+		ShapeCache					m_shapes;
+	};
+
+} // test
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <vector>
+
+namespace test
+{
+	/// Uniform grid broadphase over the simulation area
+	/// Rebuilt once per tick, each cell lists body indices in ascending order so the
+	/// queries can reproduce the visiting order of the brute-force loops.
+	/// Bodies moved after the build (collision corrections) must be reported with UpdateBody, the ones that moved
+	/// more than the skin are escaped and visited by every query, so no pair is missed however far they get pushed.
+	class SpatialGrid
+	{
+	public:
+		SpatialGrid();
+
+		/// rebuild the grid, range is the largest query distance and skin the distance bodies may move before they
+		/// escape, the range must cover the queries of the moved bodies plus the skin (see Body::GetInteractionRange)
+		void Build(const float* x, const float* y, const int numBodies, const float range, const float skin);
+
+		/// body moved to given position since the build
+		void UpdateBody(const int index, const float x, const float y);
+
+		/// did any body escape since the build
+		inline bool HasEscaped() const { return !m_escaped.empty(); }
+
+		/// size of single cell
+		inline float GetCellSize() const { return m_cellSize; }
+
+		/// distance bodies may move after the build and still be found in their cell
+		inline float GetSkin() const { return m_skin; }
+
+		/// visit the 3x3 block of cells around given position, fn( const int* indices, const int count )
+		/// The escaped bodies come last as one more sorted run, they may be visited twice.
+		/// NOTE: the block does not wrap around the world edges, the solver does not interact across them
+		template< typename Fn >
+		inline void ForEachNeighbourCell(const float x, const float y, Fn&& fn) const
+		{
+			int cellX = 0;
+			int cellY = 0;
+			GetCell(x, y, cellX, cellY);
+
+			const int minX = (cellX > 0) ? cellX - 1 : 0;
+			const int maxX = (cellX < m_numCellsX - 1) ? cellX + 1 : m_numCellsX - 1;
+			const int minY = (cellY > 0) ? cellY - 1 : 0;
+			const int maxY = (cellY < m_numCellsY - 1) ? cellY + 1 : m_numCellsY - 1;
+
+			for (int cy = minY; cy <= maxY; ++cy)
+			{
+				for (int cx = minX; cx <= maxX; ++cx)
+				{
+					const int cell = cx + cy * m_numCellsX;
+					const int start = m_cellStart[cell];
+					const int count = m_cellStart[cell + 1] - start;
+					if (count)
+						fn(m_cellIndices.data() + start, count);
+				}
+			}
+
+			if (!m_escaped.empty())
+				fn(m_escaped.data(), (int)m_escaped.size());
+		}
+
+	private:
+		/// get cell for given position, positions outside the world are clamped to the border cells
+		void GetCell(const float x, const float y, int& outCellX, int& outCellY) const;
+
+		float				m_cellSize;
+		float				m_invCellSize;
+		float				m_skin;
+
+		int					m_numCellsX;
+		int					m_numCellsY;
+
+		std::vector< int >	m_cellStart; // prefix sum of cell sizes, numCells+1 entries
+		std::vector< int >	m_cellIndices; // body indices sorted by cell
+		std::vector< int >	m_bodyCells; // cell of each body, temporary
+		std::vector< int >	m_writePos; // scatter cursor per cell, temporary
+
+		std::vector< float >	m_buildX; // positions at the build, NaN once escaped
+		std::vector< float >	m_buildY;
+		std::vector< int >		m_escaped; // sorted
+	};
+
+} // test
@@ -0,0 +1,48 @@
+#pragma once
+
+namespace test
+{
+	/// instruction sets of the batch kernels, from the slowest
+	enum class SimdLevel
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+		AVX512,
+	};
+
+	/// constants of the integration step
+	struct IntegrateParams
+	{
+		float	m_deltaTime;
+		float	m_speed; // bodies move at constant speed in the direction of their velocity
+		float	m_width; // positions wrap around [0, width] x [0, height]
+		float	m_height;
+	};
+
+	/// Batch kernels over the body store arrays
+	/// The variant is picked on the first use from CPUID (and the OS support of the wider registers). All variants
+	/// give the same results bit for bit: they use the same correctly rounded operations (no rsqrt, no FMA) in the
+	/// same order as the scalar code, so switching the level never changes the simulation.
+	namespace kernels
+	{
+		/// best level supported by the CPU and the OS
+		SimdLevel GetSupportedLevel();
+
+		/// level the kernels run with
+		SimdLevel GetLevel();
+
+		/// force a level (for A/B testing), clamped to the supported one, returns the level in use
+		/// NOTE: not thread safe, call it while no kernel is running
+		SimdLevel SetLevel(const SimdLevel level);
+
+		const char* GetLevelName(const SimdLevel level);
+
+		/// normalize the velocities, move the bodies and wrap them around the area
+		void Integrate(float* x, float* y, float* velX, float* velY, const int count, const IntegrateParams& params);
+
+		/// add direction * gravitation to the velocities, bodies with a zero direction (no attractor) are left untouched
+		void ApplyAttraction(float* velX, float* velY, const float* dirX, const float* dirY, const int count, const float gravitation);
+	}
+
+} // test
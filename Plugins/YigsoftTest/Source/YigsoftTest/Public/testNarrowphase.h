@@ -0,0 +1,43 @@
+#pragma once
+
+#include "testShapeCache.h"
+
+namespace test
+{
+	/// candidate pair for the batched narrowphase, indices into the shape arrays
+	struct OverlapPair
+	{
+		int		m_a;
+		int		m_b;
+	};
+
+	/// shapes in structure-of-arrays layout (usually straight from the body store)
+	struct ShapeArrays
+	{
+		const TShapeHandle*		m_shape;
+		const ShapeGeometry*	m_geometry; // indexed by the shape handle
+		const float*			m_x;
+		const float*			m_y;
+	};
+
+	namespace shape
+	{
+		/// bounding circle reject of the overlap tests, the scale leaves some room for rounding so no real overlap is dropped
+		const float BOUND_SCALE = 1.001f;
+
+		/// distance of the centers from which shapes with given bounds (ShapeGeometry::m_bound) never overlap
+		inline float GetOverlapReach(const float boundA, const float boundB)
+		{
+			return (boundA + boundB) * BOUND_SCALE;
+		}
+
+		/// number of pairs tested at once by the SIMD path of the kernel level in use (1 if there is none)
+		int GetOverlapBatchWidth();
+
+		/// test list of candidate pairs, writes true to outOverlaps for the overlapping ones
+		/// Pairs are rejected on their bounding circles first, the rest runs the same point-in-polygon
+		/// test as shape::TestOverlap with the same arithmetic, so the decisions are identical.
+		void TestOverlapBatch(const ShapeArrays& shapes, const OverlapPair* pairs, const int numPairs, bool* outOverlaps);
+	}
+
+} // test
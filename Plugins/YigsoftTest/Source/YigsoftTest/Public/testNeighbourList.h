@@ -0,0 +1,155 @@
+#pragma once
+
+#include "testBodyStore.h"
+
+#include <vector>
+
+namespace app
+{
+	class JobSystem;
+}
+
+namespace test
+{
+	/// rebuild statistics of the neighbour lists, used to tune the skin
+	struct NeighbourListStats
+	{
+		int			m_numUpdates; // ticks checked
+		int			m_numBuilds; // ticks that had to rebuild
+		int			m_numEntries; // neighbours in the current attraction lists
+		int			m_numCollisionEntries; // neighbours in the current collision lists
+		int			m_maxNeighbours; // longest collision list
+		float		m_skin;
+		float		m_maxDisplacement; // furthest any body moved since the build, at the last check
+		double		m_buildTime; // total seconds spent building
+	};
+
+	/// Verlet neighbour lists, per body list of everything within the interaction range plus a skin
+	/// Each body has an attraction and a collision list. The lists stay valid until some body moves more than
+	/// half of the skin, so they are rebuilt only every few ticks. Lists are in compressed sparse row layout,
+	/// each one sorted by body index so iterating it visits the bodies in the same order as the brute-force loops.
+	/// Distances use the minimum image of the wrapping world, a body that wraps around keeps its neighbours
+	/// and does not force a rebuild. The lists are a superset, users still filter by the actual distance.
+	/// Bodies moved by the collision corrections must be reported with UpdateBody, the ones that got too far for the
+	/// lists to cover them are escaped: every collision query visits them and their own queries visit all bodies.
+	class NeighbourList
+	{
+	public:
+		static const float DEFAULT_SKIN;
+
+		NeighbourList();
+
+		/// extra distance on top of the interaction range, larger skin means longer lists but fewer rebuilds
+		void SetSkin(const float skin);
+		inline float GetSkin() const { return m_skin; }
+
+		/// force rebuild on the next update (bodies were added or removed)
+		inline void Invalidate() { m_valid = false; }
+
+		/// rebuild the lists if they are stale, margin is the extra distance bodies may still move during
+		/// the collisions (corrections), returns true if rebuilt
+		bool Update(const BodyView& bodies, const float attractionRange, const float collisionRange, const float margin, app::JobSystem& jobSystem);
+
+		/// extra distance the collision candidates are gathered with, same meaning as SpatialGrid::GetSkin
+		inline float GetMargin() const { return m_margin; }
+
+		/// body moved to given position during the collisions
+		void UpdateBody(const int index, const float x, const float y);
+
+		/// did given body move too far for the lists since the build
+		inline bool IsEscaped(const int index) const { return m_isEscaped[index] != 0; }
+
+		/// sorted escaped bodies
+		inline const int* GetEscaped(int& outCount) const
+		{
+			outCount = (int)m_escaped.size();
+			return m_escaped.data();
+		}
+
+		/// sorted attraction candidates of given body (without the body itself)
+		/// Only the first attractor in body order is ever used, so the list ends with the first body that stays
+		/// an attractor of the same shape for as long as the list is valid.
+		inline const int* GetNeighbours(const int index, int& outCount) const
+		{
+			const int start = m_offsets[index];
+			outCount = m_offsets[index + 1] - start;
+			return m_neighbours.data() + start;
+		}
+
+		/// sorted neighbours within the collision range of given body (without the body itself)
+		inline const int* GetCollisionNeighbours(const int index, int& outCount) const
+		{
+			const int start = m_collisionOffsets[index];
+			outCount = m_collisionOffsets[index + 1] - start;
+			return m_collisionNeighbours.data() + start;
+		}
+
+		NeighbourListStats GetStats() const;
+		void ResetStats();
+
+	private:
+		/// rows of a block of bodies, built in parallel and then copied to the final lists
+		struct Block
+		{
+			std::vector< int >	m_neighbours;
+			std::vector< int >	m_collisionNeighbours;
+			std::vector< int >	m_mergeScratch;
+		};
+
+		/// bodies binned into cells that tile the wrapping world, ascending body order in each cell
+		struct PeriodicCells
+		{
+			PeriodicCells();
+
+			/// rebuild for given smallest cell size
+			void Build(const BodyView& bodies, const float minCellSize);
+
+			/// cells around the one of given body (3x3 block, less if the world is only a few cells wide), returns count
+			int GetNeighbourCells(const int body, int* outCells) const;
+
+			int					m_numCellsX;
+			int					m_numCellsY;
+			float				m_invCellWidth;
+			float				m_invCellHeight;
+
+			std::vector< int >	m_cellStart; // prefix sum of cell sizes, numCells+1 entries
+			std::vector< int >	m_cellIndices; // body indices sorted by cell
+			std::vector< int >	m_bodyCells; // cell of each body
+		};
+
+		/// largest distance any body moved since the build
+		float GetMaxDisplacement(const BodyView& bodies, app::JobSystem& jobSystem);
+
+		void Build(const BodyView& bodies, app::JobSystem& jobSystem);
+
+		/// append sorted rows of given body
+		void GatherNeighbours(const int body, const BodyView& bodies, Block& outRows) const;
+		void GatherCollisionNeighbours(const int body, const BodyView& bodies, Block& outRows) const;
+
+		float				m_skin;
+		float				m_margin;
+		float				m_attractionRange;
+		float				m_cutoff; // attraction range + skin at the build
+		float				m_collisionCutoff; // collision range + 2 * margin + skin at the build
+		bool				m_valid;
+
+		PeriodicCells		m_cells; // sized for the attraction
+		PeriodicCells		m_collisionCells; // sized for the collisions
+
+		std::vector< int >	m_offsets; // numBodies + 1 entries
+		std::vector< int >	m_neighbours;
+		std::vector< int >	m_collisionOffsets;
+		std::vector< int >	m_collisionNeighbours;
+		std::vector< Block >	m_blocks;
+
+		std::vector< float >	m_buildX; // positions at the build
+		std::vector< float >	m_buildY;
+		std::vector< float >	m_workerDisplacement;
+
+		std::vector< int >		m_escaped;
+		std::vector< char >		m_isEscaped;
+
+		NeighbourListStats	m_stats;
+	};
+
+} // test
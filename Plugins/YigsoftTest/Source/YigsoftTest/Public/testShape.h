@@ -1,99 +1,276 @@
 #pragma once
 
 // Keep the includes for the framework types needed by the declarations
-#include "../external/framework/include/app.h"
+#include "app.h"
+
+#include <utility>
 
 
 namespace test
 {
-	// Define the constant here, or it can be a static const in IShape, 
-	// but putting it here is simplest if it's used globally in the namespace.
-	const int MAX_EDGES_ASSUMED = 6;
+	/// Shape geometry described inline by shape type (0 - tri, 1 - quad, 2 - hex) and size
+	/// Used by the body store so bodies do not need an allocated shape object.
+	namespace shape
+	{
+		/// most edges a shape can have
+		const int MAX_EDGES = 6;
 
+		/// Compile time description of a convex polygon, vertices are in units of half of the size
+		/// Adding a new polygon means adding a specialization here and bumping NUM_TYPES, the tables
+		/// and the pair dispatch are generated from it.
+		template< int TYPE >
+		struct ShapeTraits;
 
-	class IShape
-	{
-	public:
-		IShape() {};
-		virtual ~IShape() {};
+		template<>
+		struct ShapeTraits< 0 > // triangle
+		{
+			static constexpr int NUM_EDGES = 3;
+			static constexpr float RADIUS_SCALE = 0.5f;
+			static constexpr float UNIT_X[NUM_EDGES] = { -1.0f, 1.0f, 0.0f };
+			static constexpr float UNIT_Y[NUM_EDGES] = { 1.0f, 1.0f, -1.0f };
+		};
 
-		virtual float GetRadius() const = 0;
+		template<>
+		struct ShapeTraits< 1 > // quad
+		{
+			static constexpr int NUM_EDGES = 4;
+			static constexpr float RADIUS_SCALE = 0.70710678f; // R = size * sqrt(2) / 2
+			static constexpr float UNIT_X[NUM_EDGES] = { 1.0f, 1.0f, -1.0f, -1.0f };
+			static constexpr float UNIT_Y[NUM_EDGES] = { 1.0f, -1.0f, -1.0f, 1.0f };
+		};
 
-		// CRITICAL FIX: The Body constructor requires this virtual function.
-		virtual float getMass() const = 0;
+		template<>
+		struct ShapeTraits< 2 > // hex
+		{
+			static constexpr int NUM_EDGES = 6;
+			static constexpr float RADIUS_SCALE = 0.5f;
+			static constexpr float UNIT_X[NUM_EDGES] = { 0.0f, 0.866f, 0.866f, 0.0f, -0.866f, -0.866f };
+			static constexpr float UNIT_Y[NUM_EDGES] = { 1.0f, 0.5f, -0.5f, -1.0f, -0.5f, 0.5f };
+		};
 
-		/// Render shape at given position
-		void Render(float x, float y, app::RenderFrame& frame) const; // DECLARATION ONLY
+		/// number of shape types with traits
+		const int NUM_TYPES = 3;
 
-		/// Is given point inside the shape ?
-		bool Contains(float x, float y) const; // DECLARATION ONLY
+		/// Unit polygon with precomputed edge normals, unused slots are zero
+		/// The normal of edge i points inside, (-(y[i+1] - y[i]), x[i+1] - x[i]). Scaling it by the half size
+		/// gives the same bits as computing it from the scaled vertices for the shapes above.
+		struct UnitPolygon
+		{
+			int		m_numEdges;
+			float	m_x[MAX_EDGES];
+			float	m_y[MAX_EDGES];
+			float	m_nx[MAX_EDGES];
+			float	m_ny[MAX_EDGES];
+			float	m_radiusScale; // radius = size * scale
+			float	m_boundScale; // distance of the furthest vertex = half size * scale
+		};
 
-		/// Is this shape overlapping with the other shape ? (half of the test)
-		bool CheckCollision(float thisShapeX, float thisShapeY, float otherShapeX, float otherShapeY, const IShape* otherShape) const; // DECLARATION ONLY
+		namespace detail
+		{
+			constexpr float Sqrt(const float value)
+			{
+				double guess = value > 1.0f ? (double)value : 1.0;
+				for (int i = 0; i < 32; ++i)
+					guess = 0.5 * (guess + (double)value / guess);
+				return (float)guess;
+			}
 
-		/// are two shapes overlapping
-		static bool TestOverlap(const IShape* a, float ax, float ay, const IShape* b, float bx, float by); // DECLARATION ONLY
+			template< int TYPE >
+			constexpr UnitPolygon MakeUnitPolygon()
+			{
+				typedef ShapeTraits< TYPE > Traits;
+				static_assert(Traits::NUM_EDGES >= 3 && Traits::NUM_EDGES <= MAX_EDGES, "Unsupported number of edges");
 
-		/// get assigned type of this shape
-		virtual int GetType() const = 0;
+				UnitPolygon polygon = {};
+				polygon.m_numEdges = Traits::NUM_EDGES;
+				polygon.m_radiusScale = Traits::RADIUS_SCALE;
 
-		// -----------------------------------------------------------------
-		// FIX IMPLEMENTED: Moved to public access
-		// This function is needed by UFrameworkWrapper for debug drawing.
-		// -----------------------------------------------------------------
-		virtual void ComputeEdges(float* x, float* y, int& numEdges) const = 0;
+				float boundSq = 0.0f;
+				for (int i = 0; i < Traits::NUM_EDGES; ++i)
+				{
+					const int next = (i + 1) % Traits::NUM_EDGES;
 
-	private:
-		// Move this if it was intended to be private to IShape
-		// static const int MAX_EDGES = 6; 
-	};
+					polygon.m_x[i] = Traits::UNIT_X[i];
+					polygon.m_y[i] = Traits::UNIT_Y[i];
+					polygon.m_nx[i] = -(Traits::UNIT_Y[next] - Traits::UNIT_Y[i]);
+					polygon.m_ny[i] = Traits::UNIT_X[next] - Traits::UNIT_X[i];
 
-	// --- Concrete Shapes ---
+					const float distSq = Traits::UNIT_X[i] * Traits::UNIT_X[i] + Traits::UNIT_Y[i] * Traits::UNIT_Y[i];
+					if (distSq > boundSq)
+						boundSq = distSq;
+				}
 
-	class TriShape : public IShape
-	{
-	public:
-		TriShape(const float size); // DECLARATION ONLY
-		virtual float GetRadius() const override { return m_radius; }
-		virtual float getMass() const override { return m_radius * m_radius; } // FIX: Required implementation
+				polygon.m_boundScale = Sqrt(boundSq);
+				return polygon;
+			}
 
-		// The override definitions below are fine as they were, they are defined in public.
-		virtual void ComputeEdges(float* x, float* y, int& numEdges) const override;
-		virtual int GetType() const override { return 0; }
+			template< typename TSequence >
+			struct UnitPolygonTable;
 
-	private:
-		float	m_size;
-		float m_radius;
-	};
+			template< int... TYPES >
+			struct UnitPolygonTable< std::integer_sequence< int, TYPES... > >
+			{
+				static constexpr UnitPolygon POLYGONS[sizeof...(TYPES)] = { MakeUnitPolygon< TYPES >()... };
+			};
 
-	class QuadShape : public IShape
-	{
-	public:
-		QuadShape(const float size); // DECLARATION ONLY
-		virtual float GetRadius() const override { return m_radius; }
-		virtual float getMass() const override { return m_radius * m_radius; } // FIX: Required implementation
+			typedef UnitPolygonTable< std::make_integer_sequence< int, NUM_TYPES > > TUnitPolygons;
 
-		virtual void ComputeEdges(float* x, float* y, int& numEdges) const override;
-		virtual int GetType() const override { return 1; }
+			/// unit polygon scaled to the shape size, vertex count is known at compile time
+			template< int TYPE >
+			struct ScaledPolygon
+			{
+				static constexpr int NUM_EDGES = ShapeTraits< TYPE >::NUM_EDGES;
 
-	private:
-		float	m_size;
-		float m_radius;
-	};
+				float	m_x[NUM_EDGES];
+				float	m_y[NUM_EDGES];
+				float	m_nx[NUM_EDGES];
+				float	m_ny[NUM_EDGES];
+
+				inline ScaledPolygon(const float size)
+				{
+					const UnitPolygon& unit = TUnitPolygons::POLYGONS[TYPE];
+					const float halfSize = size / 2.0f;
+
+					for (int i = 0; i < NUM_EDGES; ++i)
+					{
+						m_x[i] = halfSize * unit.m_x[i];
+						m_y[i] = halfSize * unit.m_y[i];
+						m_nx[i] = halfSize * unit.m_nx[i];
+						m_ny[i] = halfSize * unit.m_ny[i];
+					}
+				}
+
+				/// is given point (relative to the shape center) inside the shape ?
+				inline bool Contains(const float x, const float y) const
+				{
+					for (int i = 0; i < NUM_EDGES; ++i)
+					{
+						const float dot = m_nx[i] * (x - m_x[i]) + m_ny[i] * (y - m_y[i]);
+						if (!(dot < 0))
+							return false;
+					}
+
+					return true;
+				}
+
+				/// is any vertex of this shape inside the other shape ? (half of the overlap test)
+				template< int OTHER_TYPE >
+				inline bool CheckCollision(const float thisShapeX, const float thisShapeY, const ScaledPolygon< OTHER_TYPE >& other, const float otherShapeX, const float otherShapeY) const
+				{
+					for (int i = 0; i < NUM_EDGES; ++i)
+					{
+						const float curX = m_x[i] + thisShapeX;
+						const float curY = m_y[i] + thisShapeY;
+
+						if (other.Contains(curX - otherShapeX, curY - otherShapeY))
+							return true;
+					}
 
-	class HexShape : public IShape
+					return false;
+				}
+			};
+		}
+
+		/// unit polygon of a compile time shape type
+		template< int TYPE >
+		constexpr const UnitPolygon& GetUnitPolygon()
+		{
+			return detail::TUnitPolygons::POLYGONS[TYPE];
+		}
+
+		/// unit polygon of given shape type, the type must be valid
+		inline const UnitPolygon& GetUnitPolygon(const int shapeType)
+		{
+			return detail::TUnitPolygons::POLYGONS[shapeType];
+		}
+
+		/// is the shape type known ?
+		inline bool IsValidType(const int shapeType)
+		{
+			return shapeType >= 0 && shapeType < NUM_TYPES;
+		}
+
+		/// radius of the bounding circle
+		float ComputeRadius(int shapeType, float size);
+
+		/// compute shape vertices relative to the shape center
+		void ComputeEdges(int shapeType, float size, float* x, float* y, int& numEdges);
+
+		/// render shape at given position (single outline instance)
+		void Render(int shapeType, float size, float x, float y, app::RenderFrame& frame);
+
+		/// render shape at given position as separate lines, same vertices as the expanded instance
+		void RenderEdges(int shapeType, float size, float x, float y, app::RenderFrame& frame);
+
+		/// index of the shape outline in app::RenderOutlineTable, -1 for unknown type
+		int GetRenderOutline(int shapeType);
+
+		/// is given point (relative to the shape center) inside the shape ?
+		bool Contains(int shapeType, float size, float x, float y);
+
+		/// are two shapes overlapping, dispatched to the specialized test of the type pair
+		bool TestOverlap(int typeA, float sizeA, float ax, float ay, int typeB, float sizeB, float bx, float by);
+
+		/// specialized overlap test of two shape types, all loops have compile time bounds
+		template< int TYPE_A, int TYPE_B >
+		inline bool TestOverlap(float sizeA, float ax, float ay, float sizeB, float bx, float by)
+		{
+			const detail::ScaledPolygon< TYPE_A > a(sizeA);
+			const detail::ScaledPolygon< TYPE_B > b(sizeB);
+
+			if (a.CheckCollision(ax, ay, b, bx, by))
+				return true;
+
+			if (b.CheckCollision(bx, by, a, ax, ay))
+				return true;
+
+			return false;
+		}
+	}
+
+	/// Shape of compile time type, no virtual calls
+	/// Kept for code that wants a shape object, the bodies only store the type and size.
+	template< int TYPE >
+	class Shape
 	{
 	public:
-		HexShape(const float size); // DECLARATION ONLY
-		virtual float GetRadius() const override { return m_radius; }
-		virtual float getMass() const override { return m_radius * m_radius; } // FIX: Required implementation
+		static constexpr int TYPE_ID = TYPE;
 
-		virtual void ComputeEdges(float* x, float* y, int& numEdges) const override;
-		virtual int GetType() const override { return 2; }
+		Shape(const float size)
+			: m_size(size)
+			, m_radius(size * shape::ShapeTraits< TYPE >::RADIUS_SCALE)
+		{}
+
+		inline float GetRadius() const { return m_radius; }
+		inline float getMass() const { return m_radius * m_radius; }
+		inline float GetSize() const { return m_size; }
+
+		/// get assigned type of this shape
+		static constexpr int GetType() { return TYPE; }
+
+		/// compute shape vertices relative to the shape center
+		inline void ComputeEdges(float* x, float* y, int& numEdges) const { shape::ComputeEdges(TYPE, m_size, x, y, numEdges); }
+
+		/// Render shape at given position
+		inline void Render(float x, float y, app::RenderFrame& frame) const { shape::Render(TYPE, m_size, x, y, frame); }
+
+		/// Is given point inside the shape ?
+		inline bool Contains(float x, float y) const { return shape::Contains(TYPE, m_size, x, y); }
+
+		/// are two shapes overlapping
+		template< int OTHER_TYPE >
+		static bool TestOverlap(const Shape& a, float ax, float ay, const Shape< OTHER_TYPE >& b, float bx, float by)
+		{
+			return shape::TestOverlap< TYPE, OTHER_TYPE >(a.GetSize(), ax, ay, b.GetSize(), bx, by);
+		}
 
 	private:
 		float	m_size;
-		float m_radius;
+		float	m_radius;
 	};
 
-} // test
\ No newline at end of file
+	typedef Shape< 0 > TriShape;
+	typedef Shape< 1 > QuadShape;
+	typedef Shape< 2 > HexShape;
+
+} // test
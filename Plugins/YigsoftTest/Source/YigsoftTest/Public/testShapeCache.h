@@ -0,0 +1,73 @@
+#pragma once
+
+#include "testShape.h"
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+
+namespace test
+{
+	/// index of an interned shape in the ShapeCache
+	typedef uint16_t TShapeHandle;
+
+	const TShapeHandle INVALID_SHAPE = 0xFFFF;
+
+	/// immutable geometry of a shape type at a given size, shared by all bodies with the same shape
+	/// Vertices and normals are relative to the shape center, unused slots are zero.
+	struct ShapeGeometry
+	{
+		int		m_type;
+		int		m_numEdges;
+		float	m_size;
+		float	m_radius; // bounding circle used by the broadphase
+		float	m_bound; // distance of the furthest vertex
+		float	m_mass;
+		float	m_x[shape::MAX_EDGES];
+		float	m_y[shape::MAX_EDGES];
+		float	m_nx[shape::MAX_EDGES];
+		float	m_ny[shape::MAX_EDGES];
+	};
+
+	/// Interning table of shape geometry keyed by shape type and quantized size
+	/// Sizes are snapped to a multiple of the quantum so bodies with nearly the same size share one entry,
+	/// a quantum of zero keeps the sizes exact (one entry per distinct size).
+	/// Entries are never removed, handles stay valid until Clear.
+	class ShapeCache
+	{
+	public:
+		static const float DEFAULT_QUANTUM;
+		static const int MAX_SHAPES = INVALID_SHAPE;
+
+		ShapeCache(const float quantum = DEFAULT_QUANTUM);
+
+		/// change the size quantum, does not affect already interned shapes
+		void SetQuantum(const float quantum);
+		inline float GetQuantum() const { return m_quantum; }
+
+		/// size the shape would get when interned
+		float Quantize(const float size) const;
+
+		/// get handle of the shape, creates it on first use, returns INVALID_SHAPE for unknown type or full cache
+		/// Not thread safe.
+		TShapeHandle Intern(const int shapeType, const float size);
+
+		/// same as Intern but the size is used as is (e.g. sizes of an already quantized cache)
+		TShapeHandle InternExact(const int shapeType, const float quantizedSize);
+
+		inline const ShapeGeometry& Get(const TShapeHandle handle) const { return m_geometry[handle]; }
+
+		/// all interned shapes, indexed by the handle
+		inline const ShapeGeometry* GetGeometry() const { return m_geometry.data(); }
+		inline int GetNumShapes() const { return (int)m_geometry.size(); }
+
+		/// drop all shapes (invalidates all handles)
+		void Clear();
+
+	private:
+		float									m_quantum;
+		std::vector< ShapeGeometry >			m_geometry;
+		std::unordered_map< uint64_t, int >		m_lookup; // type << 32 | size bits
+	};
+
+} // test
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "testBodyStore.h"
+
+#include <stdint.h>
+
+namespace test
+{
+	/// scene state besides the bodies, enough to continue generating the same scene
+	struct SnapshotScene
+	{
+		int			m_scenario;
+		uint64_t	m_seed;
+		uint64_t	m_numSpawned; // bodies generated since the seed was set
+		uint64_t	m_randomCounter; // position in the app's random stream
+	};
+
+	/// Binary snapshot of the full body state
+	/// The file is a fixed header followed by the body arrays in the BodyStore layout and the interned shapes,
+	/// every array starts at a 64 byte aligned offset. Loading maps the file and copies every array in one go,
+	/// saving writes the arrays straight from the store. Little endian only, files of other versions are rejected.
+	struct SnapshotHeader
+	{
+		static const uint32_t MAGIC = 0x504E5359; // "YSNP"
+		static const uint32_t VERSION = 1;
+		static const uint32_t ALIGNMENT = 64;
+
+		enum Array
+		{
+			X,
+			Y,
+			VEL_X,
+			VEL_Y,
+			RADIUS,
+			SHAPE, // TShapeHandle per body
+			COLOR,
+			SHAPE_TYPE, // int32 per interned shape
+			SHAPE_SIZE, // float per interned shape
+			NUM_ARRAYS,
+		};
+
+		uint32_t	m_magic;
+		uint32_t	m_version;
+		uint32_t	m_headerSize;
+		uint32_t	m_numBodies;
+		uint32_t	m_numShapes;
+		int32_t		m_scenario;
+		uint64_t	m_seed;
+		uint64_t	m_numSpawned;
+		uint64_t	m_randomCounter;
+		float		m_shapeQuantum;
+		uint32_t	m_reserved;
+		uint64_t	m_offsets[NUM_ARRAYS]; // from the start of the file
+	};
+
+	/// write bodies and scene state to given file, returns false on error
+	bool SaveSnapshot(const char* path, const BodyStore& bodies, const SnapshotScene& scene);
+
+	/// replace the bodies and scene state with the ones from given file, returns false (and keeps everything) on error
+	bool LoadSnapshot(const char* path, BodyStore& outBodies, SnapshotScene& outScene);
+
+} // test
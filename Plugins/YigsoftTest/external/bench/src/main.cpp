@@ -0,0 +1,684 @@
+/// (C) Yigsoft 2023
+
+/// Microbenchmarks of the simulation hot paths
+/// Every case is timed on its own and the results are printed as JSON, so single optimizations can be judged.
+
+#include "frameworkCore.h"
+#include "testApp.h"
+#include "testBody.h"
+#include "testBodyStore.h"
+#include "testGrid.h"
+#include "testKernels.h"
+#include "testNarrowphase.h"
+#include "testNeighbourList.h"
+#include "testShape.h"
+#include "jobSystem.h"
+#include "softwareRenderer.h"
+#include "textLayout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <functional>
+
+namespace bench
+{
+	/// single benchmark, setup runs untimed before every repetition, run processes numOps items
+	struct Case
+	{
+		std::string				m_name;
+		int						m_numOps;
+		std::function<void()>	m_setup;
+		std::function<void()>	m_run;
+	};
+
+	struct Result
+	{
+		std::string		m_name;
+		int				m_numOps;
+		int				m_numReps;
+		double			m_medianNsPerOp;
+		double			m_minNsPerOp;
+	};
+
+	struct Options
+	{
+		double			m_minTime = 0.25; // seconds per case
+		int				m_minReps = 5;
+		std::string		m_filter;
+	};
+
+	/// keeps the results alive so the compiler can not drop the benchmarked code
+	static volatile float st_sink = 0.0f;
+
+	namespace helper
+	{
+		static inline float RandRange(const float minValue, const float maxValue)
+		{
+			return minValue + (maxValue - minValue) * ((float)rand() / (float)RAND_MAX);
+		}
+
+		/// random scene in the simulation area, body sizes match PhysicsTestApp
+		static void FillScene(test::BodyStore& store, const int numBodies, const unsigned seed)
+		{
+			srand(seed);
+			store.Truncate(0);
+			store.Reserve(numBodies);
+
+			for (int i = 0; i < numBodies; ++i)
+			{
+				const int type = rand() % test::MaxShapeTypes;
+				const float x = RandRange(0.0f, (float)app::Resolution::WIDTH);
+				const float y = RandRange(0.0f, (float)app::Resolution::HEIGHT);
+				const float size = RandRange(test::MinSize, test::MaxSize);
+				const float velX = RandRange(-100.0f, 100.0f);
+				const float velY = RandRange(-100.0f, 100.0f);
+				store.Add(type, size, 0xFFFFFFFF, x, y, velX, velY);
+			}
+		}
+
+		/// 16 strings similar to the app overlay, the first 4 change with the frame index
+		static void AddOverlayStrings(app::RenderFrame& frame, const int frameIndex)
+		{
+			const app::TColor color = app::MakeColor(200, 255, 200);
+			frame.AddString(10, 10, color, "Render: %6.2f ms (avg: %6.3fms)", 0.01 * frameIndex, 0.02 * frameIndex);
+			frame.AddString(10, 30, color, "Tick: %6.2f ms (avg: %6.3fms)", 0.03 * frameIndex, 0.04 * frameIndex);
+			frame.AddString(400, 30, color, "Steps: %d at %.0f Hz (alpha: %.2f, dropped: %d)", frameIndex & 3, 120.0f, 0.001f * frameIndex, 0);
+			frame.AddString(400, 50, color, "Instances: %d, vertices: %d (peak: %d, dropped: %d, %d KB)", 1000 + frameIndex, 2000, 4000, 0, 768);
+
+			for (int i = 0; i < 12; ++i)
+				frame.AddString(10, 70 + 20 * i, color, "Press %d to toggle the option number %d of the test app", i, i);
+		}
+
+		static void BuildGrid(test::SpatialGrid& grid, const test::BodyStore& store)
+		{
+			const float maxBound = store.GetMaxBound();
+			grid.Build(store.m_x.data(), store.m_y.data(), store.GetNumBodies(), test::Body::GetInteractionRange(maxBound, maxBound), maxBound);
+		}
+
+		static void BuildNeighbourLists(test::NeighbourList& lists, const test::BodyStore& store, app::JobSystem& jobSystem)
+		{
+			const float maxBound = store.GetMaxBound();
+
+			lists.Invalidate();
+			lists.Update(store.GetView(), test::Body::GetAttractionRange(), test::shape::GetOverlapReach(maxBound, maxBound), maxBound, jobSystem);
+		}
+
+		static Result RunCase(const Case& benchCase, const Options& options)
+		{
+			std::vector< double > repTimes;
+
+			double totalTime = 0.0;
+			while ((int)repTimes.size() < options.m_minReps || totalTime < options.m_minTime)
+			{
+				if (benchCase.m_setup)
+					benchCase.m_setup();
+
+				app::ScopedTimer timer;
+				benchCase.m_run();
+				const double elapsed = timer.GetElaspedTime();
+
+				repTimes.push_back(elapsed);
+				totalTime += elapsed;
+			}
+
+			std::sort(repTimes.begin(), repTimes.end());
+
+			const double nsScale = 1e9 / (double)benchCase.m_numOps;
+
+			Result result;
+			result.m_name = benchCase.m_name;
+			result.m_numOps = benchCase.m_numOps;
+			result.m_numReps = (int)repTimes.size();
+			result.m_medianNsPerOp = repTimes[repTimes.size() / 2] * nsScale;
+			result.m_minNsPerOp = repTimes.front() * nsScale;
+			return result;
+		}
+
+		static void PrintJson(const std::vector< Result >& results)
+		{
+			printf("{\n  \"benchmarks\": [\n");
+			for (size_t i = 0; i < results.size(); ++i)
+			{
+				const auto& result = results[i];
+				printf("    { \"name\": \"%s\", \"ops\": %d, \"reps\": %d, \"median_ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"ops_per_sec\": %.0f }%s\n",
+					result.m_name.c_str(), result.m_numOps, result.m_numReps, result.m_medianNsPerOp, result.m_minNsPerOp,
+					(result.m_medianNsPerOp > 0.0) ? 1e9 / result.m_medianNsPerOp : 0.0,
+					(i + 1 < results.size()) ? "," : "");
+			}
+			printf("  ]\n}\n");
+		}
+	}
+
+	//-----
+
+	/// state shared by the cases, built once
+	struct Fixture
+	{
+		static const int NUM_SHAPE_SAMPLES = 4096;
+
+		// shape tests
+		std::vector< float >	m_offsetX;
+		std::vector< float >	m_offsetY;
+
+		// scenes
+		test::BodyStore			m_pristine;
+		test::BodyStore			m_bodies;
+		test::SpatialGrid		m_grid;
+		test::NeighbourList		m_lists;
+		std::vector< int >		m_scratch;
+
+		// batch kernels
+		test::BodyStore			m_largeScene;
+		std::vector< float >	m_dirX;
+		std::vector< float >	m_dirY;
+
+		app::JobSystem			m_jobSystem{ 1 }; // inline, the cases measure single thread cost
+
+		std::unique_ptr< test::App >			m_app;
+		std::unique_ptr< app::RenderFrame >		m_frame;
+		std::vector< app::RenderVertex >		m_vertices;
+		std::vector< app::RenderVertex >		m_uploadRing; // stands in for the renderer's vertex buffer
+		std::unique_ptr< app::SoftwareRenderer >	m_softwareRenderer;
+		std::unique_ptr< app::RenderFrame >		m_textFrame;
+		app::TextBatcher						m_textBatcher;
+	};
+
+	static void AddShapeCases(std::vector< Case >& cases, Fixture& fixture)
+	{
+		const float size = 10.0f;
+
+		// offsets in a ring, "overlapping" ones are well inside, "separated" ones are just past the radii
+		// so the polygon test has to check all vertices before giving up
+		srand(1);
+		fixture.m_offsetX.resize(Fixture::NUM_SHAPE_SAMPLES * 2);
+		fixture.m_offsetY.resize(Fixture::NUM_SHAPE_SAMPLES * 2);
+		for (int i = 0; i < Fixture::NUM_SHAPE_SAMPLES * 2; ++i)
+		{
+			const bool overlapping = i < Fixture::NUM_SHAPE_SAMPLES;
+			const float angle = helper::RandRange(0.0f, 6.2831853f);
+			const float dist = overlapping ? helper::RandRange(0.0f, 0.5f * size) : helper::RandRange(1.0f * size, 1.4f * size);
+			fixture.m_offsetX[i] = dist * cosf(angle);
+			fixture.m_offsetY[i] = dist * sinf(angle);
+		}
+
+		static const char* shapeNames[] = { "tri", "quad", "hex" };
+		static_assert(sizeof(shapeNames) / sizeof(shapeNames[0]) == test::shape::NUM_TYPES, "Missing shape name");
+
+		for (int typeA = 0; typeA < test::shape::NUM_TYPES; ++typeA)
+		{
+			for (int typeB = 0; typeB < test::shape::NUM_TYPES; ++typeB)
+			{
+				for (int separated = 0; separated < 2; ++separated)
+				{
+					Case benchCase;
+					benchCase.m_name = std::string("shape::TestOverlap/") + shapeNames[typeA] + "-" + shapeNames[typeB] + (separated ? "/separated" : "/overlapping");
+					benchCase.m_numOps = Fixture::NUM_SHAPE_SAMPLES;
+					benchCase.m_run = [&fixture, typeA, typeB, separated, size]()
+					{
+						const float* dx = fixture.m_offsetX.data() + separated * Fixture::NUM_SHAPE_SAMPLES;
+						const float* dy = fixture.m_offsetY.data() + separated * Fixture::NUM_SHAPE_SAMPLES;
+
+						int hits = 0;
+						for (int i = 0; i < Fixture::NUM_SHAPE_SAMPLES; ++i)
+							hits += test::shape::TestOverlap(typeA, size, 0.0f, 0.0f, typeB, size, dx[i], dy[i]) ? 1 : 0;
+
+						st_sink = st_sink + (float)hits;
+					};
+					cases.push_back(benchCase);
+				}
+			}
+
+			Case benchCase;
+			benchCase.m_name = std::string("shape::Contains/") + shapeNames[typeA];
+			benchCase.m_numOps = Fixture::NUM_SHAPE_SAMPLES * 2;
+			benchCase.m_run = [&fixture, typeA, size]()
+			{
+				int hits = 0;
+				for (int i = 0; i < Fixture::NUM_SHAPE_SAMPLES * 2; ++i)
+					hits += test::shape::Contains(typeA, size, fixture.m_offsetX[i] * 0.5f, fixture.m_offsetY[i] * 0.5f) ? 1 : 0;
+
+				st_sink = st_sink + (float)hits;
+			};
+			cases.push_back(benchCase);
+		}
+	}
+
+	static void AddBodyCases(std::vector< Case >& cases, Fixture& fixture)
+	{
+		// densities over the fixed simulation area
+		static const int bodyCounts[] = { 1000, 4000, 10000 };
+
+		for (const int numBodies : bodyCounts)
+		{
+			const std::string suffix = "/" + std::to_string(numBodies);
+
+			// every case starts from the same scene
+			auto setup = [&fixture, numBodies]()
+			{
+				if (fixture.m_pristine.GetNumBodies() != numBodies)
+					helper::FillScene(fixture.m_pristine, numBodies, 1);
+
+				fixture.m_bodies = fixture.m_pristine;
+				helper::BuildGrid(fixture.m_grid, fixture.m_bodies);
+				helper::BuildNeighbourLists(fixture.m_lists, fixture.m_bodies, fixture.m_jobSystem);
+			};
+
+			{
+				Case benchCase;
+				benchCase.m_name = "SpatialGrid::Build" + suffix;
+				benchCase.m_numOps = numBodies;
+				benchCase.m_setup = setup;
+				benchCase.m_run = [&fixture]() { helper::BuildGrid(fixture.m_grid, fixture.m_bodies); };
+				cases.push_back(benchCase);
+			}
+
+			{
+				Case benchCase;
+				benchCase.m_name = "NeighbourList::Build" + suffix;
+				benchCase.m_numOps = numBodies;
+				benchCase.m_setup = setup;
+				benchCase.m_run = [&fixture]() { helper::BuildNeighbourLists(fixture.m_lists, fixture.m_bodies, fixture.m_jobSystem); };
+				cases.push_back(benchCase);
+			}
+
+			{
+				Case attraction;
+				attraction.m_name = "Body::FindAttractor/lists" + suffix;
+				attraction.m_numOps = numBodies;
+				attraction.m_setup = setup;
+				attraction.m_run = [&fixture, numBodies]()
+				{
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).UpdateAttraction(fixture.m_lists, 0);
+				};
+				cases.push_back(attraction);
+
+				Case collision;
+				collision.m_name = "Body::SolveCollision/lists" + suffix;
+				collision.m_numOps = numBodies;
+				collision.m_setup = setup;
+				collision.m_run = [&fixture, numBodies]()
+				{
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).UpdateCollision(fixture.m_lists, fixture.m_scratch);
+				};
+				cases.push_back(collision);
+			}
+
+			for (int useGrid = 1; useGrid >= 0; --useGrid)
+			{
+				// brute force is quadratic, keep it to the smaller scenes
+				if (!useGrid && numBodies > 1000)
+					continue;
+
+				const std::string broadphase = useGrid ? "/grid" : "/brute";
+
+				Case attraction;
+				attraction.m_name = "Body::FindAttractor" + broadphase + suffix;
+				attraction.m_numOps = numBodies;
+				attraction.m_setup = setup;
+				attraction.m_run = [&fixture, numBodies, useGrid]()
+				{
+					const test::SpatialGrid* grid = useGrid ? &fixture.m_grid : nullptr;
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).UpdateAttraction(grid, 0);
+				};
+				cases.push_back(attraction);
+
+				Case collision;
+				collision.m_name = "Body::SolveCollision" + broadphase + suffix;
+				collision.m_numOps = numBodies;
+				collision.m_setup = setup;
+				collision.m_run = [&fixture, numBodies, useGrid]()
+				{
+					test::SpatialGrid* grid = useGrid ? &fixture.m_grid : nullptr;
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).UpdateCollision(grid, fixture.m_scratch);
+				};
+				cases.push_back(collision);
+
+				// Jacobi pass of the same scene, the corrections are gathered but not applied
+				Case jacobi;
+				jacobi.m_name = "Body::AccumulateCollision" + broadphase + suffix;
+				jacobi.m_numOps = numBodies;
+				jacobi.m_setup = setup;
+				jacobi.m_run = [&fixture, numBodies, useGrid]()
+				{
+					const test::SpatialGrid* grid = useGrid ? &fixture.m_grid : nullptr;
+					float correctionX = 0.0f;
+					float correctionY = 0.0f;
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).AccumulateCollision(grid, fixture.m_scratch, correctionX, correctionY);
+
+					st_sink = correctionX + correctionY;
+				};
+				cases.push_back(jacobi);
+			}
+
+			{
+				// integrate includes the wrap around
+				Case benchCase;
+				benchCase.m_name = "Body::Integrate+WrapAround" + suffix;
+				benchCase.m_numOps = numBodies;
+				benchCase.m_setup = setup;
+				benchCase.m_run = [&fixture, numBodies]()
+				{
+					for (int i = 0; i < numBodies; ++i)
+						test::Body(fixture.m_bodies, i).Integrate(1.0f / 60.0f);
+				};
+				cases.push_back(benchCase);
+			}
+		}
+	}
+
+	static void AddAppCases(std::vector< Case >& cases, Fixture& fixture)
+	{
+		fixture.m_app.reset(new test::App());
+
+		Case benchCase;
+		benchCase.m_name = "PhysicsTestApp::AddBodies";
+		benchCase.m_numOps = test::MaxBodies;
+		benchCase.m_setup = [&fixture]() { fixture.m_app->SetNumBodies(0); };
+		benchCase.m_run = [&fixture]() { fixture.m_app->SetNumBodies(test::MaxBodies); };
+		cases.push_back(benchCase);
+
+		benchCase.m_name = "PhysicsTestApp::RemoveBodies";
+		benchCase.m_setup = [&fixture]() { fixture.m_app->SetNumBodies(test::MaxBodies); };
+		benchCase.m_run = [&fixture]()
+		{
+			// same granularity as the - key
+			for (int i = 0; i < test::MaxBodies; i += 100)
+				fixture.m_app->RemoveBodies(100);
+		};
+		cases.push_back(benchCase);
+	}
+
+	static void AddRenderCases(std::vector< Case >& cases, Fixture& fixture)
+	{
+		fixture.m_frame.reset(new app::RenderFrame());
+
+		const int numLines = 300000;
+
+		Case benchCase;
+		benchCase.m_name = "RenderFrame::AddLine";
+		benchCase.m_numOps = numLines;
+		benchCase.m_setup = [&fixture]() { fixture.m_frame->Reset(); };
+		benchCase.m_run = [&fixture, numLines]()
+		{
+			auto& frame = *fixture.m_frame;
+			for (int i = 0; i < numLines; ++i)
+			{
+				const float x = (float)(i & 1023);
+				frame.SetColor((app::TColor)i);
+				frame.AddLine(x, 0.0f, x + 1.0f, 1.0f);
+			}
+		};
+		cases.push_back(benchCase);
+
+		// hexagons, the most edges per body
+		const int numShapes = 100000;
+
+		benchCase.m_name = "shape::RenderEdges";
+		benchCase.m_numOps = numShapes;
+		benchCase.m_setup = [&fixture]() { fixture.m_frame->Reset(); };
+		benchCase.m_run = [&fixture, numShapes]()
+		{
+			auto& frame = *fixture.m_frame;
+			for (int i = 0; i < numShapes; ++i)
+				test::shape::RenderEdges(2, 10.0f, (float)(i & 1023), (float)(i >> 10), frame);
+		};
+		cases.push_back(benchCase);
+
+		benchCase.m_name = "shape::Render";
+		benchCase.m_run = [&fixture, numShapes]()
+		{
+			auto& frame = *fixture.m_frame;
+			for (int i = 0; i < numShapes; ++i)
+				test::shape::Render(2, 10.0f, (float)(i & 1023), (float)(i >> 10), frame);
+		};
+		cases.push_back(benchCase);
+
+		// CPU expansion of the instances above, as done by renderers without instancing
+		fixture.m_vertices.resize(2 * test::shape::MAX_EDGES * numShapes);
+
+		benchCase.m_name = "ExpandRenderInstances";
+		benchCase.m_setup = [&fixture, numShapes]()
+		{
+			auto& frame = *fixture.m_frame;
+			frame.Reset();
+			for (int i = 0; i < numShapes; ++i)
+				test::shape::Render(2, 10.0f, (float)(i & 1023), (float)(i >> 10), frame);
+		};
+		benchCase.m_run = [&fixture]()
+		{
+			const auto& instances = fixture.m_frame->GetInstances();
+			app::ExpandRenderInstances(instances.data(), (int)instances.size(), fixture.m_vertices.data());
+		};
+		cases.push_back(benchCase);
+
+		// whole frame of the instances above drawn on the CPU (expansion, binning, tiles), per instance
+		fixture.m_softwareRenderer.reset(new app::SoftwareRenderer());
+
+		benchCase.m_name = "SoftwareRenderer::Render";
+		benchCase.m_run = [&fixture]()
+		{
+			fixture.m_softwareRenderer->Render(*fixture.m_frame, &fixture.m_jobSystem);
+			st_sink = (float)fixture.m_softwareRenderer->GetPixels()[0];
+		};
+		cases.push_back(benchCase);
+
+		// overlay text of a frame, mostly static help lines and a few changing numbers
+		fixture.m_textFrame.reset(new app::RenderFrame());
+
+		const int numTextFrames = 100;
+		const int numFrameStrings = 16;
+
+		benchCase.m_name = "RenderFrame::AddString";
+		benchCase.m_numOps = numTextFrames * numFrameStrings;
+		benchCase.m_setup = nullptr;
+		benchCase.m_run = [&fixture, numTextFrames]()
+		{
+			auto& frame = *fixture.m_textFrame;
+			for (int i = 0; i < numTextFrames; ++i)
+			{
+				frame.Reset();
+				helper::AddOverlayStrings(frame, i);
+			}
+		};
+		cases.push_back(benchCase);
+
+		// same text every build, only the positions and colors are applied
+		benchCase.m_name = "TextBatcher::Build/cached";
+		benchCase.m_numOps = numFrameStrings;
+		benchCase.m_setup = [&fixture]()
+		{
+			auto& frame = *fixture.m_textFrame;
+			frame.Reset();
+			helper::AddOverlayStrings(frame, 0);
+			fixture.m_textBatcher.Build(frame);
+		};
+		benchCase.m_run = [&fixture]()
+		{
+			fixture.m_textBatcher.Build(*fixture.m_textFrame);
+			st_sink = (float)fixture.m_textBatcher.GetQuads().size();
+		};
+		cases.push_back(benchCase);
+
+		benchCase.m_name = "TextBatcher::Build/uncached";
+		benchCase.m_setup = [&fixture]()
+		{
+			auto& frame = *fixture.m_textFrame;
+			frame.Reset();
+			helper::AddOverlayStrings(frame, 0);
+			fixture.m_textBatcher.ClearCache();
+		};
+		cases.push_back(benchCase);
+
+		// CPU side of streaming the frame's vertex chunks through an upload ring, smaller than a chunk
+		// so every chunk is split into several batches (RenderLines::Draw without the GPU)
+		const int numStreamedLines = 1000000;
+		const int ringVertices = 48 * 1024;
+		fixture.m_uploadRing.resize(ringVertices);
+
+		benchCase.m_name = "StreamRing::Upload";
+		benchCase.m_numOps = 2 * numStreamedLines;
+		benchCase.m_setup = [&fixture, numStreamedLines]()
+		{
+			auto& frame = *fixture.m_frame;
+			frame.Reset();
+			for (int i = 0; i < numStreamedLines; ++i)
+			{
+				const float x = (float)(i & 1023);
+				frame.AddLine(x, 0.0f, x + 1.0f, 1.0f);
+			}
+		};
+		benchCase.m_run = [&fixture, ringVertices]()
+		{
+			const auto& frame = *fixture.m_frame;
+			app::StreamRing ring(ringVertices);
+			app::RenderVertex* upload = fixture.m_uploadRing.data();
+
+			for (int i = 0; i < frame.GetNumUsedChunks(); ++i)
+			{
+				int numVertices = 0;
+				const app::RenderVertex* vertices = frame.GetChunk(i, numVertices);
+				app::ForEachStreamBatch(numVertices, ringVertices, 2, [&](const int first, const int count)
+					{
+						const int offset = ring.Allocate(count);
+						memcpy(upload + offset, vertices + first, count * sizeof(app::RenderVertex));
+					});
+			}
+
+			st_sink = upload[0].x;
+		};
+		cases.push_back(benchCase);
+	}
+
+	static void AddKernelCases(std::vector< Case >& cases, Fixture& fixture)
+	{
+		// large scale mode, every supported level on the same scene (the results are identical, only the time differs)
+		const int numBodies = 100000;
+		const std::string suffix = "/" + std::to_string(numBodies);
+
+		helper::FillScene(fixture.m_largeScene, numBodies, 1);
+
+		// every other body has an attractor
+		fixture.m_dirX.assign(numBodies, 0.0f);
+		fixture.m_dirY.assign(numBodies, 0.0f);
+		for (int i = 0; i < numBodies; i += 2)
+		{
+			const float angle = helper::RandRange(0.0f, 6.2831853f);
+			fixture.m_dirX[i] = cosf(angle);
+			fixture.m_dirY[i] = sinf(angle);
+		}
+
+		const test::SimdLevel supported = test::kernels::GetSupportedLevel();
+		for (int level = (int)test::SimdLevel::Scalar; level <= (int)supported; ++level)
+		{
+			const test::SimdLevel simdLevel = (test::SimdLevel)level;
+			const std::string name = std::string("/") + test::kernels::GetLevelName(simdLevel) + suffix;
+			auto setup = [simdLevel]() { test::kernels::SetLevel(simdLevel); };
+
+			Case integrate;
+			integrate.m_name = "kernels::Integrate" + name;
+			integrate.m_numOps = numBodies;
+			integrate.m_setup = setup;
+			integrate.m_run = [&fixture, numBodies]()
+			{
+				test::Body::Integrate(fixture.m_largeScene, 0, numBodies, 1.0f / 60.0f);
+				st_sink = fixture.m_largeScene.m_x[0];
+			};
+			cases.push_back(integrate);
+
+			Case attraction;
+			attraction.m_name = "kernels::ApplyAttraction" + name;
+			attraction.m_numOps = numBodies;
+			attraction.m_setup = setup;
+			attraction.m_run = [&fixture, numBodies]()
+			{
+				test::Body::ApplyAttraction(fixture.m_largeScene, 0, numBodies, fixture.m_dirX.data(), fixture.m_dirY.data());
+				st_sink = fixture.m_largeScene.m_velX[0];
+			};
+			cases.push_back(attraction);
+		}
+	}
+
+	//-----
+
+	namespace helper
+	{
+		static void PrintUsage(const char* exeName)
+		{
+			fprintf(stderr, "Usage: %s [options]\n", exeName);
+			fprintf(stderr, "  --filter TEXT     run only cases with TEXT in the name\n");
+			fprintf(stderr, "  --min-time S      minimum measured time per case in seconds (default 0.25)\n");
+			fprintf(stderr, "  --min-reps N      minimum repetitions per case (default 5)\n");
+			fprintf(stderr, "  --list            print case names and exit\n");
+		}
+	}
+
+} // bench
+
+int main(int argc, char** argv)
+{
+	bench::Options options;
+	bool listOnly = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* name = argv[i];
+		const bool hasValue = (i + 1 < argc);
+
+		if (0 == strcmp(name, "--list"))
+			listOnly = true;
+		else if (0 == strcmp(name, "--filter") && hasValue)
+			options.m_filter = argv[++i];
+		else if (0 == strcmp(name, "--min-time") && hasValue)
+			options.m_minTime = atof(argv[++i]);
+		else if (0 == strcmp(name, "--min-reps") && hasValue)
+			options.m_minReps = std::max(1, atoi(argv[++i]));
+		else
+		{
+			bench::helper::PrintUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	bench::Fixture fixture;
+
+	std::vector< bench::Case > cases;
+	bench::AddShapeCases(cases, fixture);
+	bench::AddBodyCases(cases, fixture);
+	bench::AddAppCases(cases, fixture);
+	bench::AddRenderCases(cases, fixture);
+	bench::AddKernelCases(cases, fixture); // last, the cases switch the kernel level
+
+	std::vector< bench::Result > results;
+	for (const auto& benchCase : cases)
+	{
+		if (!options.m_filter.empty() && benchCase.m_name.find(options.m_filter) == std::string::npos)
+			continue;
+
+		if (listOnly)
+		{
+			printf("%s\n", benchCase.m_name.c_str());
+			continue;
+		}
+
+		// progress goes to stderr, stdout stays valid JSON
+		fprintf(stderr, "%s\n", benchCase.m_name.c_str());
+		results.push_back(bench::helper::RunCase(benchCase, options));
+	}
+
+	if (!listOnly)
+		bench::helper::PrintJson(results);
+
+	return 0;
+}
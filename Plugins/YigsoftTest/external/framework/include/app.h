@@ -2,7 +2,7 @@
 
 #pragma once
 
-#include "framework.h"
+#include "frameworkCore.h"
 
 namespace app
 {
@@ -11,6 +11,9 @@
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include <thread>
+
+#include "frameworkCore.h"
 
 #ifndef SAFE_RELEASE
 #define SAFE_RELEASE(x) if (x) { (x)->Release(); x = NULL; }
@@ -20,54 +23,8 @@ namespace app
 {
 	class RenderFont;
 	class Framework;
-	enum class Resolution : int
-	{
-		WIDTH = 1600,
-		HEIGHT = 900,
-	};
-
-	/// timing provider
-	class Timer
-	{
-	public:
-		typedef unsigned __int64 TTicks;
-
-		Timer();
-
-		TTicks GetNow();
-		double ToSeconds(TTicks time);
-		double ToSecondsIntv(TTicks time);
-
-		static inline Timer& GetInstance()
-		{
-			return st_instance;
-		}
-
-	private:
-		TTicks		m_base;
-		TTicks		m_freq;
-
-		static Timer st_instance;
-	};
-
-	/// scoped timing block
-	class ScopedTimer
-	{
-	public:
-		inline ScopedTimer()
-			: m_startTime(Timer::GetInstance().GetNow())
-		{
-		}
-
-		inline double GetElaspedTime() const
-		{
-			const auto delta = (Timer::GetInstance().GetNow() - m_startTime);
-			return Timer::GetInstance().ToSecondsIntv(delta);
-		}
-
-	private:
-		Timer::TTicks		m_startTime;
-	};
+	class JobSystem;
+	class SoftwareRenderer;
 
 	/// basic listener for actions done with the window
 	class WindowListener
@@ -108,83 +65,6 @@ namespace app
 		HWND					m_hwnd;
 	};
 
-	/// additional app initialization data (needed for DirectCompute)
-	struct AppInitContext
-	{
-		DWORD					m_width;
-		DWORD					m_height;
-
-		ID3D11Device* m_device;
-		ID3D11DeviceContext* m_deviceContext;
-	};
-
-	/// renderable vertex
-	struct RenderVertex
-	{
-		float x, y;
-		DWORD color;
-	};
-
-	/// renderable string
-	struct RenderString
-	{
-		int x, y;
-		DWORD color;
-		std::string text;
-	};
-
-	/// collections of data to render that represent a single frame
-	class RenderFrame
-	{
-	public:
-		RenderFrame();
-
-		void Reset();
-		const std::vector< RenderString >& GetStrings() const { return m_strings; }
-		inline void SetColor(const DWORD color)
-		{
-			m_currentColor = color;
-		}
-
-		inline void AddLine(const float x0, const float y0, const float x1, const float y1)
-		{
-			if (m_writePtr < m_endPtr)
-			{
-				m_writePtr->color = m_currentColor;
-				m_writePtr->x = x0;
-				m_writePtr->y = y0;
-				++m_writePtr;
-
-				m_writePtr->color = m_currentColor;
-				m_writePtr->x = x1;
-				m_writePtr->y = y1;
-				++m_writePtr;
-			}
-		}
-
-		void AddString(const int x, const int y, const DWORD color, const char* txt, ...);
-
-		friend class Renderer;
-
-	private:
-		
-		
-		static const int MAX_VERTICES = 8 * 100000; // good for around 100k of objects
-
-		DWORD			m_currentColor;
-
-		RenderVertex	m_vertices[MAX_VERTICES];
-		RenderVertex* m_writePtr;
-		RenderVertex* m_endPtr;
-		
-		inline int GetNumVertices() const
-		{
-			return (int)(m_writePtr - m_vertices);
-		}
-
-		std::vector< RenderString >	m_strings;
-	};
-
 	class Renderer;
 	class IApp;
 
@@ -205,6 +85,16 @@ namespace app
 
 		void RegisterApp(IApp* app);
 
+		/// set number of job system workers (including the main thread) before Init, 0 - one per hardware thread, 1 - single threaded
+		void SetNumWorkers(const int numWorkers);
+
+		/// set the fixed simulation step (default 120Hz) and the cap on steps run per rendered frame, stepTime 0 - one variable tick per frame
+		void SetFixedTimestep(const float stepTime, const int maxSubsteps);
+
+		/// run the app (input, ticks and building of the render frame) on a separate simulation thread before Init,
+		/// the main thread only pumps messages and submits the newest finished frame
+		void SetPipelined(const bool pipelined);
+
 		bool Init();
 		void Loop();
 
@@ -216,7 +106,12 @@ namespace app
 		static Framework* st_globalFrameworkInstance;
 
 		void Tick(const float timeDelta);
+		void TickSubsteps(const double frameTime);
+		void BuildFrame(RenderFrame& frame);
 		void Render();
+
+		void RunSimulation();
+		void LoopPipelined();
 		
 		void ResetAverages();
 		void ProcessAverage();
@@ -224,6 +119,15 @@ namespace app
 		void ProcessInput();
 		void ProcessInputKey(const int pressedKey);
 
+		/// start zone capture, or stop it and export the trace
+		void ToggleProfiler();
+
+		/// draw the frame with the software renderer and save it, done on the thread that built the frame
+		void DumpFrame(const RenderFrame& frame);
+
+		/// step all registered apps on the current scene side by side and save the comparison, the scenes are replaced
+		void CompareApps();
+
 		void ConnectWindowHook();
 		void PumpMessages();
 
@@ -246,9 +150,24 @@ namespace app
 		double			m_avgAppRenderTime;
 		int				m_numAvgFrames;
 
+		FixedTimestep	m_timestep;
+		bool			m_useFixedTimestep;
+		int				m_lastNumSubsteps;
+
 		Window* m_window;
 		Renderer* m_renderer;
-		RenderFrame* m_frame;
+		RenderFrame* m_frame; // frame last submitted
+
+		bool							m_pipelined;
+		TripleBuffer< RenderFrame >*	m_frames; // pipelined mode only, written by the simulation thread
+		std::thread						m_simThread;
+		double							m_lastSubmitTime;
+
+		int				m_numWorkers;
+		JobSystem*		m_jobSystem;
+
+		SoftwareRenderer*	m_softwareRenderer; // created on the first frame dump
+		bool				m_dumpFrame; // F key, the next built frame is saved
 
 		std::mutex			m_inputBufferLock;
 		std::vector< int >	m_inputBuffer;
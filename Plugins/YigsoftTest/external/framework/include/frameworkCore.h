@@ -0,0 +1,460 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <condition_variable>
+
+/// Platform neutral part of the framework, everything the simulation needs without Win32 or D3D
+/// The windowed framework (framework.h) builds on top of this.
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+
+namespace app
+{
+	class JobSystem;
+
+	enum class Resolution : int
+	{
+		WIDTH = 1600,
+		HEIGHT = 900,
+	};
+
+	/// packed 0x00BBGGRR color, same layout as the Win32 COLORREF
+	typedef uint32_t TColor;
+
+	/// build color from components (same as the Win32 RGB macro)
+	inline constexpr TColor MakeColor(const uint8_t r, const uint8_t g, const uint8_t b)
+	{
+		return (TColor)r | ((TColor)g << 8) | ((TColor)b << 16);
+	}
+
+	/// key codes passed to IApp::OnKeyPressed, values match the Win32 virtual keys so the window can pass them through
+	namespace key
+	{
+		const int ESCAPE = 0x1B;
+		const int ADD = 0x6B; // numpad +
+		const int SUBTRACT = 0x6D; // numpad -
+		const int OEM_PLUS = 0xBB;
+		const int OEM_MINUS = 0xBD;
+	}
+
+	/// timing provider
+	class Timer
+	{
+	public:
+		typedef uint64_t TTicks;
+
+		Timer();
+
+		TTicks GetNow();
+		double ToSeconds(TTicks time);
+		double ToSecondsIntv(TTicks time);
+
+		static inline Timer& GetInstance()
+		{
+			return st_instance;
+		}
+
+	private:
+		TTicks		m_base;
+		TTicks		m_freq;
+
+		static Timer st_instance;
+	};
+
+	/// scoped timing block
+	class ScopedTimer
+	{
+	public:
+		inline ScopedTimer()
+			: m_startTime(Timer::GetInstance().GetNow())
+		{
+		}
+
+		inline double GetElaspedTime() const
+		{
+			const auto delta = (Timer::GetInstance().GetNow() - m_startTime);
+			return Timer::GetInstance().ToSecondsIntv(delta);
+		}
+
+	private:
+		Timer::TTicks		m_startTime;
+	};
+
+	/// fixed timestep accumulator, turns variable frame times into whole simulation steps
+	/// The number of steps per frame is capped, time past the cap is dropped so a slow tick can not
+	/// snowball into ever more steps (simulation runs slow instead).
+	class FixedTimestep
+	{
+	public:
+		FixedTimestep(const float stepTime = 1.0f / 120.0f, const int maxSteps = 8);
+
+		void Configure(const float stepTime, const int maxSteps);
+
+		/// add elapsed real time, returns number of steps to run now
+		int Advance(const double elapsedTime);
+
+		/// forget the accumulated time (e.g. after a pause)
+		void Reset();
+
+		inline float GetStepTime() const { return (float)m_stepTime; }
+		inline int GetMaxSteps() const { return m_maxSteps; }
+
+		/// fraction of the next step already elapsed, 0-1, used to interpolate between the last two states
+		inline float GetAlpha() const { return (float)(m_accumulator / m_stepTime); }
+
+		/// real time left until the next step is due
+		inline double GetTimeToNextStep() const { return m_stepTime - m_accumulator; }
+
+		/// total number of steps dropped by the cap
+		inline int GetNumDroppedSteps() const { return m_numDroppedSteps; }
+
+	private:
+		double		m_stepTime;
+		double		m_accumulator;
+		int			m_maxSteps;
+		int			m_numDroppedSteps;
+	};
+
+	/// lock-free triple buffer handing data from one producer thread to one consumer thread
+	/// The producer always has a slot to write to and the consumer always gets the newest published slot, neither side waits
+	/// for the other. A consumer with nothing else to do can block in WaitAcquire until the next Publish.
+	template< typename T >
+	class TripleBuffer
+	{
+	public:
+		TripleBuffer()
+			: m_writeIndex(0)
+			, m_readIndex(1)
+			, m_shared(2)
+		{
+		}
+
+		/// slot owned by the producer
+		inline T& GetWriteBuffer() { return m_buffers[m_writeIndex]; }
+
+		/// hand the written slot over to the consumer, producer continues with the previously shared slot
+		inline void Publish()
+		{
+			const int prev = m_shared.exchange(m_writeIndex | FRESH_FLAG, std::memory_order_acq_rel);
+			m_writeIndex = prev & INDEX_MASK;
+
+			// the lock orders us after a consumer that checked the flag and is about to wait
+			{
+				std::lock_guard< std::mutex > lock(m_waitLock);
+			}
+
+			m_published.notify_one();
+		}
+
+		/// take the newest published slot, returns false (and keeps the current one) if nothing was published since last call
+		inline bool Acquire()
+		{
+			if ((m_shared.load(std::memory_order_relaxed) & FRESH_FLAG) == 0)
+				return false;
+
+			const int prev = m_shared.exchange(m_readIndex, std::memory_order_acq_rel);
+			m_readIndex = prev & INDEX_MASK;
+			return true;
+		}
+
+		/// Acquire, waits up to the timeout (in seconds) for the producer if nothing new was published yet
+		inline bool WaitAcquire(const double timeout)
+		{
+			if (Acquire())
+				return true;
+
+			{
+				std::unique_lock< std::mutex > lock(m_waitLock);
+				m_published.wait_for(lock, std::chrono::duration< double >(timeout), [this]()
+					{
+						return (m_shared.load(std::memory_order_relaxed) & FRESH_FLAG) != 0;
+					});
+			}
+
+			return Acquire();
+		}
+
+		/// slot owned by the consumer
+		inline T& GetReadBuffer() { return m_buffers[m_readIndex]; }
+
+	private:
+		static const int INDEX_MASK = 3;
+		static const int FRESH_FLAG = 4;
+
+		T							m_buffers[3];
+		int							m_writeIndex;
+		int							m_readIndex;
+		std::atomic< int >			m_shared; // slot index in between + fresh flag
+
+		std::mutex					m_waitLock; // only for the sleeping consumer, the slots are never touched under it
+		std::condition_variable		m_published;
+	};
+
+	/// additional app initialization data (needed for DirectCompute)
+	/// The device pointers are null when running headless.
+	struct AppInitContext
+	{
+		uint32_t				m_width;
+		uint32_t				m_height;
+
+		ID3D11Device* m_device;
+		ID3D11DeviceContext* m_deviceContext;
+
+		JobSystem*				m_jobSystem; // shared worker pool
+	};
+
+	/// renderable vertex
+	struct RenderVertex
+	{
+		float x, y;
+		TColor color;
+	};
+
+	/// closed outline in unit space, drawn by instances as a loop of lines
+	struct RenderOutline
+	{
+		static const int MAX_POINTS = 8;
+
+		int		m_numPoints;
+		float	m_sizeScale; // point = instance position + (instance size * scale) * unit point
+		float	m_x[MAX_POINTS];
+		float	m_y[MAX_POINTS];
+	};
+
+	/// outlines the instances refer to by index, shared by all frames and renderers
+	/// Outlines are only ever added (usually during app setup), readers don't lock.
+	class RenderOutlineTable
+	{
+	public:
+		static const int MAX_OUTLINES = 32;
+
+		RenderOutlineTable();
+
+		/// register outline, returns its index (same index for an identical outline) or -1 if invalid or the table is full
+		int Register(const RenderOutline& outline);
+
+		inline int GetNumOutlines() const { return m_numOutlines.load(std::memory_order_acquire); }
+		inline const RenderOutline& GetOutline(const int index) const { return m_outlines[index]; }
+
+		/// number of outline points, 0 for unknown outline
+		inline int GetNumPoints(const uint32_t index) const
+		{
+			return (index < (uint32_t)GetNumOutlines()) ? m_outlines[index].m_numPoints : 0;
+		}
+
+		static inline RenderOutlineTable& GetInstance()
+		{
+			return st_instance;
+		}
+
+	private:
+		std::mutex				m_lock;
+		RenderOutline			m_outlines[MAX_OUTLINES];
+		std::atomic< int >		m_numOutlines;
+
+		static RenderOutlineTable st_instance;
+	};
+
+	/// renderable outline instance, expanded into lines by the renderer
+	struct RenderInstance
+	{
+		float x, y;
+		float size;
+		uint32_t outline;
+		TColor color;
+	};
+
+	/// expand instances into line list vertices, 2 per outline edge, returns number of written vertices
+	/// The points match AddLine( x + scaled[i], y + scaled[i], x + scaled[i+1], y + scaled[i+1] ) bit for bit.
+	int ExpandRenderInstances(const RenderInstance* instances, const int numInstances, RenderVertex* outVertices);
+
+	/// number of vertices ExpandRenderInstances writes for given instances
+	int CountRenderInstanceVertices(const RenderInstance* instances, const int numInstances);
+
+	/// renderable string, the text is stored in the text arena of its frame (see RenderFrame::GetText)
+	struct RenderString
+	{
+		int x, y;
+		TColor color;
+		int textOffset;
+		int textLength; // without the terminating zero
+	};
+
+	/// vertex memory statistics of a render frame
+	struct RenderFrameStats
+	{
+		int			m_numVertices; // written this frame
+		int			m_numInstances; // outline instances this frame
+		int			m_numDroppedVertices; // dropped this frame because the budget was exhausted
+		int			m_highWaterMark; // most vertices written in a single frame
+		int			m_numChunks; // allocated vertex chunks
+		size_t		m_reservedBytes; // memory held by the vertex chunks
+	};
+
+	/// collections of data to render that represent a single frame
+	/// Vertices live in fixed size chunks that are allocated on demand and kept for the following frames,
+	/// so the memory follows the actual scene size (up to the vertex budget) instead of a worst case.
+	class RenderFrame
+	{
+	public:
+		static const int CHUNK_VERTICES = 64 * 1024; // even, lines are never split between chunks
+		static const int DEFAULT_MAX_VERTICES = 64 * CHUNK_VERTICES; // about 48MB
+		static const int MAX_STRING_LENGTH = 1023; // longer strings are cut
+
+		RenderFrame();
+
+		void Reset();
+		const std::vector< RenderString >& GetStrings() const { return m_strings; }
+
+		/// zero terminated text of a string of this frame, valid until the frame is reset
+		inline const char* GetText(const RenderString& str) const { return m_text.data() + str.textOffset; }
+
+		/// how far the rendered time is between the previous (0) and the last (1) simulation step
+		inline float GetInterpolationAlpha() const { return m_interpolationAlpha; }
+		inline void SetInterpolationAlpha(const float alpha) { m_interpolationAlpha = alpha; }
+
+		/// limit of vertices per frame, lines past it are dropped (and counted)
+		void SetMaxVertices(const int maxVertices);
+
+		inline void SetColor(const TColor color)
+		{
+			m_currentColor = color;
+		}
+
+		inline void AddLine(const float x0, const float y0, const float x1, const float y1)
+		{
+			if (m_writePtr == m_endPtr && !NextChunk())
+			{
+				m_numDroppedVertices += 2;
+				return;
+			}
+
+			m_writePtr->color = m_currentColor;
+			m_writePtr->x = x0;
+			m_writePtr->y = y0;
+			++m_writePtr;
+
+			m_writePtr->color = m_currentColor;
+			m_writePtr->x = x1;
+			m_writePtr->y = y1;
+			++m_writePtr;
+		}
+
+		/// add instance of a registered outline (see RenderOutlineTable), drawn with the current color
+		inline void AddInstance(const float x, const float y, const float size, const int outline)
+		{
+			RenderInstance instance;
+			instance.x = x;
+			instance.y = y;
+			instance.size = size;
+			instance.outline = (uint32_t)outline;
+			instance.color = m_currentColor;
+			m_instances.push_back(instance);
+		}
+
+		void AddString(const int x, const int y, const TColor color, const char* txt, ...);
+
+		/// outline instances of this frame, drawn before the lines
+		inline const std::vector< RenderInstance >& GetInstances() const { return m_instances; }
+
+		/// number of vertices written this frame
+		int GetNumVertices() const;
+
+		/// written vertex chunks, all but the last one are full
+		inline int GetNumUsedChunks() const { return m_numUsedChunks; }
+		const RenderVertex* GetChunk(const int index, int& outNumVertices) const;
+
+		RenderFrameStats GetStats() const;
+
+	private:
+		RenderFrame(const RenderFrame&) = delete;
+		RenderFrame& operator=(const RenderFrame&) = delete;
+
+		bool NextChunk();
+
+		TColor			m_currentColor;
+		float			m_interpolationAlpha;
+
+		std::vector< std::unique_ptr< RenderVertex[] > >	m_chunks;
+		int				m_numUsedChunks;
+		int				m_maxChunks;
+
+		RenderVertex* m_writePtr;
+		RenderVertex* m_endPtr;
+
+		int				m_numDroppedVertices;
+		int				m_highWaterMark;
+
+		std::vector< RenderInstance >	m_instances; // capacity kept between frames
+		std::vector< RenderString >		m_strings;
+		std::vector< char >				m_text; // text arena of the strings, only grows so formatting doesn't allocate
+		int								m_textSize; // used part of the arena
+	};
+
+	/// small pool of render frames for callers that need a frame only temporarily (e.g. once per engine tick)
+	/// Frames keep their vertex chunks while pooled. Thread safe.
+	class RenderFramePool
+	{
+	public:
+		RenderFramePool(const int maxPooledFrames = 2);
+
+		/// get a reset frame, allocates a new one only if the pool is empty
+		RenderFrame* Acquire();
+
+		/// give the frame back, it's deleted if the pool is already full
+		void Release(RenderFrame* frame);
+
+	private:
+		std::mutex										m_lock;
+		std::vector< std::unique_ptr< RenderFrame > >	m_frames;
+		int												m_maxPooledFrames;
+	};
+
+	/// offsets of a streaming upload ring (the buffer itself belongs to the renderer)
+	/// Ranges are handed out front to back, a range that does not fit the rest of the ring starts over at the beginning.
+	class StreamRing
+	{
+	public:
+		explicit StreamRing(const int capacity = 0);
+
+		void SetCapacity(const int capacity);
+		inline int GetCapacity() const { return m_capacity; }
+
+		/// reserve given amount, returns offset of the range or -1 if it's larger than the whole ring
+		int Allocate(const int size);
+
+		/// forget the previous allocations, next one starts at the beginning
+		inline void Reset() { m_offset = 0; }
+
+	private:
+		int		m_capacity;
+		int		m_offset;
+	};
+
+	/// split elements into batches of at most maxBatch, calls fn( first, count ) for every batch in order
+	/// The batch size is rounded down to the granularity so primitives are never split (2 for line list vertices).
+	template< typename Fn >
+	inline void ForEachStreamBatch(const int numElements, const int maxBatch, const int granularity, Fn&& fn)
+	{
+		const int batchSize = maxBatch - (maxBatch % granularity);
+		if (batchSize <= 0)
+			return;
+
+		for (int first = 0; first < numElements; first += batchSize)
+		{
+			const int count = (numElements - first < batchSize) ? (numElements - first) : batchSize;
+			fn(first, count);
+		}
+	}
+
+} // app
@@ -0,0 +1,189 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <type_traits>
+#include <condition_variable>
+
+namespace app
+{
+	/// linear scratch allocator, memory is kept between resets
+	/// Also keeps one growable array per element type (GetArray) for results of unknown size, e.g. gathered indices.
+	class ScratchBuffer
+	{
+	public:
+		ScratchBuffer();
+		~ScratchBuffer();
+
+		/// allocate memory valid until next Reset()
+		void* Alloc(const size_t size, const size_t alignment = 16);
+
+		template< typename T >
+		inline T* AllocArray(const size_t count)
+		{
+			return (T*)Alloc(sizeof(T) * count, alignof(T));
+		}
+
+		/// release all allocations (memory stays reserved, the arrays are kept)
+		void Reset();
+
+		/// array of given element type owned by this scratch, its capacity is kept between uses
+		/// There is one array per type, the user clears it and must be done with it before anything else running on the
+		/// same worker asks for the same type.
+		template< typename T >
+		inline std::vector< T >& GetArray()
+		{
+			static const int st_slot = AllocateArraySlot();
+
+			if ((int)m_arrays.size() <= st_slot)
+				m_arrays.resize(st_slot + 1);
+
+			auto& holder = m_arrays[st_slot];
+			if (!holder)
+				holder.reset(new ArrayHolder< T >());
+
+			return static_cast<ArrayHolder< T >*>(holder.get())->m_array;
+		}
+
+	private:
+		static const size_t BLOCK_SIZE = 64 * 1024;
+
+		struct Block
+		{
+			unsigned char*	m_data;
+			size_t			m_size;
+		};
+
+		struct ArrayHolderBase
+		{
+			virtual ~ArrayHolderBase() {}
+		};
+
+		template< typename T >
+		struct ArrayHolder : public ArrayHolderBase
+		{
+			std::vector< T >	m_array;
+		};
+
+		/// next free GetArray slot, shared by all buffers
+		static int AllocateArraySlot();
+
+		std::vector< Block >								m_blocks;
+		size_t												m_currentBlock;
+		size_t												m_offset;
+		std::vector< std::unique_ptr< ArrayHolderBase > >	m_arrays; // indexed by the slot of the element type
+	};
+
+	/// group of tasks that can be waited for
+	class TaskGroup
+	{
+	public:
+		TaskGroup() : m_pending(0) {}
+
+		inline bool IsDone() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<int>	m_pending;
+	};
+
+	/// persistent work-stealing thread pool
+	/// The thread that calls Wait/ParallelFor helps with the work, so a pool with one worker
+	/// has no threads at all and runs everything inline.
+	/// All threads outside of the pool run as worker 0, they take turns: a second one entering Wait/ParallelFor
+	/// blocks until the first one leaves, so worker 0's queue and scratch are never shared.
+	class JobSystem
+	{
+	public:
+		typedef void (*TRangeFunc)(void* data, const int begin, const int end, const int workerIndex);
+
+		/// create pool with given total number of workers (including the calling thread), 0 - one per hardware thread
+		JobSystem(const int numWorkers = 0);
+		~JobSystem();
+
+		/// number of workers, including the calling thread
+		inline int GetNumWorkers() const { return m_numWorkers; }
+
+		/// index of the worker running on the current thread, 0 for threads outside of the pool
+		int GetCurrentWorkerIndex() const;
+
+		/// scratch memory of given worker, only the worker itself may use it (the index passed to the tasks)
+		inline ScratchBuffer& GetScratch(const int workerIndex) { return m_scratch[workerIndex]; }
+
+		/// schedule generic task, task( workerIndex )
+		void Run(TaskGroup& group, std::function<void(int)> task);
+
+		/// wait for all tasks of the group to finish, the calling thread executes tasks meanwhile
+		void Wait(TaskGroup& group);
+
+		/// split range into chunks of grainSize and process them in parallel, fn( begin, end, workerIndex )
+		template< typename Fn >
+		inline void ParallelFor(const int begin, const int end, const int grainSize, Fn&& fn)
+		{
+			typedef typename std::remove_reference<Fn>::type TFn;
+
+			TRangeFunc kernel = [](void* data, const int rangeBegin, const int rangeEnd, const int workerIndex)
+			{
+				(*(TFn*)data)(rangeBegin, rangeEnd, workerIndex);
+			};
+
+			ParallelFor(begin, end, grainSize, kernel, (void*)&fn);
+		}
+
+		void ParallelFor(const int begin, const int end, const int grainSize, TRangeFunc func, void* data);
+
+	private:
+		struct Task
+		{
+			TRangeFunc		m_func;
+			void*			m_data;
+			int				m_begin;
+			int				m_end;
+			TaskGroup*		m_group;
+		};
+
+		struct WorkerQueue
+		{
+			std::mutex			m_lock;
+			std::deque< Task >	m_tasks;
+		};
+
+		/// binds the calling thread to a worker for the duration of a call, outside threads take turns as worker 0
+		class CallerScope;
+
+		void Dispatch(const int begin, const int end, const int grainSize, TRangeFunc func, void* data, const int workerIndex);
+		void WaitAsWorker(TaskGroup& group, const int workerIndex);
+
+		void Push(const int workerIndex, const Task& task);
+		bool Pop(const int workerIndex, Task& outTask);
+		void Execute(const Task& task, const int workerIndex);
+		void WakeWorkers();
+
+		void WorkerLoop(const int workerIndex);
+
+		static const int SPIN_COUNT = 2000;
+
+		int									m_numWorkers;
+		std::vector< std::thread >			m_threads;
+		std::unique_ptr< WorkerQueue[] >	m_queues;
+		std::unique_ptr< ScratchBuffer[] >	m_scratch;
+
+		std::atomic<int>					m_numQueuedTasks;
+		std::atomic<int>					m_numSleeping;
+		std::atomic<bool>					m_exit;
+
+		std::mutex							m_outsideCallerLock; // held by the outside thread running as worker 0
+
+		std::mutex							m_sleepLock;
+		std::condition_variable				m_wakeUp;
+	};
+
+} // app
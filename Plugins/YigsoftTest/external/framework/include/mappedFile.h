@@ -0,0 +1,41 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace app
+{
+
+	/// read-only memory mapping of a whole file
+	/// The contents stay valid until Close (or destruction), the pages are loaded on first access.
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		/// map given file, returns false if it can't be opened (empty files map to no data)
+		bool Open(const char* path);
+		void Close();
+
+		inline const uint8_t* GetData() const { return m_data; }
+		inline size_t GetSize() const { return m_size; }
+
+	private:
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t*	m_data;
+		size_t			m_size;
+
+#ifdef _WIN32
+		void*			m_file; // HANDLE
+		void*			m_mapping; // HANDLE
+#else
+		int				m_file;
+#endif
+	};
+
+} // app
@@ -0,0 +1,63 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include "physicsTestApp.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+namespace test
+{
+
+	/// scene and stepping shared by all compared apps
+	struct ComparisonSettings
+	{
+		int			m_numBodies = 1000; // the body limit is raised to fit
+		int			m_scenario = 0;
+		uint64_t	m_seed = 1;
+		int			m_numTicks = 500;
+		int			m_numWarmupTicks = 10; // stepped but not timed, drift is measured from the start
+		float		m_timeDelta = 1.0f / 60.0f;
+		float		m_driftTolerance = 0.01f; // distance at which an app counts as diverged from the baseline
+		bool		m_resetScene = true; // false keeps the scenes the apps already have (e.g. loaded from one snapshot)
+	};
+
+	/// app taking part in a comparison
+	struct ComparedApp
+	{
+		PhysicsTestApp*	m_app;
+		const char*		m_name; // label in the results, variants of one app need their own
+	};
+
+	/// measurements of one app, timings are in seconds
+	struct ComparisonResult
+	{
+		const char*	m_name;
+		int			m_numBodies;
+
+		double		m_mean;
+		double		m_p50;
+		double		m_p99;
+		double		m_max;
+		double		m_total;
+		double		m_speedup; // baseline mean / mean, over 1 is faster than the baseline
+
+		bool		m_hasDrift; // false if this app or the baseline can't read back positions
+		float		m_maxDrift; // distance to the same body of the baseline after the last tick
+		float		m_meanDrift;
+		int			m_divergedTick; // first tick (warmup included) with a drift over the tolerance, -1 if never
+	};
+
+	/// steps several apps side by side on the same generated scene, the first app is the baseline
+	/// The apps must be initialized, their scenes are replaced unless disabled in the settings. Every tick steps all apps once (the app that goes first
+	/// rotates, so none of them always runs with the caches of another one) and compares the body positions with
+	/// the baseline outside of the timed part. Positions are matched by index, so the apps must keep the spawn order.
+	bool RunComparison(const std::vector< ComparedApp >& apps, const ComparisonSettings& settings, std::vector< ComparisonResult >& outResults);
+
+	/// print a table of the results
+	void PrintComparison(FILE* f, const ComparisonSettings& settings, const std::vector< ComparisonResult >& results);
+
+} // test
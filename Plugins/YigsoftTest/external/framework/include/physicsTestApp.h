@@ -1,6 +1,10 @@
 #pragma once
 
 #include "app.h"
+#include "random.h"
+#include "simCounters.h"
+
+#include <vector>
 
 namespace test
 {
@@ -9,21 +13,56 @@ namespace test
 	const float MaxSize = 15.0f;
 	const float MinSize = 4.0f;
 	const float BodySpeed = 50.0f;
-	const int MaxBodies = 10000;
+	const int MaxBodies = 10000; // default body limit, see PhysicsTestApp::SetMaxBodies
+	const int LargeScaleMaxBodies = 1024 * 1024; // body limit of the large scale mode
 	const int MaxShapeTypes = 3;
 
+	/// body to spawn, see PhysicsTestApp::SpawnBodies
+	struct BodySpawn
+	{
+		int		m_shapeType;
+		float	m_x;
+		float	m_y;
+		float	m_size;
+		float	m_velX;
+		float	m_velY;
+	};
+
 	class PhysicsTestApp : public app::IApp
 	{
 	public:
 		PhysicsTestApp( const char* appName );
 		
 		int GetScenario() const;
+		inline const char* GetName() const { return m_appName; }
 		virtual bool OnInit( const app::AppInitContext& initContext ) override;
 		virtual void OnKeyPressed( const int keyCode ) override;
 		virtual void OnRender( app::RenderFrame& frame ) const override;
 		virtual void OnAppSwitched( app::IApp* prevApp ) override;
+
+		/// add or remove bodies to reach given count (capped at the body limit)
 		void SetNumBodies(int numBodies);
+
+		/// limit of the number of bodies, bodies over a lowered limit are removed
+		void SetMaxBodies(int maxBodies);
+		inline int GetMaxBodies() const { return m_maxBodies; }
+
+		/// switch scenario, bodies are respawned in the new layout
 		void SetScenario(int scenario);
+
+		/// restart the scene generation from given seed, same seed and same actions give the same scene
+		void SetSeed(uint64_t seed);
+		inline uint64_t GetSeed() const { return m_seed; }
+
+		/// bodies generated since the seed was set
+		inline uint64_t GetNumSpawned() const { return m_numSpawned; }
+
+		/// position in the app's random stream
+		inline uint64_t GetRandomCounter() const { return m_random.GetCounter(); }
+
+		/// bodies number [firstSpawn, firstSpawn + numSpawns) of the current scenario, depends only on the seed, scenario and index
+		void GenerateSpawns(uint64_t firstSpawn, int numSpawns, BodySpawn* outSpawns) const;
+
 		/// get number of bodies in the scene
 		virtual int GetNumBodies() const = 0;
 
@@ -33,15 +72,49 @@ namespace test
 		/// remove N bodies from the scene
 		virtual void RemoveBodies( int numObjects ) = 0;
 
+		/// add generated bodies in bulk, by default one AddBody per spawn (velocity is left to AddBody)
+		virtual void SpawnBodies( const BodySpawn* spawns, int numSpawns );
+
+		/// copy the body positions in the spawn order, returns false if the app can't read them back (see RunComparison)
+		virtual bool GetBodyPositions( std::vector< float >& outX, std::vector< float >& outY ) const { return false; }
+
+		/// work done by the last tick, all zero if the app does not count
+		inline const SimCounters& GetCounters() const { return m_counters; }
+
+		/// draw the counters in the overlay (C to toggle)
+		inline void SetShowCounters( bool show ) { m_showCounters = show; }
+		inline bool IsShowingCounters() const { return m_showCounters; }
+
+	protected:
+		/// random numbers for the app's own use, seeded with the scene
+		inline app::Random& GetRandom() { return m_random; }
+
+		/// publish counters of the tick that just finished
+		inline void SetCounters( const SimCounters& counters ) { m_counters = counters; }
+
+		/// continue the scene generation from a saved state (the bodies are restored by the app), nothing is respawned
+		void RestoreSceneState( int scenario, uint64_t seed, uint64_t numSpawned, uint64_t randomCounter );
+
 	private:
 		void AddBodies( int numBodies );
 		void ChangeScenario( int newScenario );
 
+		/// bodies added or removed by the +- keys, scales with the limit
+		int GetBodyStep() const;
+
 		const char*		 m_appName;
 		int				m_scenario;
-		int      m_currentScenario;
-		int            m_numBodies;
+		int				m_maxBodies;
 		static const int NUM_SCENARIOS = 2;
+
+		uint64_t					m_seed;
+		app::Random					m_spawnRandom;
+		app::Random					m_random;
+		uint64_t					m_numSpawned; // bodies generated since the seed was set
+		std::vector< BodySpawn >	m_spawnScratch;
+
+		SimCounters					m_counters;
+		bool						m_showCounters;
 	};
 
 } // app
@@ -0,0 +1,101 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include "frameworkCore.h"
+
+#include <stdint.h>
+
+/// Named zone profiler, zones are compiled out completely with APP_PROFILER=0
+/// When compiled in but not capturing a zone costs one relaxed atomic load.
+#ifndef APP_PROFILER
+	#define APP_PROFILER 1
+#endif
+
+namespace app
+{
+
+	/// finished zone (or frame marker when start == end and the depth is -1)
+	struct ProfileEvent
+	{
+		const char*		m_name; // static string, only the pointer is stored
+		Timer::TTicks	m_start;
+		Timer::TTicks	m_end;
+		int				m_depth; // nesting level on the thread
+	};
+
+	/// capture of zone timings into per-thread ring buffers
+	/// Each thread writes only its own buffer, nothing is locked on the recording path (except the first zone of
+	/// a thread that registers its buffer). When a buffer wraps around the oldest zones are overwritten.
+	class Profiler
+	{
+	public:
+		static const int BUFFER_EVENTS = 64 * 1024; // per thread
+
+		/// start or stop capturing, zones already open when the capture starts are not recorded
+		static void SetEnabled(const bool enabled);
+		static inline bool IsEnabled() { return st_enabled.load(std::memory_order_relaxed); }
+
+		/// name of the calling thread in the trace (copied)
+		static void SetThreadName(const char* name);
+
+		/// mark frame boundary on the calling thread
+		static void MarkFrame();
+
+		/// drop everything captured so far
+		static void Clear();
+
+		/// write captured zones as Chrome trace-event JSON (Perfetto, about:tracing), returns false if the file can't be written
+		/// Can be called while capturing, zones written during the export may be missing.
+		static bool ExportChromeTrace(const char* path);
+
+		/// used by ProfileZone
+		static int BeginZone();
+		static void EndZone(const char* name, const Timer::TTicks start, const int depth);
+
+	private:
+		static std::atomic< bool > st_enabled;
+	};
+
+	/// scoped zone, use the PROFILE_ZONE macro
+	class ProfileZone
+	{
+	public:
+		inline ProfileZone(const char* name)
+			: m_name(name)
+			, m_start(0)
+			, m_depth(-1)
+		{
+			if (Profiler::IsEnabled())
+			{
+				m_depth = Profiler::BeginZone();
+				m_start = Timer::GetInstance().GetNow();
+			}
+		}
+
+		inline ~ProfileZone()
+		{
+			if (m_depth >= 0)
+				Profiler::EndZone(m_name, m_start, m_depth);
+		}
+
+	private:
+		ProfileZone(const ProfileZone&) = delete;
+		ProfileZone& operator=(const ProfileZone&) = delete;
+
+		const char*		m_name;
+		Timer::TTicks	m_start;
+		int				m_depth;
+	};
+
+} // app
+
+#define APP_PROFILE_CONCAT_INNER(a, b) a##b
+#define APP_PROFILE_CONCAT(a, b) APP_PROFILE_CONCAT_INNER(a, b)
+
+#if APP_PROFILER
+	/// time the rest of the scope, name must be a string literal (or otherwise outlive the capture)
+	#define PROFILE_ZONE(name) ::app::ProfileZone APP_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+	#define PROFILE_ZONE(name) ((void)0)
+#endif
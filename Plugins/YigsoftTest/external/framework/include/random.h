@@ -0,0 +1,72 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include <stdint.h>
+
+namespace app
+{
+
+	/// counter-based random numbers, value N of a stream is a pure function of (seed, stream, N)
+	/// There is no hidden state to share, streams are independent and values can be generated in any order
+	/// (or in parallel) with the same result.
+	class Random
+	{
+	public:
+		explicit Random(const uint64_t seed = 0, const uint64_t stream = 0)
+			: m_key(Mix(Mix(seed) ^ (stream * STREAM_STEP + 1)))
+			, m_counter(0)
+		{
+		}
+
+		/// independent stream derived from this one
+		inline Random Split(const uint64_t stream) const
+		{
+			Random ret;
+			ret.m_key = Mix(m_key ^ (stream * STREAM_STEP + 1));
+			return ret;
+		}
+
+		/// random bits at given position of the stream
+		inline uint64_t GetBits(const uint64_t counter) const
+		{
+			return Mix(m_key + counter * COUNTER_STEP);
+		}
+
+		/// uniform float in [0,1) at given position of the stream
+		inline float GetFloat(const uint64_t counter) const
+		{
+			return (float)(GetBits(counter) >> 40) * (1.0f / 16777216.0f);
+		}
+
+		/// uniform integer in [0,range) at given position of the stream
+		inline uint32_t GetInt(const uint64_t counter, const uint32_t range) const
+		{
+			return (uint32_t)(((GetBits(counter) >> 32) * range) >> 32);
+		}
+
+		/// sequential access, advances the internal counter
+		inline uint64_t NextBits() { return GetBits(m_counter++); }
+		inline float NextFloat() { return GetFloat(m_counter++); }
+		inline uint32_t NextInt(const uint32_t range) { return GetInt(m_counter++, range); }
+
+		inline uint64_t GetCounter() const { return m_counter; }
+		inline void SetCounter(const uint64_t counter) { m_counter = counter; }
+
+	private:
+		static const uint64_t COUNTER_STEP = 0x9E3779B97F4A7C15ull;
+		static const uint64_t STREAM_STEP = 0xD1B54A32D192ED03ull;
+
+		/// SplitMix64 finalizer
+		static inline uint64_t Mix(uint64_t value)
+		{
+			value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+			value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+			return value ^ (value >> 31);
+		}
+
+		uint64_t	m_key;
+		uint64_t	m_counter;
+	};
+
+} // app
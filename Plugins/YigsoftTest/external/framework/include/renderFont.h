@@ -8,12 +8,15 @@
 
 namespace app
 {
+	struct GlyphQuad;
+
 	namespace utils
 	{
 		class BufferInfo;
 	}
 
 	/// Printable font
+	/// Glyph quads of all strings (see TextBatcher) are drawn together, one upload and one draw per MAX_RENDER_CHARS.
 	class RenderFont
 	{
 	public:
@@ -21,13 +24,13 @@ namespace app
 		~RenderFont();
 
 		bool Init( ID3D11Device* device );
-		void Draw( ID3D11DeviceContext* deviceContext, const int x, const int y, const unsigned int color, const char* txt ) const;
+		void Draw( ID3D11DeviceContext* deviceContext, const GlyphQuad* quads, const int numQuads ) const;
 
 	private:
 		static const int MAX_RENDER_CHARS = 4096;
 
-		static const int MAX_RENDER_VERTICES = 6*MAX_RENDER_CHARS;
-		static const int MAX_RENDER_INDICES = 4*MAX_RENDER_CHARS;
+		static const int MAX_RENDER_VERTICES = 4*MAX_RENDER_CHARS;
+		static const int MAX_RENDER_INDICES = 6*MAX_RENDER_CHARS;
 
 		ID3D11Texture2D*			m_texture;
 		ID3D11ShaderResourceView*	m_textureView;
@@ -36,26 +39,13 @@ namespace app
 		ID3D11VertexShader*			m_vertexShader;
 		ID3D11InputLayout*			m_vertexLayout;
 
-		utils::BufferInfo*			m_indexBuffer;
+		ID3D11Buffer*				m_indexBuffer; // immutable, two triangles for every quad of the vertex buffer
 		utils::BufferInfo*			m_vertexBuffer;
 
 		ID3D11RasterizerState*		m_rasterState;
 		ID3D11DepthStencilState*	m_depthState;
 		ID3D11BlendState*			m_blendState;
 
-		struct CharInfo
-		{
-			float x0;
-			float y0;
-			float x1;
-			float y1;
-			float width;
-			float height;
-			float xOffset;
-			float yOffset;
-			float xAdvance;
-		};
-
 #pragma pack(push, 1)
 		struct FontVertex
 		{
@@ -64,10 +54,6 @@ namespace app
 			DWORD color;
 		};
 #pragma pack(pop)
-
-		CharInfo		m_chars[ 256 ];
-
-		bool ParseFontData();
 	};
 
 } // app
\ No newline at end of file
@@ -21,8 +21,19 @@ namespace app
 		bool Init( ID3D11Device* device );
 		void Draw( ID3D11DeviceContext* deviceContext, const RenderVertex* vertice, const int numVertices );
 
+		/// draw outline instances, expanded on the GPU or on the CPU if instancing is not available
+		void DrawInstances( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances );
+
 	private:
+		// sizes of the upload rings, larger draws are streamed through them in several batches
 		static const int MAX_RENDER_VERTICES = 1024*1024;
+		static const int MAX_RENDER_INSTANCES = 256*1024;
+		static const int EXPAND_BATCH_VERTICES = 64*1024;
+
+		bool InitInstancing( ID3D11Device* device );
+		void SetupState( ID3D11DeviceContext* deviceContext );
+		void DrawExpanded( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances );
+		void DrawInstanced( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances );
 
 		ID3D11PixelShader*			m_pixelShader;
 		ID3D11VertexShader*			m_vertexShader;
@@ -30,6 +41,13 @@ namespace app
 
 		utils::BufferInfo*			m_vertexBuffer;
 
+		// GPU expansion of outline instances, null if not supported
+		ID3D11VertexShader*			m_instanceShader;
+		ID3D11InputLayout*			m_instanceLayout;
+		utils::BufferInfo*			m_instanceBuffer;
+		ID3D11Buffer*				m_outlineConstants;
+		int							m_numUploadedOutlines;
+
 		ID3D11RasterizerState*		m_rasterState;
 		ID3D11DepthStencilState*	m_depthState;
 		ID3D11BlendState*			m_blendState;
@@ -8,6 +8,7 @@ namespace app
 {
 	class RenderFont;
 	class RenderLines;
+	class TextBatcher;
 
 	/// basic DX11 "renderer"
 	class Renderer
@@ -35,6 +36,7 @@ namespace app
 
 		RenderFont*			m_fontRenderer;
 		RenderLines*		m_linesRenderer;
+		TextBatcher*		m_textBatcher; // strings of the frame laid out for a single font draw
 	};
 
 } // app
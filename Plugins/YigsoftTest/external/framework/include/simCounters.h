@@ -0,0 +1,67 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include <stdint.h>
+
+namespace test
+{
+
+	/// work done by the simulation in one tick, explains how the tick time scales with the body density
+	/// Counting is a few integer adds per body, it's always on.
+	struct SimCounters
+	{
+		int64_t		m_numPairs; // candidate pairs handed out by the broadphase (attraction and collision)
+		int64_t		m_numOverlapTests; // shape overlap tests, including the retests after a correction
+		int64_t		m_numOverlaps; // overlap tests that hit
+		int64_t		m_numAttractorHits; // bodies that found an attractor
+		int64_t		m_numCorrections; // positional corrections applied
+		int64_t		m_numNeighbours; // collision candidates of all bodies
+		int			m_maxNeighbours; // most collision candidates of a single body
+		int			m_numBodies;
+
+		inline SimCounters()
+		{
+			Reset();
+		}
+
+		inline void Reset()
+		{
+			m_numPairs = 0;
+			m_numOverlapTests = 0;
+			m_numOverlaps = 0;
+			m_numAttractorHits = 0;
+			m_numCorrections = 0;
+			m_numNeighbours = 0;
+			m_maxNeighbours = 0;
+			m_numBodies = 0;
+		}
+
+		/// merge counters of another part of the same tick (e.g. another worker)
+		inline void Add(const SimCounters& other)
+		{
+			m_numPairs += other.m_numPairs;
+			m_numOverlapTests += other.m_numOverlapTests;
+			m_numOverlaps += other.m_numOverlaps;
+			m_numAttractorHits += other.m_numAttractorHits;
+			m_numCorrections += other.m_numCorrections;
+			m_numNeighbours += other.m_numNeighbours;
+			if (other.m_maxNeighbours > m_maxNeighbours)
+				m_maxNeighbours = other.m_maxNeighbours;
+		}
+
+		/// record collision candidates of one body
+		inline void AddNeighbours(const int count)
+		{
+			m_numNeighbours += count;
+			if (count > m_maxNeighbours)
+				m_maxNeighbours = count;
+		}
+
+		inline float GetAvgNeighbours() const
+		{
+			return m_numBodies ? (float)((double)m_numNeighbours / m_numBodies) : 0.0f;
+		}
+	};
+
+} // test
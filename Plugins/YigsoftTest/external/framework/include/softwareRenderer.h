@@ -0,0 +1,75 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include "frameworkCore.h"
+#include "textLayout.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace app
+{
+	class JobSystem;
+
+	/// timings and sizes of the last frame drawn by the software renderer
+	struct SoftwareRenderStats
+	{
+		int			m_numLines; // after the instance expansion
+		int			m_numBinnedLines; // line references of all tiles, lines crossing tiles are counted once per tile
+		int			m_numGlyphs;
+		int			m_numStrings;
+		int			m_numCachedStrings; // strings with a reused layout
+		double		m_prepareTime; // instance expansion, gathering of the lines and text layout
+		double		m_binTime;
+		double		m_rasterTime;
+	};
+
+	/// CPU rasterizer of the RenderFrame, the GPU free counterpart of the D3D11 Renderer
+	/// Lines are binned into screen tiles and every tile is cleared and drawn by one worker, in the frame order
+	/// (instances, lines, strings), so the result does not depend on the number of workers. Lines are one pixel
+	/// wide and opaque, glyphs use the blending of the font shader. The pixels use the back buffer layout (R8G8B8A8).
+	class SoftwareRenderer
+	{
+	public:
+		static const int TILE_SIZE = 64;
+
+		SoftwareRenderer(const int width = (int)Resolution::WIDTH, const int height = (int)Resolution::HEIGHT);
+
+		/// draw the frame, the tiles are split between the workers of given job system (inline without one)
+		void Render(const RenderFrame& frame, JobSystem* jobSystem = nullptr);
+
+		inline int GetWidth() const { return m_width; }
+		inline int GetHeight() const { return m_height; }
+		inline const uint32_t* GetPixels() const { return m_pixels.data(); }
+		inline const SoftwareRenderStats& GetStats() const { return m_stats; }
+
+		/// FNV-1a hash of the pixels, compares two frames pixel for pixel
+		uint64_t GetChecksum() const;
+
+		/// write the pixels as binary PPM (P6), returns false on error
+		bool WritePPM(const char* path) const;
+
+	private:
+		void PrepareLines(const RenderFrame& frame, JobSystem* jobSystem);
+		void BinLines(JobSystem* jobSystem);
+		void DrawTile(const int tileIndex);
+
+		int								m_width;
+		int								m_height;
+		int								m_numTilesX;
+		int								m_numTilesY;
+		std::vector< uint32_t >			m_pixels;
+
+		std::vector< RenderVertex >		m_vertices; // 2 per line, kept between frames
+		std::vector< int >				m_batchCounts; // per instance or bin batch
+		std::vector< int >				m_binOffsets; // per bin batch and tile
+		std::vector< int >				m_tileStart; // first line reference of every tile (+ end)
+		std::vector< uint32_t >			m_tileLines; // line references ordered by tile
+		TextBatcher						m_text;
+
+		SoftwareRenderStats				m_stats;
+	};
+
+} // app
@@ -0,0 +1,122 @@
+/// (C) Yigsoft 2023
+
+#pragma once
+
+#include "frameworkCore.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace app
+{
+
+	/// glyph of the built-in font, in texture pixels
+	struct FontGlyph
+	{
+		int16_t		x, y;
+		int16_t		width, height;
+		int16_t		xOffset, yOffset;
+		int16_t		xAdvance; // 0 for characters missing in the font
+	};
+
+	/// built-in bitmap font (fontData.inl, generated using http://www.angelcode.com/products/bmfont/)
+	/// Shared by the renderers, the glyphs are parsed and the texture is converted once.
+	class Font
+	{
+	public:
+		static const int TEXTURE_WIDTH = 256;
+		static const int TEXTURE_HEIGHT = 128;
+
+		Font();
+
+		inline bool IsValid() const { return m_valid; }
+		inline const FontGlyph& GetGlyph(const unsigned char ch) const { return m_glyphs[ch]; }
+
+		/// glyph coverage, TEXTURE_WIDTH x TEXTURE_HEIGHT (A8)
+		inline const uint8_t* GetAlpha() const { return m_alpha.data(); }
+
+		static inline const Font& GetInstance()
+		{
+			return st_instance;
+		}
+
+	private:
+		bool Parse();
+
+		FontGlyph				m_glyphs[256];
+		std::vector< uint8_t >	m_alpha;
+		bool					m_valid;
+
+		static Font st_instance;
+	};
+
+	/// glyph placed on the screen, one textured quad
+	struct GlyphQuad
+	{
+		int			x, y;
+		int16_t		width, height;
+		int16_t		srcX, srcY; // in the font texture
+		TColor		color;
+	};
+
+	/// text layout statistics of the last built batch
+	struct TextBatchStats
+	{
+		int		m_numStrings;
+		int		m_numGlyphs;
+		int		m_numCacheHits; // strings whose layout was reused
+		int		m_numCachedLayouts;
+	};
+
+	/// lays out all strings of a frame into a single stream of glyph quads, in the frame order
+	/// Layouts are cached by text, so strings that don't change between frames (help lines, labels) are only copied
+	/// and offset. Layouts not used by the last frame are dropped once the cache grows over its limit.
+	class TextBatcher
+	{
+	public:
+		/// key of the cached layouts, the texts are still compared so colliding keys only cost a new layout
+		typedef uint64_t (*THashFunc)(const char* text, const int length);
+
+		/// FNV-1a of the text, the default key
+		static uint64_t HashText(const char* text, const int length);
+
+		TextBatcher(const int maxCachedLayouts = 256, const THashFunc hashFunc = &HashText);
+
+		/// lay out the strings of given frame, replaces the previous quads
+		void Build(const RenderFrame& frame);
+
+		/// quads of the last build, valid until the next one
+		inline const std::vector< GlyphQuad >& GetQuads() const { return m_quads; }
+
+		inline const TextBatchStats& GetStats() const { return m_stats; }
+
+		/// forget all cached layouts
+		void ClearCache();
+
+	private:
+		/// layout of a text placed at 0,0 (quad colors are not used)
+		struct CachedLayout
+		{
+			std::string					m_text;
+			std::vector< GlyphQuad >	m_quads;
+			uint32_t					m_lastUsed; // build index
+		};
+
+		void Layout(const char* text, const int length, std::vector< GlyphQuad >& outQuads) const;
+		void TrimCache();
+
+		const Font&			m_font;
+
+		std::vector< GlyphQuad >						m_quads;
+		std::unordered_map< uint64_t, CachedLayout >	m_cache; // by text hash
+		THashFunc										m_hashFunc;
+		int												m_maxCachedLayouts;
+		uint32_t										m_buildIndex;
+
+		TextBatchStats		m_stats;
+	};
+
+} // app
@@ -4,6 +4,8 @@
 
 #include <d3d11.h>
 
+#include "frameworkCore.h"
+
 /// Generated using: http://www.angelcode.com/products/bmfont/
 
 namespace app
@@ -20,13 +22,14 @@ namespace app
 			inline ID3D11Buffer* GetBuffer() { return m_buffer; }
 			inline ID3D11Buffer** GetBufferPtr() { return &m_buffer; }
 
+			/// map range of given size for writing, returns nullptr (and offset -1) if it can not be mapped
 			void* Lock( ID3D11DeviceContext* context, int size, int& outOffset );
 			void UnlockAndUpload( ID3D11DeviceContext* context );
 
 		public:
 			ID3D11Buffer*	m_buffer;
 			int				m_size;
-			int				m_offset;
+			StreamRing		m_ring; // in bytes
 
 			int				m_copyLockOffset;
 			int				m_copyLockSize;
@@ -34,20 +37,30 @@ namespace app
 		};
 
 		/// mapped writes
+		/// If the range could not be locked the writer is empty: writes are skipped and there is nothing to draw.
 		class BufferWriter
 		{
 		public:
 			BufferWriter( ID3D11DeviceContext* context, BufferInfo* info, int size, int& outOffset );
 			~BufferWriter();
 
+			inline bool IsLocked() const
+			{
+				return m_writePtr != nullptr;
+			}
+
 			template< typename T >
 			inline void Write( const T& data )
 			{
-				assert( m_writePtr + sizeof(data) < m_endPtr );
+				if ( !m_writePtr )
+					return;
+
+				assert( m_writePtr + sizeof(data) <= m_endPtr );
 				*(T*) m_writePtr = data;
 				m_writePtr += sizeof(data);
 			}
 
+			/// nullptr if not locked
 			inline void* GetData() const
 			{
 				return  m_writePtr;
@@ -3,10 +3,27 @@
 #include "framework.h"
 #include "app.h"
 #include "renderer.h"
+#include "jobSystem.h"
+#include "profiler.h"
+#include "softwareRenderer.h"
+#include "physicsComparison.h"
 
 namespace app
 {
 
+	/// zone capture toggled with the P key is saved here (working directory)
+	static const char* const TRACE_PATH = "trace.json";
+
+	/// frame drawn by the software renderer after the F key
+	static const char* const FRAME_PATH = "frame.ppm";
+
+	/// A/B comparison of the registered apps after the A key (ticks stepped by every app)
+	static const char* const COMPARE_PATH = "compare.txt";
+	static const int COMPARE_TICKS = 300;
+
+	/// longest wait of the pipelined main thread for a new frame, the window messages are pumped at least this often
+	static const double FRAME_WAIT_TIME = 0.01;
+
 	app::Framework* app::Framework::st_globalFrameworkInstance = nullptr;
 
 
@@ -40,17 +57,40 @@ namespace app
 		, m_lastAvgAppTickTime(0.0)
 		, m_lastAvgAppRenderTime(0.0)
 		, m_numAvgFrames(0)
+		, m_timestep(1.0f / 120.0f, 8)
+		, m_useFixedTimestep(true)
+		, m_lastNumSubsteps(0)
+		, m_pipelined(false)
+		, m_frames(nullptr)
+		, m_lastSubmitTime(0.0)
+		, m_numWorkers(0)
+		, m_jobSystem(nullptr)
+		, m_softwareRenderer(nullptr)
+		, m_dumpFrame(false)
 	{
 	}
 
 	Framework::~Framework()
 	{
-		delete m_frame;
+		if (m_simThread.joinable())
+		{
+			m_done = true;
+			m_simThread.join();
+		}
+
+		if (m_frames)
+			delete m_frames;
+		else
+			delete m_frame;
 		delete m_renderer;
+		delete m_softwareRenderer;
 		delete m_window;
 
 		for (auto* ptr : m_apps)
 			delete ptr;
+
+		// apps may still use the workers while being destroyed
+		delete m_jobSystem;
 	}
 
 	void Framework::RegisterApp(IApp* app)
@@ -59,12 +99,26 @@ namespace app
 			m_apps.push_back(app);
 	}
 
+	void Framework::SetNumWorkers(const int numWorkers)
+	{
+		assert(m_jobSystem == nullptr);
+		m_numWorkers = numWorkers;
+	}
+
+	void Framework::SetPipelined(const bool pipelined)
+	{
+		assert(m_frame == nullptr);
+		m_pipelined = pipelined;
+	}
+
 	bool Framework::Init()
 	{
 		// no apps
 		if (m_apps.empty())
 			return false;
 
+		Profiler::SetThreadName("Main");
+
 		// create app window
 		m_window = new Window();
 
@@ -76,14 +130,26 @@ namespace app
 		if (!m_renderer->Init(m_window->GetHandle()))
 			return false;
 
-		// create renderable frame
-		m_frame = new RenderFrame();
+		// create renderable frame, the pipelined mode needs one for each thread and one in between
+		if (m_pipelined)
+		{
+			m_frames = new TripleBuffer< RenderFrame >();
+			m_frame = &m_frames->GetReadBuffer();
+		}
+		else
+		{
+			m_frame = new RenderFrame();
+		}
+
+		// create worker pool shared by the apps
+		m_jobSystem = new JobSystem(m_numWorkers);
 
 		AppInitContext initContext;
 		initContext.m_width = (DWORD)Resolution::WIDTH;
 		initContext.m_height = (DWORD)Resolution::HEIGHT;
 		initContext.m_device = m_renderer->GetDevice();
 		initContext.m_deviceContext = m_renderer->GetDeviceContext();
+		initContext.m_jobSystem = m_jobSystem;
 
 		// initialize user applications
 		for (auto* ptr : m_apps)
@@ -96,6 +162,12 @@ namespace app
 
 	void Framework::Loop()
 	{
+		if (m_pipelined)
+		{
+			LoopPipelined();
+			return;
+		}
+
 		auto prev = Timer::GetInstance().GetNow();
 
 		while (!m_done)
@@ -104,25 +176,82 @@ namespace app
 			auto delta = Timer::GetInstance().ToSecondsIntv(cur - prev);
 			prev = cur;
 
+			Profiler::MarkFrame();
+
 			// pump windows messages
 			PumpMessages();
 
 			// process buffered input
 			ProcessInput();
 
-			// tick app
-			{
-				auto timeDelta = (float)delta;
-				if (timeDelta > 0.01f)
-					timeDelta = 0.01f;
-
-				Tick(timeDelta);
-			}
+			// tick app, input is applied before the first substep
+			TickSubsteps(delta);
 
 			// render app
 			Render();
 
 			// process counted frame averages
+			m_numAvgFrames += 1;
+			ProcessAverage();
+		}
+	}
+
+	void Framework::LoopPipelined()
+	{
+		m_simThread = std::thread([this]() { RunSimulation(); });
+
+		while (!m_done)
+		{
+			// pump windows messages, key presses get buffered for the simulation thread
+			PumpMessages();
+
+			// nothing new to show, sleep until the simulation thread publishes a frame
+			if (!m_frames->WaitAcquire(FRAME_WAIT_TIME))
+				continue;
+
+			// submit the newest finished frame, it is not touched by the simulation thread until the next Acquire
+			m_frame = &m_frames->GetReadBuffer();
+			m_frame->AddString(400, 10, RGB(190, 190, 190), "Submit: %6.2f ms", 1000.0 * m_lastSubmitTime);
+
+			ScopedTimer timer;
+			m_renderer->Render(*m_frame);
+			m_lastSubmitTime = timer.GetElaspedTime();
+		}
+
+		m_simThread.join();
+	}
+
+	void Framework::RunSimulation()
+	{
+		Profiler::SetThreadName("Simulation");
+
+		auto prev = Timer::GetInstance().GetNow();
+
+		while (!m_done)
+		{
+			auto cur = Timer::GetInstance().GetNow();
+			auto delta = Timer::GetInstance().ToSecondsIntv(cur - prev);
+			prev = cur;
+
+			Profiler::MarkFrame();
+
+			// input is applied at tick boundaries only
+			ProcessInput();
+
+			TickSubsteps(delta);
+
+			// the state did not change, keep the last published frame and sleep until the next step is due
+			if (m_lastNumSubsteps == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::duration< double >(m_timestep.GetTimeToNextStep()));
+				continue;
+			}
+
+			// build the frame while the main thread is still submitting the previous one
+			BuildFrame(m_frames->GetWriteBuffer());
+			m_frames->Publish();
+
+			m_numAvgFrames += 1;
 			ProcessAverage();
 		}
 	}
@@ -198,6 +327,24 @@ namespace app
 			RequestExit();
 		}
 
+		// zone capture
+		else if (pressedKey == 'P')
+		{
+			ToggleProfiler();
+		}
+
+		// software rendered frame
+		else if (pressedKey == 'F')
+		{
+			m_dumpFrame = true;
+		}
+
+		// A/B comparison of all apps
+		else if (pressedKey == 'A')
+		{
+			CompareApps();
+		}
+
 		// pass to app
 		else
 		{
@@ -206,34 +353,146 @@ namespace app
 		}
 	}
 
+	void Framework::ToggleProfiler()
+	{
+		if (!Profiler::IsEnabled())
+		{
+			Profiler::Clear();
+			Profiler::SetEnabled(true);
+			return;
+		}
+
+		Profiler::SetEnabled(false);
+		Profiler::ExportChromeTrace(TRACE_PATH);
+	}
+
+	void Framework::DumpFrame(const RenderFrame& frame)
+	{
+		if (!m_softwareRenderer)
+			m_softwareRenderer = new SoftwareRenderer();
+
+		m_softwareRenderer->Render(frame, m_jobSystem);
+		m_softwareRenderer->WritePPM(FRAME_PATH);
+	}
+
+	void Framework::CompareApps()
+	{
+		// all registered apps are physics test apps (see PhysicsTestApp::OnAppSwitched), the current one is the baseline
+		std::vector< test::ComparedApp > apps;
+		for (auto* ptr : m_apps)
+		{
+			test::ComparedApp compared;
+			compared.m_app = static_cast< test::PhysicsTestApp* >(ptr);
+			compared.m_name = compared.m_app->GetName();
+			apps.push_back(compared);
+		}
+
+		std::swap(apps[0], apps[m_currentApp]);
+
+		// same scene as on the screen, respawned from its seed
+		test::ComparisonSettings settings;
+		settings.m_numBodies = apps[0].m_app->GetNumBodies();
+		settings.m_scenario = apps[0].m_app->GetScenario();
+		settings.m_seed = apps[0].m_app->GetSeed();
+		settings.m_numTicks = COMPARE_TICKS;
+		settings.m_timeDelta = m_useFixedTimestep ? m_timestep.GetStepTime() : 0.01f;
+
+		std::vector< test::ComparisonResult > results;
+		if (test::RunComparison(apps, settings, results))
+		{
+			FILE* f = fopen(COMPARE_PATH, "w");
+			if (f)
+			{
+				test::PrintComparison(f, settings, results);
+				fclose(f);
+			}
+			else
+			{
+				fprintf(stderr, "Unable to write '%s'\n", COMPARE_PATH);
+			}
+		}
+
+		// the stall is not part of the app timings
+		ResetAverages();
+	}
+
+	void Framework::SetFixedTimestep(const float stepTime, const int maxSubsteps)
+	{
+		m_useFixedTimestep = (stepTime > 0.0f);
+		if (m_useFixedTimestep)
+			m_timestep.Configure(stepTime, maxSubsteps);
+	}
+
+	void Framework::TickSubsteps(const double frameTime)
+	{
+		m_lastAppTickTime = 0.0;
+
+		if (!m_useFixedTimestep)
+		{
+			// legacy mode, single clamped tick per frame
+			auto timeDelta = (float)frameTime;
+			if (timeDelta > 0.01f)
+				timeDelta = 0.01f;
+
+			Tick(timeDelta);
+			m_lastNumSubsteps = 1;
+			return;
+		}
+
+		// whole steps only, no rendering in between
+		const auto numSteps = m_timestep.Advance(frameTime);
+		const auto stepTime = m_timestep.GetStepTime();
+		for (int i = 0; i < numSteps; ++i)
+			Tick(stepTime);
+
+		m_lastNumSubsteps = numSteps;
+	}
+
 	void Framework::Tick(const float timeDelta)
 	{
+		PROFILE_ZONE("Framework::Tick");
+
 		ScopedTimer timer; // for timing user implementation
 
 		auto* app = m_apps[m_currentApp];
 		app->OnTick(timeDelta);
 
-		m_lastAppTickTime = timer.GetElaspedTime();
-		m_avgAppTickTime += m_lastAppTickTime;
-		m_numAvgFrames += 1;
+		// accumulated over all substeps of the frame
+		const auto tickTime = timer.GetElaspedTime();
+		m_lastAppTickTime += tickTime;
+		m_avgAppTickTime += tickTime;
 	}
 
-	void Framework::Render()
+	void Framework::BuildFrame(RenderFrame& frame)
 	{
-		m_frame->Reset();
+		PROFILE_ZONE("Framework::BuildFrame");
+
+		frame.Reset();
+		frame.SetInterpolationAlpha(m_useFixedTimestep ? m_timestep.GetAlpha() : 1.0f);
 
 		{
 			ScopedTimer timer; // for timing user implementation
 
 			auto* app = m_apps[m_currentApp];
-			app->OnRender(*m_frame);
+			app->OnRender(frame);
 
 			m_lastAppRenderTime = timer.GetElaspedTime();
 			m_avgAppRenderTime += m_lastAppRenderTime;
 		}
 
 		// stats (not coutned in user section)
-		RenderStats(*m_frame);
+		RenderStats(frame);
+
+		if (m_dumpFrame)
+		{
+			m_dumpFrame = false;
+			DumpFrame(frame);
+		}
+	}
+
+	void Framework::Render()
+	{
+		BuildFrame(*m_frame);
 
 		// present
 		m_renderer->Render(*m_frame);
@@ -243,7 +502,14 @@ namespace app
 	{
 		frame.AddString(10, 10, RGB(255, 255, 255), "Render: %6.2f ms (avg: %6.3fms)", 1000.0 * m_lastAppRenderTime, 1000.0 * m_lastAvgAppRenderTime);
 		frame.AddString(10, 30, RGB(255, 255, 255), "Tick: %6.2f ms (avg: %6.3fms)", 1000.0 * m_lastAppTickTime, 1000.0 * m_lastAvgAppTickTime);
-		frame.AddString(10, 50, RGB(190, 190, 190), "Press 1-9 to switch between apps");
+		if (m_useFixedTimestep)
+			frame.AddString(400, 30, RGB(190, 190, 190), "Steps: %d at %.0f Hz (alpha: %.2f, dropped: %d)", m_lastNumSubsteps, 1.0f / m_timestep.GetStepTime(), m_timestep.GetAlpha(), m_timestep.GetNumDroppedSteps());
+		frame.AddString(10, 50, RGB(190, 190, 190), "Press 1-9 to switch between apps, P to capture a trace, F to save the frame, A to compare the apps");
+		if (Profiler::IsEnabled())
+			frame.AddString(400, 70, RGB(255, 120, 120), "Capturing zones, P to stop and save %s", TRACE_PATH);
+
+		const auto frameStats = frame.GetStats();
+		frame.AddString(400, 50, RGB(190, 190, 190), "Instances: %d, vertices: %d (peak: %d, dropped: %d, %d KB)", frameStats.m_numInstances, frameStats.m_numVertices, frameStats.m_highWaterMark, frameStats.m_numDroppedVertices, (int)(frameStats.m_reservedBytes / 1024));
 	}
 
 	namespace helper
@@ -301,33 +567,6 @@ namespace app
 
 	//-----
 
-	Timer::Timer()
-	{
-		QueryPerformanceFrequency((LARGE_INTEGER*)&m_freq);
-		QueryPerformanceCounter((LARGE_INTEGER*)&m_base);
-	}
-
-	Timer::TTicks Timer::GetNow()
-	{
-		Timer::TTicks ret = 0;
-		QueryPerformanceCounter((LARGE_INTEGER*)&ret);
-		return ret;
-	}
-
-	double Timer::ToSeconds(TTicks time)
-	{
-		return (double)(time - m_base) / (double)m_freq;
-	}
-
-	double Timer::ToSecondsIntv(TTicks time)
-	{
-		return (double)(time) / (double)m_freq;
-	}
-
-	Timer Timer::st_instance;
-
-	//-----
-
 	bool Window::st_classRegistered = false;
 	const wchar_t* Window::st_className = L"YigsoftTestFramework";
 
@@ -456,40 +695,4 @@ namespace app
 		}
 	}
 
-	//-----
-
-	RenderFrame::RenderFrame()
-	{
-		Reset();
-	}
-
-	void RenderFrame::Reset()
-	{
-		m_currentColor = 0xFFFFFFFF;
-		m_writePtr = &m_vertices[0];
-		m_endPtr = &m_vertices[MAX_VERTICES - 2];
-
-		m_strings.clear();
-	}
-
-	void RenderFrame::AddString(const int x, const int y, const DWORD color, const char* txt, ...)
-	{
-		va_list args;
-		char buf[1024];
-
-		va_start(args, txt);
-		vsprintf_s(buf, txt, args);
-		va_end(args);
-
-		RenderString info;
-		info.x = x;
-		info.y = y;
-		info.color = color;
-		info.text = buf;
-
-		m_strings.push_back(info);
-	}
-
-	//-----
-
 }
\ No newline at end of file
@@ -0,0 +1,370 @@
+/// (C) Yigsoft 2023
+
+#include "frameworkCore.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include <chrono>
+#include <algorithm>
+
+namespace app
+{
+
+	//-----
+
+	namespace helper
+	{
+		static inline Timer::TTicks GetClockTicks()
+		{
+			const auto now = std::chrono::steady_clock::now().time_since_epoch();
+			return (Timer::TTicks)std::chrono::duration_cast< std::chrono::nanoseconds >(now).count();
+		}
+	}
+
+	Timer::Timer()
+	{
+		m_freq = 1000000000; // nanoseconds
+		m_base = helper::GetClockTicks();
+	}
+
+	Timer::TTicks Timer::GetNow()
+	{
+		return helper::GetClockTicks();
+	}
+
+	double Timer::ToSeconds(TTicks time)
+	{
+		return (double)(time - m_base) / (double)m_freq;
+	}
+
+	double Timer::ToSecondsIntv(TTicks time)
+	{
+		return (double)(time) / (double)m_freq;
+	}
+
+	Timer Timer::st_instance;
+
+	//-----
+
+	FixedTimestep::FixedTimestep(const float stepTime, const int maxSteps)
+		: m_stepTime(stepTime)
+		, m_accumulator(0.0)
+		, m_maxSteps(maxSteps)
+		, m_numDroppedSteps(0)
+	{
+	}
+
+	void FixedTimestep::Configure(const float stepTime, const int maxSteps)
+	{
+		m_stepTime = stepTime;
+		m_maxSteps = (maxSteps > 0) ? maxSteps : 1;
+		Reset();
+	}
+
+	int FixedTimestep::Advance(const double elapsedTime)
+	{
+		if (elapsedTime > 0.0)
+			m_accumulator += elapsedTime;
+
+		int numSteps = (int)(m_accumulator / m_stepTime);
+		m_accumulator -= numSteps * m_stepTime;
+
+		// death spiral protection, keep only the fraction of the step
+		if (numSteps > m_maxSteps)
+		{
+			m_numDroppedSteps += numSteps - m_maxSteps;
+			numSteps = m_maxSteps;
+		}
+
+		return numSteps;
+	}
+
+	void FixedTimestep::Reset()
+	{
+		m_accumulator = 0.0;
+	}
+
+	//-----
+
+	RenderOutlineTable RenderOutlineTable::st_instance;
+
+	RenderOutlineTable::RenderOutlineTable()
+		: m_numOutlines(0)
+	{
+		memset(m_outlines, 0, sizeof(m_outlines));
+	}
+
+	int RenderOutlineTable::Register(const RenderOutline& outline)
+	{
+		if (outline.m_numPoints < 2 || outline.m_numPoints > RenderOutline::MAX_POINTS)
+			return -1;
+
+		// unused points are zeroed so identical outlines compare equal
+		RenderOutline entry;
+		memset(&entry, 0, sizeof(entry));
+		entry.m_numPoints = outline.m_numPoints;
+		entry.m_sizeScale = outline.m_sizeScale;
+		for (int i = 0; i < outline.m_numPoints; ++i)
+		{
+			entry.m_x[i] = outline.m_x[i];
+			entry.m_y[i] = outline.m_y[i];
+		}
+
+		std::lock_guard< std::mutex > lock(m_lock);
+
+		const int numOutlines = m_numOutlines.load(std::memory_order_relaxed);
+		for (int i = 0; i < numOutlines; ++i)
+		{
+			if (0 == memcmp(&m_outlines[i], &entry, sizeof(entry)))
+				return i;
+		}
+
+		if (numOutlines == MAX_OUTLINES)
+		{
+			fprintf(stderr, "Render outline table is full\n");
+			return -1;
+		}
+
+		// publish after the data is written
+		m_outlines[numOutlines] = entry;
+		m_numOutlines.store(numOutlines + 1, std::memory_order_release);
+		return numOutlines;
+	}
+
+	int ExpandRenderInstances(const RenderInstance* instances, const int numInstances, RenderVertex* outVertices)
+	{
+		const auto& table = RenderOutlineTable::GetInstance();
+		const uint32_t numOutlines = (uint32_t)table.GetNumOutlines();
+
+		RenderVertex* writePtr = outVertices;
+		for (int i = 0; i < numInstances; ++i)
+		{
+			const auto& instance = instances[i];
+			if (instance.outline >= numOutlines)
+				continue;
+
+			const auto& outline = table.GetOutline(instance.outline);
+			const float scale = instance.size * outline.m_sizeScale;
+
+			float px[RenderOutline::MAX_POINTS];
+			float py[RenderOutline::MAX_POINTS];
+			for (int j = 0; j < outline.m_numPoints; ++j)
+			{
+				px[j] = instance.x + scale * outline.m_x[j];
+				py[j] = instance.y + scale * outline.m_y[j];
+			}
+
+			for (int j = 0; j < outline.m_numPoints; ++j)
+			{
+				const int next = (j + 1 < outline.m_numPoints) ? (j + 1) : 0;
+
+				writePtr[0].x = px[j];
+				writePtr[0].y = py[j];
+				writePtr[0].color = instance.color;
+				writePtr[1].x = px[next];
+				writePtr[1].y = py[next];
+				writePtr[1].color = instance.color;
+				writePtr += 2;
+			}
+		}
+
+		return (int)(writePtr - outVertices);
+	}
+
+	int CountRenderInstanceVertices(const RenderInstance* instances, const int numInstances)
+	{
+		const auto& table = RenderOutlineTable::GetInstance();
+
+		int numVertices = 0;
+		for (int i = 0; i < numInstances; ++i)
+			numVertices += 2 * table.GetNumPoints(instances[i].outline);
+
+		return numVertices;
+	}
+
+	//-----
+
+	RenderFrame::RenderFrame()
+		: m_numUsedChunks(0)
+		, m_maxChunks(DEFAULT_MAX_VERTICES / CHUNK_VERTICES)
+		, m_writePtr(nullptr)
+		, m_endPtr(nullptr)
+		, m_numDroppedVertices(0)
+		, m_highWaterMark(0)
+		, m_textSize(0)
+	{
+		Reset();
+	}
+
+	void RenderFrame::Reset()
+	{
+		const int numVertices = GetNumVertices();
+		if (numVertices > m_highWaterMark)
+			m_highWaterMark = numVertices;
+
+		m_currentColor = 0xFFFFFFFF;
+		m_interpolationAlpha = 1.0f;
+
+		// first AddLine picks up the first chunk
+		m_numUsedChunks = 0;
+		m_writePtr = nullptr;
+		m_endPtr = nullptr;
+		m_numDroppedVertices = 0;
+
+		m_instances.clear();
+		m_strings.clear();
+		m_textSize = 0;
+	}
+
+	void RenderFrame::SetMaxVertices(const int maxVertices)
+	{
+		const int numChunks = (maxVertices + CHUNK_VERTICES - 1) / CHUNK_VERTICES;
+		m_maxChunks = (numChunks > 1) ? numChunks : 1;
+	}
+
+	bool RenderFrame::NextChunk()
+	{
+		if (m_numUsedChunks >= m_maxChunks)
+			return false;
+
+		// reuse chunks from previous frames
+		if (m_numUsedChunks == (int)m_chunks.size())
+			m_chunks.emplace_back(new RenderVertex[CHUNK_VERTICES]);
+
+		m_writePtr = m_chunks[m_numUsedChunks].get();
+		m_endPtr = m_writePtr + CHUNK_VERTICES;
+		m_numUsedChunks += 1;
+		return true;
+	}
+
+	int RenderFrame::GetNumVertices() const
+	{
+		if (m_numUsedChunks == 0)
+			return 0;
+
+		const RenderVertex* lastChunk = m_chunks[m_numUsedChunks - 1].get();
+		return (m_numUsedChunks - 1) * CHUNK_VERTICES + (int)(m_writePtr - lastChunk);
+	}
+
+	const RenderVertex* RenderFrame::GetChunk(const int index, int& outNumVertices) const
+	{
+		const RenderVertex* chunk = m_chunks[index].get();
+		outNumVertices = (index == m_numUsedChunks - 1) ? (int)(m_writePtr - chunk) : CHUNK_VERTICES;
+		return chunk;
+	}
+
+	RenderFrameStats RenderFrame::GetStats() const
+	{
+		RenderFrameStats stats;
+		stats.m_numVertices = GetNumVertices();
+		stats.m_numInstances = (int)m_instances.size();
+		stats.m_numDroppedVertices = m_numDroppedVertices;
+		stats.m_highWaterMark = (stats.m_numVertices > m_highWaterMark) ? stats.m_numVertices : m_highWaterMark;
+		stats.m_numChunks = (int)m_chunks.size();
+		stats.m_reservedBytes = m_chunks.size() * CHUNK_VERTICES * sizeof(RenderVertex);
+		return stats;
+	}
+
+	void RenderFrame::AddString(const int x, const int y, const TColor color, const char* txt, ...)
+	{
+		// format straight into the arena, there is always room for the longest string
+		const size_t required = (size_t)m_textSize + MAX_STRING_LENGTH + 1;
+		if (m_text.size() < required)
+			m_text.resize(std::max(required, 2 * m_text.size()));
+
+		char* buf = m_text.data() + m_textSize;
+
+		va_list args;
+		va_start(args, txt);
+		int length = vsnprintf(buf, MAX_STRING_LENGTH + 1, txt, args);
+		va_end(args);
+
+		// formatting error gives an empty string
+		if (length < 0)
+		{
+			buf[0] = 0;
+			length = 0;
+		}
+		else if (length > MAX_STRING_LENGTH)
+		{
+			length = MAX_STRING_LENGTH;
+		}
+
+		RenderString info;
+		info.x = x;
+		info.y = y;
+		info.color = color;
+		info.textOffset = m_textSize;
+		info.textLength = length;
+
+		m_textSize += length + 1;
+		m_strings.push_back(info);
+	}
+
+	//-----
+
+	RenderFramePool::RenderFramePool(const int maxPooledFrames)
+		: m_maxPooledFrames(maxPooledFrames)
+	{
+	}
+
+	RenderFrame* RenderFramePool::Acquire()
+	{
+		{
+			std::lock_guard< std::mutex > lock(m_lock);
+			if (!m_frames.empty())
+			{
+				RenderFrame* frame = m_frames.back().release();
+				m_frames.pop_back();
+				return frame;
+			}
+		}
+
+		return new RenderFrame();
+	}
+
+	void RenderFramePool::Release(RenderFrame* frame)
+	{
+		if (!frame)
+			return;
+
+		frame->Reset();
+
+		std::unique_ptr< RenderFrame > ptr(frame);
+
+		std::lock_guard< std::mutex > lock(m_lock);
+		if ((int)m_frames.size() < m_maxPooledFrames)
+			m_frames.push_back(std::move(ptr));
+	}
+
+	//-----
+
+	StreamRing::StreamRing(const int capacity)
+		: m_capacity(0)
+		, m_offset(0)
+	{
+		SetCapacity(capacity);
+	}
+
+	void StreamRing::SetCapacity(const int capacity)
+	{
+		m_capacity = (capacity > 0) ? capacity : 0;
+		m_offset = 0;
+	}
+
+	int StreamRing::Allocate(const int size)
+	{
+		if (size < 0 || size > m_capacity)
+			return -1;
+
+		// never wrap in the middle of a range
+		const int offset = (m_offset + size > m_capacity) ? 0 : m_offset;
+		m_offset = offset + size;
+		return offset;
+	}
+
+	//-----
+
+}
@@ -0,0 +1,343 @@
+/// (C) Yigsoft 2023
+
+#include "jobSystem.h"
+#include "profiler.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+namespace app
+{
+
+	ScratchBuffer::ScratchBuffer()
+		: m_currentBlock(0)
+		, m_offset(0)
+	{
+	}
+
+	ScratchBuffer::~ScratchBuffer()
+	{
+		for (auto& block : m_blocks)
+			delete[] block.m_data;
+	}
+
+	void* ScratchBuffer::Alloc(const size_t size, const size_t alignment)
+	{
+		while (m_currentBlock < m_blocks.size())
+		{
+			auto& block = m_blocks[m_currentBlock];
+
+			const size_t base = (size_t)block.m_data;
+			const size_t start = ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+			if (start + size <= block.m_size)
+			{
+				m_offset = start + size;
+				return block.m_data + start;
+			}
+
+			// try next block
+			m_currentBlock += 1;
+			m_offset = 0;
+		}
+
+		// allocate new block, big allocations get their own
+		Block block;
+		block.m_size = (size + alignment > BLOCK_SIZE) ? (size + alignment) : BLOCK_SIZE;
+		block.m_data = new unsigned char[block.m_size];
+		m_blocks.push_back(block);
+
+		m_currentBlock = m_blocks.size() - 1;
+		m_offset = 0;
+		return Alloc(size, alignment);
+	}
+
+	void ScratchBuffer::Reset()
+	{
+		m_currentBlock = 0;
+		m_offset = 0;
+	}
+
+	int ScratchBuffer::AllocateArraySlot()
+	{
+		static std::atomic<int> st_numSlots(0);
+		return st_numSlots.fetch_add(1);
+	}
+
+	//-----
+
+	namespace helper
+	{
+		struct WorkerBinding
+		{
+			const JobSystem*	m_owner;
+			int					m_index;
+		};
+
+		static thread_local WorkerBinding st_currentWorker = { nullptr, 0 };
+
+		static void RunGenericTask(void* data, const int, const int, const int workerIndex)
+		{
+			std::unique_ptr< std::function<void(int)> > task((std::function<void(int)>*) data);
+			(*task)(workerIndex);
+		}
+	}
+
+	class JobSystem::CallerScope
+	{
+	public:
+		CallerScope(JobSystem& owner)
+			: m_owner(owner)
+			, m_prevBinding(helper::st_currentWorker)
+			, m_isOutside(helper::st_currentWorker.m_owner != &owner)
+		{
+			// pool threads and nested calls already have their index
+			if (!m_isOutside)
+				return;
+
+			// outside thread, it becomes worker 0 until the call returns, a second one waits for its turn
+			m_owner.m_outsideCallerLock.lock();
+			helper::st_currentWorker.m_owner = &m_owner;
+			helper::st_currentWorker.m_index = 0;
+		}
+
+		~CallerScope()
+		{
+			if (!m_isOutside)
+				return;
+
+			helper::st_currentWorker = m_prevBinding;
+			m_owner.m_outsideCallerLock.unlock();
+		}
+
+		inline int GetWorkerIndex() const { return helper::st_currentWorker.m_index; }
+
+	private:
+		JobSystem&					m_owner;
+		helper::WorkerBinding		m_prevBinding;
+		bool						m_isOutside;
+	};
+
+	JobSystem::JobSystem(const int numWorkers)
+		: m_numWorkers(numWorkers)
+		, m_numQueuedTasks(0)
+		, m_numSleeping(0)
+		, m_exit(false)
+	{
+		if (m_numWorkers <= 0)
+			m_numWorkers = (int)std::thread::hardware_concurrency();
+		if (m_numWorkers <= 0)
+			m_numWorkers = 1;
+
+		m_queues.reset(new WorkerQueue[m_numWorkers]);
+		m_scratch.reset(new ScratchBuffer[m_numWorkers]);
+
+		// worker 0 is the thread that waits for the work
+		for (int i = 1; i < m_numWorkers; ++i)
+			m_threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard< std::mutex > lock(m_sleepLock);
+			m_exit = true;
+		}
+
+		m_wakeUp.notify_all();
+
+		for (auto& thread : m_threads)
+			thread.join();
+	}
+
+	int JobSystem::GetCurrentWorkerIndex() const
+	{
+		return (helper::st_currentWorker.m_owner == this) ? helper::st_currentWorker.m_index : 0;
+	}
+
+	void JobSystem::Run(TaskGroup& group, std::function<void(int)> task)
+	{
+		Task info;
+		info.m_func = &helper::RunGenericTask;
+		info.m_data = new std::function<void(int)>(std::move(task));
+		info.m_begin = 0;
+		info.m_end = 0;
+		info.m_group = &group;
+
+		group.m_pending.fetch_add(1);
+
+		const CallerScope caller(*this);
+		if (m_numWorkers == 1)
+		{
+			Execute(info, caller.GetWorkerIndex());
+			return;
+		}
+
+		Push(caller.GetWorkerIndex(), info);
+		WakeWorkers();
+	}
+
+	void JobSystem::Wait(TaskGroup& group)
+	{
+		const CallerScope caller(*this);
+		WaitAsWorker(group, caller.GetWorkerIndex());
+	}
+
+	void JobSystem::ParallelFor(const int begin, const int end, const int grainSize, TRangeFunc func, void* data)
+	{
+		const CallerScope caller(*this);
+		Dispatch(begin, end, grainSize, func, data, caller.GetWorkerIndex());
+	}
+
+	void JobSystem::Dispatch(const int begin, const int end, const int grainSize, TRangeFunc func, void* data, const int workerIndex)
+	{
+		if (end <= begin)
+			return;
+
+		const int chunkSize = (grainSize > 0) ? grainSize : 1;
+
+		// nothing to split, run in place
+		if (m_numWorkers == 1 || (end - begin) <= chunkSize)
+		{
+			func(data, begin, end, workerIndex);
+			return;
+		}
+
+		// deal the chunks round robin so the workers do not have to steal everything from us
+		const int numChunks = (end - begin + chunkSize - 1) / chunkSize;
+
+		TaskGroup group;
+		group.m_pending.fetch_add(numChunks);
+
+		for (int i = 0; i < numChunks; ++i)
+		{
+			Task task;
+			task.m_func = func;
+			task.m_data = data;
+			task.m_begin = begin + i * chunkSize;
+			task.m_end = (task.m_begin + chunkSize < end) ? task.m_begin + chunkSize : end;
+			task.m_group = &group;
+
+			Push((workerIndex + i) % m_numWorkers, task);
+		}
+
+		WakeWorkers();
+		WaitAsWorker(group, workerIndex);
+	}
+
+	void JobSystem::WaitAsWorker(TaskGroup& group, const int workerIndex)
+	{
+		// help with the work (not only our own tasks) until all of the group are done
+		while (!group.IsDone())
+		{
+			Task task;
+			if (Pop(workerIndex, task))
+				Execute(task, workerIndex);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+	void JobSystem::Push(const int workerIndex, const Task& task)
+	{
+		auto& queue = m_queues[workerIndex];
+
+		{
+			std::lock_guard< std::mutex > lock(queue.m_lock);
+			queue.m_tasks.push_back(task);
+		}
+
+		m_numQueuedTasks.fetch_add(1);
+	}
+
+	bool JobSystem::Pop(const int workerIndex, Task& outTask)
+	{
+		if (m_numQueuedTasks.load(std::memory_order_relaxed) == 0)
+			return false;
+
+		// own work first (LIFO, still hot in cache)
+		{
+			auto& queue = m_queues[workerIndex];
+			std::lock_guard< std::mutex > lock(queue.m_lock);
+			if (!queue.m_tasks.empty())
+			{
+				outTask = queue.m_tasks.back();
+				queue.m_tasks.pop_back();
+				m_numQueuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+
+		// steal from others (FIFO, the biggest leftovers)
+		for (int i = 1; i < m_numWorkers; ++i)
+		{
+			auto& queue = m_queues[(workerIndex + i) % m_numWorkers];
+			std::lock_guard< std::mutex > lock(queue.m_lock);
+			if (!queue.m_tasks.empty())
+			{
+				outTask = queue.m_tasks.front();
+				queue.m_tasks.pop_front();
+				m_numQueuedTasks.fetch_sub(1);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Execute(const Task& task, const int workerIndex)
+	{
+		task.m_func(task.m_data, task.m_begin, task.m_end, workerIndex);
+		task.m_group->m_pending.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::WakeWorkers()
+	{
+		// spinning workers pick the work up on their own
+		if (m_numSleeping.load() > 0)
+		{
+			{
+				std::lock_guard< std::mutex > lock(m_sleepLock);
+			}
+
+			m_wakeUp.notify_all();
+		}
+	}
+
+	void JobSystem::WorkerLoop(const int workerIndex)
+	{
+		helper::st_currentWorker.m_owner = this;
+		helper::st_currentWorker.m_index = workerIndex;
+
+		char threadName[32];
+		snprintf(threadName, sizeof(threadName), "Worker %d", workerIndex);
+		Profiler::SetThreadName(threadName);
+
+		while (!m_exit)
+		{
+			Task task;
+			if (Pop(workerIndex, task))
+			{
+				Execute(task, workerIndex);
+				continue;
+			}
+
+			// spin for a while before going to sleep, keeps the wake-up latency low for back to back ParallelFor calls
+			bool hasWork = false;
+			for (int i = 0; i < SPIN_COUNT && !hasWork && !m_exit; ++i)
+			{
+				hasWork = m_numQueuedTasks.load(std::memory_order_relaxed) > 0;
+				if (!hasWork)
+					std::this_thread::yield();
+			}
+
+			if (hasWork)
+				continue;
+
+			std::unique_lock< std::mutex > lock(m_sleepLock);
+			m_numSleeping.fetch_add(1);
+			m_wakeUp.wait(lock, [this]() { return m_exit || m_numQueuedTasks.load() > 0; });
+			m_numSleeping.fetch_sub(1);
+		}
+	}
+
+} // app
@@ -0,0 +1,143 @@
+/// (C) Yigsoft 2023
+
+#include "mappedFile.h"
+
+#ifdef _WIN32
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace app
+{
+
+#ifdef _WIN32
+
+	MappedFile::MappedFile()
+		: m_data(nullptr)
+		, m_size(0)
+		, m_file(INVALID_HANDLE_VALUE)
+		, m_mapping(nullptr)
+	{
+	}
+
+	bool MappedFile::Open(const char* path)
+	{
+		Close();
+
+		m_file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size))
+		{
+			Close();
+			return false;
+		}
+
+		// mapping of an empty file fails, there is nothing to map anyway
+		m_size = (size_t)size.QuadPart;
+		if (m_size == 0)
+			return true;
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+		{
+			Close();
+			return false;
+		}
+
+		m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_data)
+		{
+			Close();
+			return false;
+		}
+
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+
+		if (m_mapping)
+			CloseHandle(m_mapping);
+
+		if (m_file != INVALID_HANDLE_VALUE)
+			CloseHandle(m_file);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+#else
+
+	MappedFile::MappedFile()
+		: m_data(nullptr)
+		, m_size(0)
+		, m_file(-1)
+	{
+	}
+
+	bool MappedFile::Open(const char* path)
+	{
+		Close();
+
+		m_file = open(path, O_RDONLY);
+		if (m_file < 0)
+			return false;
+
+		struct stat info;
+		if (fstat(m_file, &info) != 0)
+		{
+			Close();
+			return false;
+		}
+
+		m_size = (size_t)info.st_size;
+		if (m_size == 0)
+			return true;
+
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+		if (data == MAP_FAILED)
+		{
+			Close();
+			return false;
+		}
+
+		// the whole file is read front to back right away
+		madvise(data, m_size, MADV_SEQUENTIAL);
+
+		m_data = (const uint8_t*)data;
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (m_data)
+			munmap((void*)m_data, m_size);
+
+		if (m_file >= 0)
+			close(m_file);
+
+		m_data = nullptr;
+		m_size = 0;
+		m_file = -1;
+	}
+
+#endif
+
+	MappedFile::~MappedFile()
+	{
+		Close();
+	}
+
+} // app
@@ -0,0 +1,187 @@
+/// (C) Yigsoft 2023
+
+#include "physicsComparison.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+namespace test
+{
+	namespace helper
+	{
+		/// positions read back after a tick
+		struct Positions
+		{
+			std::vector< float >	m_x;
+			std::vector< float >	m_y;
+			bool					m_valid = false;
+		};
+
+		static double Percentile(const std::vector< double >& sortedTimes, const double fraction)
+		{
+			// nearest rank
+			const size_t count = sortedTimes.size();
+			size_t rank = (size_t)(fraction * (double)count + 0.999999);
+			if (rank < 1)
+				rank = 1;
+			if (rank > count)
+				rank = count;
+
+			return sortedTimes[rank - 1];
+		}
+
+		static void ComputeTimes(std::vector< double >& times, ComparisonResult& outResult)
+		{
+			outResult.m_total = 0.0;
+			for (const double time : times)
+				outResult.m_total += time;
+
+			std::sort(times.begin(), times.end());
+
+			outResult.m_mean = outResult.m_total / (double)times.size();
+			outResult.m_p50 = Percentile(times, 0.50);
+			outResult.m_p99 = Percentile(times, 0.99);
+			outResult.m_max = times.back();
+		}
+
+		/// distance of the bodies to the baseline ones, bodies missing in either app are not compared
+		static void ComputeDrift(const Positions& baseline, const Positions& positions, float& outMax, float& outMean)
+		{
+			const size_t numBodies = std::min(baseline.m_x.size(), positions.m_x.size());
+
+			double sum = 0.0;
+			float maxDrift = 0.0f;
+			for (size_t i = 0; i < numBodies; ++i)
+			{
+				const float dx = positions.m_x[i] - baseline.m_x[i];
+				const float dy = positions.m_y[i] - baseline.m_y[i];
+				const float drift = sqrtf(dx * dx + dy * dy);
+
+				// NaN counts as diverged
+				if (!(drift <= maxDrift))
+					maxDrift = (drift == drift) ? drift : INFINITY;
+
+				sum += drift;
+			}
+
+			outMax = maxDrift;
+			outMean = numBodies ? (float)(sum / (double)numBodies) : 0.0f;
+		}
+
+		static void ResetScene(PhysicsTestApp& app, const ComparisonSettings& settings)
+		{
+			// the scene depends only on the seed and scenario
+			app.SetNumBodies(0);
+			app.SetScenario(settings.m_scenario);
+			app.SetSeed(settings.m_seed);
+			if (settings.m_numBodies > app.GetMaxBodies())
+				app.SetMaxBodies(settings.m_numBodies);
+			app.SetNumBodies(settings.m_numBodies);
+		}
+	}
+
+	bool RunComparison(const std::vector< ComparedApp >& apps, const ComparisonSettings& settings, std::vector< ComparisonResult >& outResults)
+	{
+		outResults.clear();
+
+		if (apps.empty() || settings.m_numTicks <= 0 || settings.m_numWarmupTicks < 0 || settings.m_timeDelta <= 0.0f)
+		{
+			fprintf(stderr, "Comparison: nothing to compare\n");
+			return false;
+		}
+
+		const int numApps = (int)apps.size();
+		if (settings.m_resetScene)
+		{
+			for (const auto& app : apps)
+				helper::ResetScene(*app.m_app, settings);
+		}
+
+		std::vector< helper::Positions > positions(numApps);
+		std::vector< std::vector< double > > tickTimes(numApps);
+		for (auto& times : tickTimes)
+			times.reserve(settings.m_numTicks);
+
+		outResults.resize(numApps);
+		for (int i = 0; i < numApps; ++i)
+		{
+			auto& result = outResults[i];
+			result.m_name = apps[i].m_name;
+			result.m_numBodies = apps[i].m_app->GetNumBodies();
+			result.m_hasDrift = false;
+			result.m_maxDrift = 0.0f;
+			result.m_meanDrift = 0.0f;
+			result.m_divergedTick = -1;
+
+			if (result.m_numBodies != settings.m_numBodies)
+				fprintf(stderr, "Comparison: '%s' runs with %d bodies instead of %d\n", result.m_name, result.m_numBodies, settings.m_numBodies);
+		}
+
+		const int numTicks = settings.m_numWarmupTicks + settings.m_numTicks;
+		for (int tick = 0; tick < numTicks; ++tick)
+		{
+			const bool measured = (tick >= settings.m_numWarmupTicks);
+
+			for (int i = 0; i < numApps; ++i)
+			{
+				const int index = (tick + i) % numApps;
+
+				app::ScopedTimer timer;
+				apps[index].m_app->OnTick(settings.m_timeDelta);
+				const double time = timer.GetElaspedTime();
+
+				if (measured)
+					tickTimes[index].push_back(time);
+			}
+
+			for (int i = 0; i < numApps; ++i)
+				positions[i].m_valid = apps[i].m_app->GetBodyPositions(positions[i].m_x, positions[i].m_y);
+
+			if (!positions[0].m_valid)
+				continue;
+
+			for (int i = 0; i < numApps; ++i)
+			{
+				if (!positions[i].m_valid)
+					continue;
+
+				auto& result = outResults[i];
+				result.m_hasDrift = true;
+				helper::ComputeDrift(positions[0], positions[i], result.m_maxDrift, result.m_meanDrift);
+
+				if (result.m_divergedTick < 0 && !(result.m_maxDrift <= settings.m_driftTolerance))
+					result.m_divergedTick = tick;
+			}
+		}
+
+		for (int i = 0; i < numApps; ++i)
+			helper::ComputeTimes(tickTimes[i], outResults[i]);
+
+		for (auto& result : outResults)
+			result.m_speedup = (result.m_mean > 0.0) ? outResults[0].m_mean / result.m_mean : 0.0;
+
+		return true;
+	}
+
+	void PrintComparison(FILE* f, const ComparisonSettings& settings, const std::vector< ComparisonResult >& results)
+	{
+		fprintf(f, "bodies %d, scenario %d, seed %llu, %d ticks (+%d warmup) at dt %.6f, baseline '%s'\n", settings.m_numBodies, settings.m_scenario,
+			(unsigned long long)settings.m_seed, settings.m_numTicks, settings.m_numWarmupTicks, settings.m_timeDelta, results.empty() ? "" : results[0].m_name);
+		fprintf(f, "%-20s %9s %9s %9s %9s %8s %10s %10s %9s\n", "app", "mean ms", "p50 ms", "p99 ms", "max ms", "speedup", "max drift", "mean drift", "diverged");
+
+		for (const auto& result : results)
+		{
+			fprintf(f, "%-20s %9.3f %9.3f %9.3f %9.3f %7.2fx", result.m_name, 1000.0 * result.m_mean, 1000.0 * result.m_p50, 1000.0 * result.m_p99,
+				1000.0 * result.m_max, result.m_speedup);
+
+			if (!result.m_hasDrift)
+				fprintf(f, " %10s %10s %9s\n", "-", "-", "-");
+			else if (result.m_divergedTick < 0)
+				fprintf(f, " %10.4f %10.4f %9s\n", result.m_maxDrift, result.m_meanDrift, "no");
+			else
+				fprintf(f, " %10.4f %10.4f %9d\n", result.m_maxDrift, result.m_meanDrift, result.m_divergedTick);
+		}
+	}
+
+} // test
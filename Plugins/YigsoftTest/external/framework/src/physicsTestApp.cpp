@@ -2,31 +2,70 @@
 
 namespace test
 {
+	namespace helper
+	{
+		const uint64_t DEFAULT_SEED = 1;
+
+		// stream of the scene generation and of the app's own numbers
+		const uint64_t SPAWN_STREAM = 0;
+		const uint64_t APP_STREAM = 1;
 
+		// random values used by every spawned body
+		const uint64_t VALUES_PER_SPAWN = 6;
+
+		// +- keys change the bodies by this fraction of the limit (100 by default)
+		const int BODY_STEP_DIVISOR = 100;
+		const int MIN_BODY_STEP = 100;
+	}
 	
 	int PhysicsTestApp::GetScenario() const
 	{
-		// Assumes 'm_currentScenario' is a private member variable
-		return m_currentScenario;
+		return m_scenario;
 	}
 	
 	void PhysicsTestApp::SetNumBodies(int numBodies)
 	{
-		// Assumes 'm_numBodies' is a private member variable
-		m_numBodies = numBodies;
+		const int delta = numBodies - GetNumBodies();
+		if ( delta > 0 )
+		{
+			AddBodies( delta );
+		}
+		else
+		{
+			RemoveBodies( -delta );
+		}
+	}
+
+	void PhysicsTestApp::SetMaxBodies(int maxBodies)
+	{
+		m_maxBodies = ( maxBodies > 0 ) ? maxBodies : 0;
+
+		if ( GetNumBodies() > m_maxBodies )
+			RemoveBodies( GetNumBodies() - m_maxBodies );
+	}
+
+	int PhysicsTestApp::GetBodyStep() const
+	{
+		const int step = m_maxBodies / helper::BODY_STEP_DIVISOR;
+		return ( step > helper::MIN_BODY_STEP ) ? step : helper::MIN_BODY_STEP;
 	}
 
 	void PhysicsTestApp::SetScenario(int scenario)
 	{
-		// Assumes 'm_currentScenario' is a private member variable
-		m_currentScenario = scenario;
+		if ( scenario >= 0 && scenario < NUM_SCENARIOS )
+			ChangeScenario( scenario );
 	}
 
 
 	PhysicsTestApp::PhysicsTestApp( const char* appName )
 		: m_appName( appName )
 		, m_scenario( 0 )
+		, m_maxBodies( MaxBodies )
+		, m_seed( helper::DEFAULT_SEED )
+		, m_numSpawned( 0 )
+		, m_showCounters( true )
 	{
+		SetSeed( helper::DEFAULT_SEED );
 	}
 
 	bool PhysicsTestApp::OnInit( const app::AppInitContext& initContext )
@@ -37,25 +76,42 @@ namespace test
 
 	void PhysicsTestApp::OnKeyPressed( const int keyCode )
 	{
-		if ( keyCode == VK_OEM_PLUS || keyCode == VK_ADD )
+		if ( keyCode == app::key::OEM_PLUS || keyCode == app::key::ADD )
 		{
-			AddBodies(100);
+			AddBodies( GetBodyStep() );
 		}
-		else if ( keyCode == VK_OEM_MINUS || keyCode == VK_SUBTRACT )
+		else if ( keyCode == app::key::OEM_MINUS || keyCode == app::key::SUBTRACT )
 		{
-			RemoveBodies(100);
+			RemoveBodies( GetBodyStep() );
+		}
+		else if ( keyCode == 'm' || keyCode == 'M' )
+		{
+			SetMaxBodies( ( m_maxBodies > MaxBodies ) ? MaxBodies : LargeScaleMaxBodies );
 		}
 		else if ( keyCode == 's' || keyCode == 'S' )
 		{
 			ChangeScenario( (m_scenario+1) % NUM_SCENARIOS );
 		}
+		else if ( keyCode == 'c' || keyCode == 'C' )
+		{
+			m_showCounters = !m_showCounters;
+		}
 	}
 
 	void PhysicsTestApp::OnRender( app::RenderFrame& frame ) const
 	{
-		frame.AddString( 10, 70, RGB(255,255,200), "App: '%hs'", m_appName );
-		frame.AddString( 10, 90, RGB(255,255,200), "Number of bodies: %d (+- to change)", GetNumBodies() );
-		frame.AddString( 10, 110, RGB(200,255,200), "Scenario:: %d (S to change)", m_scenario );
+		frame.AddString( 10, 70, app::MakeColor(255,255,200), "App: '%hs'", m_appName );
+		frame.AddString( 10, 90, app::MakeColor(255,255,200), "Number of bodies: %d of %d (+- to change, M for large scale)", GetNumBodies(), m_maxBodies );
+		frame.AddString( 10, 110, app::MakeColor(200,255,200), "Scenario:: %d (S to change)", m_scenario );
+
+		if ( m_showCounters )
+		{
+			const SimCounters& counters = m_counters;
+			frame.AddString( 600, 90, app::MakeColor(200,220,255), "Pairs: %lld, overlap tests: %lld (hits: %lld), corrections: %lld (C to hide)",
+				(long long)counters.m_numPairs, (long long)counters.m_numOverlapTests, (long long)counters.m_numOverlaps, (long long)counters.m_numCorrections );
+			frame.AddString( 600, 110, app::MakeColor(200,220,255), "Attractor hits: %lld, neighbours per body: %.1f avg, %d max",
+				(long long)counters.m_numAttractorHits, counters.GetAvgNeighbours(), counters.m_maxNeighbours );
+		}
 	}
 
 	void PhysicsTestApp::OnAppSwitched( app::IApp* prevApp )
@@ -64,55 +120,72 @@ namespace test
 		if ( prevApp && prevApp != this )
 		{
 			PhysicsTestApp* physicsApp = static_cast< PhysicsTestApp* >( prevApp );
-
-			const int delta = physicsApp->GetNumBodies() - GetNumBodies();
-			if ( delta > 0 )
-			{
-				AddBodies( delta );
-			}
-			else
-			{
-				RemoveBodies( -delta );
-			}
+			SetMaxBodies( physicsApp->GetMaxBodies() );
+			SetNumBodies( physicsApp->GetNumBodies() );
 		}
 	}
 
-	namespace helper
+	void PhysicsTestApp::SetSeed( uint64_t seed )
+	{
+		m_seed = seed;
+		m_spawnRandom = app::Random( seed, helper::SPAWN_STREAM );
+		m_random = app::Random( seed, helper::APP_STREAM );
+		m_numSpawned = 0;
+	}
+
+	void PhysicsTestApp::RestoreSceneState( int scenario, uint64_t seed, uint64_t numSpawned, uint64_t randomCounter )
 	{
-		static inline float RandOne()
+		if ( scenario >= 0 && scenario < NUM_SCENARIOS )
+			m_scenario = scenario;
+
+		SetSeed( seed );
+		m_numSpawned = numSpawned;
+		m_random.SetCounter( randomCounter );
+	}
+
+	void PhysicsTestApp::GenerateSpawns( uint64_t firstSpawn, int numSpawns, BodySpawn* outSpawns ) const
+	{
+		const float width = (float)app::Resolution::WIDTH;
+		const float height = (float)app::Resolution::HEIGHT;
+		const float w3 = width / 3.0f;
+
+		// every body reads its own counters, no state carried between iterations
+		for ( int i=0; i<numSpawns; ++i )
 		{
-			return (float)rand() / (float)RAND_MAX;
+			const uint64_t counter = (firstSpawn + i) * helper::VALUES_PER_SPAWN;
+
+			BodySpawn& spawn = outSpawns[i];
+			spawn.m_shapeType = (int)m_spawnRandom.GetInt( counter + 0, MaxShapeTypes );
+
+			const float fx = m_spawnRandom.GetFloat( counter + 1 );
+			spawn.m_x = ( m_scenario == 1 ) ? (spawn.m_shapeType*w3) + w3*fx : width*fx;
+			spawn.m_y = height * m_spawnRandom.GetFloat( counter + 2 );
+			spawn.m_size = MinSize + (MaxSize - MinSize) * m_spawnRandom.GetFloat( counter + 3 );
+
+			spawn.m_velX = (float)( (int)m_spawnRandom.GetInt( counter + 4, 200 ) - 100 );
+			spawn.m_velY = (float)( (int)m_spawnRandom.GetInt( counter + 5, 200 ) - 100 );
 		}
 	}
 
+	void PhysicsTestApp::SpawnBodies( const BodySpawn* spawns, int numSpawns )
+	{
+		for ( int i=0; i<numSpawns; ++i )
+			AddBody( spawns[i].m_shapeType, spawns[i].m_x, spawns[i].m_y, spawns[i].m_size );
+	}
+
 	void PhysicsTestApp::AddBodies( int numObjects )
 	{
-		if ( GetNumBodies() + numObjects >= MaxBodies )
-			numObjects = (MaxBodies - GetNumBodies());
-		
-		for ( int i=0; i<numObjects; ++i )
-		{
-			if ( m_scenario == 0 )
-			{
-				const int type = rand() % MaxShapeTypes;
-				const float x = (float)app::Resolution::WIDTH * helper::RandOne();
-				const float y = (float)app::Resolution::HEIGHT * helper::RandOne();
-				const float r = MinSize + (MaxSize - MinSize) * helper::RandOne();
-
-				AddBody( type, x, y, r );
-			}
-			else if ( m_scenario == 1 )
-			{
-				const int type = rand() % MaxShapeTypes;
-
-				const float w3 = (float)app::Resolution::WIDTH / 3.0f;
-				const float x = (type*w3) + w3* helper::RandOne();
-				const float y = (float)app::Resolution::HEIGHT * helper::RandOne();
-				const float r = MinSize + (MaxSize - MinSize) * helper::RandOne();
-
-				AddBody( type, x, y, r );
-			}
-		}
+		if ( GetNumBodies() + numObjects >= m_maxBodies )
+			numObjects = (m_maxBodies - GetNumBodies());
+
+		if ( numObjects <= 0 )
+			return;
+
+		m_spawnScratch.resize( numObjects );
+		GenerateSpawns( m_numSpawned, numObjects, m_spawnScratch.data() );
+		m_numSpawned += numObjects;
+
+		SpawnBodies( m_spawnScratch.data(), numObjects );
 	}
 
 	void PhysicsTestApp::ChangeScenario( int newScenario )
@@ -0,0 +1,224 @@
+/// (C) Yigsoft 2023
+
+#include "profiler.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+namespace app
+{
+
+	//-----
+
+	namespace helper
+	{
+		/// ring buffer of one thread, written only by that thread
+		struct ProfileThreadBuffer
+		{
+			ProfileThreadBuffer(const int id)
+				: m_id(id)
+				, m_count(0)
+				, m_clearedCount(0)
+				, m_events(new ProfileEvent[Profiler::BUFFER_EVENTS])
+			{
+			}
+
+			int								m_id;
+			std::string						m_name; // guarded by the registry lock
+			std::atomic< uint64_t >			m_count; // events ever written, published after the event
+			uint64_t						m_clearedCount; // events before this one were cleared, guarded by the registry lock
+			std::unique_ptr< ProfileEvent[] >	m_events;
+		};
+
+		/// all thread buffers, kept until exit so zones of finished threads can still be exported
+		struct ProfileRegistry
+		{
+			std::mutex												m_lock;
+			std::vector< std::unique_ptr< ProfileThreadBuffer > >	m_buffers;
+		};
+
+		static ProfileRegistry& GetProfileRegistry()
+		{
+			static ProfileRegistry registry;
+			return registry;
+		}
+
+		static thread_local ProfileThreadBuffer* st_threadBuffer = nullptr;
+		static thread_local std::string st_threadName;
+		static thread_local int st_threadDepth = 0;
+
+		static ProfileThreadBuffer* GetThreadBuffer()
+		{
+			if (st_threadBuffer)
+				return st_threadBuffer;
+
+			auto& registry = GetProfileRegistry();
+			std::lock_guard< std::mutex > lock(registry.m_lock);
+
+			const int id = (int)registry.m_buffers.size();
+			registry.m_buffers.emplace_back(new ProfileThreadBuffer(id));
+
+			st_threadBuffer = registry.m_buffers.back().get();
+			st_threadBuffer->m_name = st_threadName;
+			return st_threadBuffer;
+		}
+
+		static inline void WriteEvent(ProfileThreadBuffer* buffer, const ProfileEvent& evt)
+		{
+			const uint64_t count = buffer->m_count.load(std::memory_order_relaxed);
+			buffer->m_events[count % Profiler::BUFFER_EVENTS] = evt;
+			buffer->m_count.store(count + 1, std::memory_order_release);
+		}
+
+		static void WriteJsonString(FILE* f, const char* str)
+		{
+			fputc('"', f);
+			for (const char* ptr = str; *ptr; ++ptr)
+			{
+				const unsigned char ch = (unsigned char)*ptr;
+				if (ch == '"' || ch == '\\')
+					fprintf(f, "\\%c", ch);
+				else if (ch < 0x20)
+					fprintf(f, "\\u%04x", ch);
+				else
+					fputc(ch, f);
+			}
+			fputc('"', f);
+		}
+
+		static inline double ToMicroseconds(const Timer::TTicks time)
+		{
+			return Timer::GetInstance().ToSeconds(time) * 1000000.0;
+		}
+	}
+
+	//-----
+
+	std::atomic< bool > Profiler::st_enabled(false);
+
+	void Profiler::SetEnabled(const bool enabled)
+	{
+		st_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	void Profiler::SetThreadName(const char* name)
+	{
+		helper::st_threadName = name ? name : "";
+
+		if (helper::st_threadBuffer)
+		{
+			auto& registry = helper::GetProfileRegistry();
+			std::lock_guard< std::mutex > lock(registry.m_lock);
+			helper::st_threadBuffer->m_name = helper::st_threadName;
+		}
+	}
+
+	void Profiler::MarkFrame()
+	{
+		if (!IsEnabled())
+			return;
+
+		ProfileEvent evt;
+		evt.m_name = "Frame";
+		evt.m_start = Timer::GetInstance().GetNow();
+		evt.m_end = evt.m_start;
+		evt.m_depth = -1;
+		helper::WriteEvent(helper::GetThreadBuffer(), evt);
+	}
+
+	void Profiler::Clear()
+	{
+		auto& registry = helper::GetProfileRegistry();
+		std::lock_guard< std::mutex > lock(registry.m_lock);
+
+		// writers are never stopped, only remember where the valid events start
+		for (auto& buffer : registry.m_buffers)
+			buffer->m_clearedCount = buffer->m_count.load(std::memory_order_acquire);
+	}
+
+	int Profiler::BeginZone()
+	{
+		return helper::st_threadDepth++;
+	}
+
+	void Profiler::EndZone(const char* name, const Timer::TTicks start, const int depth)
+	{
+		helper::st_threadDepth = depth;
+
+		ProfileEvent evt;
+		evt.m_name = name;
+		evt.m_start = start;
+		evt.m_end = Timer::GetInstance().GetNow();
+		evt.m_depth = depth;
+		helper::WriteEvent(helper::GetThreadBuffer(), evt);
+	}
+
+	bool Profiler::ExportChromeTrace(const char* path)
+	{
+		FILE* f = fopen(path, "w");
+		if (!f)
+		{
+			fprintf(stderr, "Unable to write trace '%s'\n", path);
+			return false;
+		}
+
+		fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"YigsoftTest\"}}");
+
+		auto& registry = helper::GetProfileRegistry();
+		std::lock_guard< std::mutex > lock(registry.m_lock);
+
+		std::vector< ProfileEvent > events;
+		for (const auto& buffer : registry.m_buffers)
+		{
+			const uint64_t count = buffer->m_count.load(std::memory_order_acquire);
+			const uint64_t wrapped = (count > (uint64_t)BUFFER_EVENTS) ? (count - BUFFER_EVENTS) : 0;
+			const uint64_t first = std::max(wrapped, buffer->m_clearedCount);
+
+			events.clear();
+			for (uint64_t i = first; i < count; ++i)
+				events.push_back(buffer->m_events[i % BUFFER_EVENTS]);
+
+			// the owning thread may have overwritten the oldest copied entries in the meantime
+			const uint64_t newCount = buffer->m_count.load(std::memory_order_acquire);
+			const uint64_t newWrapped = (newCount > (uint64_t)BUFFER_EVENTS) ? (newCount - BUFFER_EVENTS) : 0;
+			const size_t numOverwritten = (newWrapped > first) ? (size_t)std::min< uint64_t >(newWrapped - first, events.size()) : 0;
+
+			const int tid = buffer->m_id + 1;
+			const std::string name = buffer->m_name.empty() ? ("Thread " + std::to_string(tid)) : buffer->m_name;
+
+			fprintf(f, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", tid);
+			helper::WriteJsonString(f, name.c_str());
+			fprintf(f, "}}");
+
+			for (size_t i = numOverwritten; i < events.size(); ++i)
+			{
+				const auto& evt = events[i];
+
+				fprintf(f, ",\n{\"name\":");
+				helper::WriteJsonString(f, evt.m_name);
+
+				if (evt.m_depth < 0)
+				{
+					fprintf(f, ",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+						tid, helper::ToMicroseconds(evt.m_start));
+				}
+				else
+				{
+					fprintf(f, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%d}}",
+						tid, helper::ToMicroseconds(evt.m_start), Timer::GetInstance().ToSecondsIntv(evt.m_end - evt.m_start) * 1000000.0, evt.m_depth);
+				}
+			}
+		}
+
+		fprintf(f, "\n]}\n");
+
+		const bool ok = (0 == ferror(f));
+		fclose(f);
+		return ok;
+	}
+
+	//-----
+
+}
@@ -2,10 +2,9 @@
 
 #include "framework.h"
 #include "renderFont.h"
+#include "textLayout.h"
 #include "utils.h"
 
-#include "fontData.inl"
-
 namespace app
 {
 
@@ -41,7 +40,6 @@ namespace app
 		, m_blendState( nullptr )
 
 	{
-		memset( m_chars, 0, sizeof(m_chars) );
 	}
 
 	RenderFont::~RenderFont()
@@ -54,8 +52,8 @@ namespace app
 		SAFE_RELEASE( m_rasterState );
 		SAFE_RELEASE( m_depthState );
 		SAFE_RELEASE( m_blendState );
+		SAFE_RELEASE( m_indexBuffer );
 
-		delete m_indexBuffer;
 		delete m_vertexBuffer;
 	}
 
@@ -77,27 +75,30 @@ namespace app
 			return false;
 		}
 
+		// glyphs and the converted font image are shared with the headless code
+		const Font& font = Font::GetInstance();
+		if ( !font.IsValid() )
+		{
+			fprintf( stderr, "Font internal data error\n" );
+			return false;
+		}
+
 		// setup texture
 		{
-			// convert font image (hacky)
-			unsigned char fontDataTemp[ sizeof(app::font::TextureData) / 3 ];
-			for (int i=0; i<sizeof(fontDataTemp); ++i )
-				fontDataTemp[i] = app::font::TextureData[i*3] << 2;
-		
 			D3D11_TEXTURE2D_DESC texDesc;
 			memset( &texDesc, 0, sizeof(texDesc) );
 			texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 			texDesc.Format = DXGI_FORMAT_A8_UNORM;	
-			texDesc.Width = 256;
-			texDesc.Height = 128;
+			texDesc.Width = Font::TEXTURE_WIDTH;
+			texDesc.Height = Font::TEXTURE_HEIGHT;
 			texDesc.MipLevels = 1;
 			texDesc.ArraySize = 1;
 			texDesc.SampleDesc.Count = 1;
 			texDesc.Usage = D3D11_USAGE_IMMUTABLE;
 
 			D3D11_SUBRESOURCE_DATA texData;
-			texData.pSysMem = &fontDataTemp;
-			texData.SysMemPitch = 256;
+			texData.pSysMem = font.GetAlpha();
+			texData.SysMemPitch = Font::TEXTURE_WIDTH;
 
 			HRESULT hRet = device->CreateTexture2D( &texDesc, &texData, &m_texture );
 			if ( FAILED(hRet) )
@@ -121,8 +122,36 @@ namespace app
 			}
 		}
 
-		// setup index buffer
-		m_indexBuffer = utils::CreateDynamicIndexBuffer( device, MAX_RENDER_INDICES );
+		// setup index buffer, the same for every batch: quad i uses vertices 4i to 4i+3
+		{
+			std::vector< unsigned int > indices( MAX_RENDER_INDICES );
+			for ( int i = 0; i < MAX_RENDER_CHARS; ++i )
+			{
+				indices[ i*6 + 0 ] = i*4 + 0;
+				indices[ i*6 + 1 ] = i*4 + 1;
+				indices[ i*6 + 2 ] = i*4 + 2;
+				indices[ i*6 + 3 ] = i*4 + 0;
+				indices[ i*6 + 4 ] = i*4 + 2;
+				indices[ i*6 + 5 ] = i*4 + 3;
+			}
+
+			D3D11_BUFFER_DESC desc;
+			memset( &desc, 0, sizeof(desc) );
+			desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+			desc.ByteWidth = MAX_RENDER_INDICES * sizeof(unsigned int);
+			desc.Usage = D3D11_USAGE_IMMUTABLE;
+
+			D3D11_SUBRESOURCE_DATA data;
+			memset( &data, 0, sizeof(data) );
+			data.pSysMem = indices.data();
+
+			HRESULT hRet = device->CreateBuffer( &desc, &data, &m_indexBuffer );
+			if ( FAILED(hRet) )
+			{
+				fprintf( stderr, "Failed to create font index buffer: 0x%08X\n", hRet );
+				return false;
+			}
+		}
 
 		// setup vertex buffer
 		m_vertexBuffer = utils::CreateDynamicVertexBuffer( device, MAX_RENDER_VERTICES * sizeof(FontVertex) );
@@ -180,184 +209,22 @@ namespace app
 			}
 		}
 
-		// parse the binary font data
-		if ( !ParseFontData() )
-		{
-			fprintf( stderr, "Font internal data error\n" );
-			return false;
-		}
-
 		// font is ready for drawing
 		return true;
 	}
 
-	namespace helper
-	{
-#pragma pack(push, 1)
-		struct FontChunkInfo
-		{
-			unsigned char id;
-			int size;
-		};
-
-		struct FontCharInfo
-		{
-			unsigned int id;
-			unsigned short x;
-			unsigned short y;
-			unsigned short width;
-			unsigned short height;
-			short xOffset;
-			short yOffset;
-			short xAdvance;
-			char page;
-			char chnl;
-		};
-#pragma pack(pop)
-
-	} // helper
-
-	// http://www.angelcode.com/products/bmfont/doc/file_format.html#bin
-	bool RenderFont::ParseFontData()
+	void RenderFont::Draw( ID3D11DeviceContext* deviceContext, const GlyphQuad* quads, const int numQuads ) const
 	{
-		const unsigned char* data = &app::font::FontData[0];
-		const int size = sizeof(app::font::FontData);
-
-		if ( data[0] != 'B' || data[1] != 'M' || data[2] != 'F' || data[3] != 3 ) 
-		{
-			fprintf( stderr, "Font data invalid!\n" );
-			return false;
-		}
+		if ( numQuads <= 0 )
+			return;
 
-		const float texInvWidth = 1.0f / 256.0f;
-		const float texInvHeight = 1.0f / 128.0f;
-
-		int pos = 4; // past header
-		while ( pos < size )
-		{
-			const auto* chunk = (const helper::FontChunkInfo*)( data + pos );
+		const float texInvWidth = 1.0f / (float) Font::TEXTURE_WIDTH;
+		const float texInvHeight = 1.0f / (float) Font::TEXTURE_HEIGHT;
 
-			if ( chunk->id == 4 /* chars*/ )
-			{
-				assert( (chunk->size % sizeof(helper::FontCharInfo)) == 0 );
-				const int numChars = chunk->size / sizeof(helper::FontCharInfo);
-
-				// process the char data
-				const auto* charData = (const helper::FontCharInfo*)( data + pos + sizeof(helper::FontChunkInfo));
-				for ( int i=0; i<numChars; ++i, ++charData )
-				{
-					assert( charData->id < 256 );
-					auto& charInfo = m_chars[ charData->id ];
-
-					charInfo.x0 = (float) charData->x * texInvWidth;
-					charInfo.y0 = (float) charData->y * texInvHeight;
-					charInfo.x1 = (float)( charData->x + charData->width ) * texInvWidth;
-					charInfo.y1 = (float)( charData->y + charData->height ) * texInvHeight;
-					charInfo.width = (float) charData->width;
-					charInfo.height = (float) charData->height;
-					charInfo.xAdvance = (float) charData->xAdvance;
-					charInfo.xOffset  = (float) charData->xOffset;
-					charInfo.yOffset = (float) charData->yOffset;
-				}
-			}
-
-			pos += sizeof(helper::FontChunkInfo) + chunk->size;
-		}
-
-		// done
-		return true;
-	}
-
-	void RenderFont::Draw( ID3D11DeviceContext* deviceContext, const int x, const int y, const unsigned int color, const char* txt ) const
-	{
-		int numChars = (int)strlen(txt);
-		if ( numChars > MAX_RENDER_CHARS )
-			numChars = MAX_RENDER_CHARS;
-
-		int indexAllocOffset = 0;
-		int vertexAllocOffset = 0;
-
-		int numVertices = 0;
-		int numIndices = 0;
-
-		{
-			utils::BufferWriter indexWriter( deviceContext, m_indexBuffer, 6*sizeof(int)*numChars, indexAllocOffset );
-			utils::BufferWriter vertexWriter( deviceContext, m_vertexBuffer, 4*sizeof(FontVertex)*numChars, vertexAllocOffset );
-
-			float curX = (float)x;
-			float curY = (float)y;
-
-			for ( int i = 0; i<numChars; ++i )
-			{
-				const auto& charData = m_chars[ (unsigned char)txt[i] ];
-				if ( charData.xAdvance )
-				{
-					if ( txt[i] > 32 )
-					{
-						{
-							FontVertex v;
-							v.color = color;
-							v.x = curX + charData.xOffset;
-							v.y = curY + charData.yOffset;
-							v.u = charData.x0;
-							v.v = charData.y0;
-							vertexWriter.Write(v);
-						}
-
-						{
-							FontVertex v;
-							v.color = color;
-							v.x = curX + charData.xOffset + charData.width;
-							v.y = curY + charData.yOffset;
-							v.u = charData.x1;
-							v.v = charData.y0;
-							vertexWriter.Write(v);
-						}
-
-						{
-							FontVertex v;
-							v.color = color;
-							v.x = curX + charData.xOffset + charData.width;
-							v.y = curY + charData.yOffset + charData.height;
-							v.u = charData.x1;
-							v.v = charData.y1;
-							vertexWriter.Write(v);
-						}
-
-
-						{
-							FontVertex v;
-							v.color = color;
-							v.x = curX + charData.xOffset;
-							v.y = curY + charData.yOffset + charData.height;
-							v.u = charData.x0;
-							v.v = charData.y1;
-							vertexWriter.Write(v);
-						}
-
-						indexWriter.Write<int>( numVertices + 0 );
-						indexWriter.Write<int>( numVertices + 1 );
-						indexWriter.Write<int>( numVertices + 2 );
-
-						indexWriter.Write<int>( numVertices + 0 );
-						indexWriter.Write<int>( numVertices + 2 );
-						indexWriter.Write<int>( numVertices + 3 );
-
-						numVertices += 4;
-						numIndices += 6;
-					}
-
-					curX += charData.xAdvance;
-				}
-			}
-		}
-
-		UINT stride = sizeof(FontVertex);
-		UINT offsets = vertexAllocOffset;
+		// state is the same for all batches
 		deviceContext->IASetInputLayout( m_vertexLayout );
 		deviceContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-		deviceContext->IASetVertexBuffers( 0, 1, m_vertexBuffer->GetBufferPtr(), &stride, &offsets );
-		deviceContext->IASetIndexBuffer( m_indexBuffer->GetBuffer(), DXGI_FORMAT_R32_UINT, indexAllocOffset );
+		deviceContext->IASetIndexBuffer( m_indexBuffer, DXGI_FORMAT_R32_UINT, 0 );
 
 		deviceContext->PSSetShaderResources( 0, 1, &m_textureView );
 		deviceContext->PSSetShader( m_pixelShader, NULL, 0 );
@@ -368,7 +235,42 @@ namespace app
 		deviceContext->OMSetBlendState( m_blendState, blendFactor, 0xFFFFFFFF );
 		deviceContext->OMSetDepthStencilState( m_depthState, 0 );
 
-		deviceContext->DrawIndexed( numIndices, 0, 0 );
+		ForEachStreamBatch( numQuads, MAX_RENDER_CHARS, 1, [&]( const int first, const int count )
+		{
+			int vertexAllocOffset = 0;
+
+			{
+				utils::BufferWriter vertexWriter( deviceContext, m_vertexBuffer, 4*sizeof(FontVertex)*count, vertexAllocOffset );
+				if ( !vertexWriter.IsLocked() )
+					return;
+
+				FontVertex* v = (FontVertex*) vertexWriter.GetData();
+				for ( int i = 0; i < count; ++i, v += 4 )
+				{
+					const GlyphQuad& quad = quads[ first + i ];
+
+					const float x0 = (float) quad.x;
+					const float y0 = (float) quad.y;
+					const float x1 = (float)( quad.x + quad.width );
+					const float y1 = (float)( quad.y + quad.height );
+
+					const float u0 = (float) quad.srcX * texInvWidth;
+					const float v0 = (float) quad.srcY * texInvHeight;
+					const float u1 = (float)( quad.srcX + quad.width ) * texInvWidth;
+					const float v1 = (float)( quad.srcY + quad.height ) * texInvHeight;
+
+					v[0] = { x0, y0, u0, v0, quad.color };
+					v[1] = { x1, y0, u1, v0, quad.color };
+					v[2] = { x1, y1, u1, v1, quad.color };
+					v[3] = { x0, y1, u0, v1, quad.color };
+				}
+			}
+
+			UINT stride = sizeof(FontVertex);
+			UINT offsets = vertexAllocOffset;
+			deviceContext->IASetVertexBuffers( 0, 1, m_vertexBuffer->GetBufferPtr(), &stride, &offsets );
+			deviceContext->DrawIndexed( 6*count, 0, 0 );
+		} );
 	}
 
 } // app
\ No newline at end of file
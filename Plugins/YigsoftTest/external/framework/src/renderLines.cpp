@@ -23,11 +23,47 @@ namespace app
 		{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
 
+	// every instance draws MAX_POINTS lines, the ones past the outline's point count are moved outside of the viewport
+	const char* instanceVS = ""
+		"#define MAX_OUTLINES 32\n"
+		"#define MAX_POINTS 8\n"
+		"cbuffer Outlines : register(b0) { float4 outlinePoints[MAX_OUTLINES*MAX_POINTS]; float4 outlineInfo[MAX_OUTLINES]; };\n"
+		"struct VS_INPUT { float2 pos : POSITION; float size : SIZE; uint outline : OUTLINE; float4 color : COLOR0; uint vid : SV_VertexID; };\n"
+		"struct VS_OUTPUT { float4 pos : SV_Position; float4 color : COLOR0; };\n"
+		"void vs_main( VS_INPUT d, out VS_OUTPUT o )\n"
+		"{ float4 info = outlineInfo[d.outline]; uint num = max((uint)info.x, 1u); uint edge = d.vid >> 1;\n"
+		"  uint index = (edge + (d.vid & 1)) % num;\n"
+		"  float2 p = d.pos + (d.size * info.y) * outlinePoints[d.outline * MAX_POINTS + index].xy;\n"
+		"  o.pos = (edge < (uint)info.x) ? float4((p / float2(800.0f,-450.0f)) + float2(-1.0f,1.0f),0.5f,1) : float4(-2.0f,-2.0f,0.5f,1);\n"
+		"  o.color = d.color; }\n";
+
+	D3D11_INPUT_ELEMENT_DESC instanceDecl[] = 
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32_FLOAT,   0, 0,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "SIZE",     0, DXGI_FORMAT_R32_FLOAT,      0, 8,  D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "OUTLINE",  0, DXGI_FORMAT_R32_UINT,       0, 12, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "COLOR",    0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	/// layout of the outline constant buffer, must match instanceVS
+	struct OutlineConstants
+	{
+		float points[RenderOutlineTable::MAX_OUTLINES * RenderOutline::MAX_POINTS][4];
+		float info[RenderOutlineTable::MAX_OUTLINES][4]; // x - number of points, y - size scale
+	};
+
+	static_assert( sizeof(RenderInstance) == 20, "Instance layout does not match instanceDecl" );
+
 	RenderLines::RenderLines()
 		: m_pixelShader( nullptr )
 		, m_vertexShader( nullptr )
 		, m_vertexLayout( nullptr )
 		, m_vertexBuffer( nullptr )
+		, m_instanceShader( nullptr )
+		, m_instanceLayout( nullptr )
+		, m_instanceBuffer( nullptr )
+		, m_outlineConstants( nullptr )
+		, m_numUploadedOutlines( 0 )
 		, m_rasterState( nullptr )
 		, m_depthState( nullptr )
 		, m_blendState( nullptr )
@@ -43,7 +79,11 @@ namespace app
 		SAFE_RELEASE( m_rasterState );
 		SAFE_RELEASE( m_depthState );
 		SAFE_RELEASE( m_blendState );
+		SAFE_RELEASE( m_instanceShader );
+		SAFE_RELEASE( m_instanceLayout );
+		SAFE_RELEASE( m_outlineConstants );
 		delete m_vertexBuffer;
+		delete m_instanceBuffer;
 	}
 
 	bool RenderLines::Init( ID3D11Device* device )
@@ -115,34 +155,206 @@ namespace app
 			}
 		}
 
+		// optional, instances are expanded on the CPU without it
+		if ( !InitInstancing( device ) )
+		{
+			fprintf( stderr, "Instanced lines not available, expanding instances on the CPU\n" );
+
+			SAFE_RELEASE( m_instanceShader );
+			SAFE_RELEASE( m_instanceLayout );
+			SAFE_RELEASE( m_outlineConstants );
+		}
+
 		// font is ready for drawing
 		return true;
 	}
 
-	void RenderLines::Draw( ID3D11DeviceContext* deviceContext, const RenderVertex* vertices, const int numVertices ) 
+	bool RenderLines::InitInstancing( ID3D11Device* device )
 	{
-		int vertexAllocOffset = 0;
+		ID3DBlob* vertexDataBlob = nullptr;
+		m_instanceShader = app::utils::CompileVertexShader( device, instanceVS, /*out*/ vertexDataBlob );
+		if ( !m_instanceShader )
+			return false;
+
+		HRESULT hRet = device->CreateInputLayout( instanceDecl, ARRAYSIZE(instanceDecl), vertexDataBlob->GetBufferPointer(), vertexDataBlob->GetBufferSize(), &m_instanceLayout );
+		SAFE_RELEASE( vertexDataBlob );
+
+		if ( FAILED(hRet) )
+			return false;
 
 		{
-			utils::BufferWriter vertexWriter( deviceContext, m_vertexBuffer, sizeof(RenderVertex)*numVertices, vertexAllocOffset );
-			memcpy( vertexWriter.GetData(), vertices, sizeof(RenderVertex)*numVertices );
+			D3D11_BUFFER_DESC desc;
+
+			memset( &desc, 0, sizeof(desc) );
+			desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+			desc.ByteWidth = sizeof(OutlineConstants);
+			desc.Usage = D3D11_USAGE_DEFAULT;
+
+			hRet = device->CreateBuffer( &desc, NULL, &m_outlineConstants );
+			if ( FAILED(hRet) )
+				return false;
 		}
 
-		UINT stride = sizeof(RenderVertex);
-		UINT offsets = vertexAllocOffset;
-		deviceContext->IASetInputLayout( m_vertexLayout );
+		m_instanceBuffer = utils::CreateDynamicVertexBuffer( device, MAX_RENDER_INSTANCES * sizeof(RenderInstance) );
+		return m_instanceBuffer != nullptr;
+	}
+
+	void RenderLines::SetupState( ID3D11DeviceContext* deviceContext )
+	{
 		deviceContext->IASetPrimitiveTopology( D3D11_PRIMITIVE_TOPOLOGY_LINELIST );
-		deviceContext->IASetVertexBuffers( 0, 1, m_vertexBuffer->GetBufferPtr(), &stride, &offsets );
 
 		deviceContext->PSSetShader( m_pixelShader, NULL, 0 );
-		deviceContext->VSSetShader( m_vertexShader, NULL, 0 );
 		deviceContext->RSSetState( m_rasterState );
 
 		FLOAT blendFactor[] = {0,0,0,0};
 		deviceContext->OMSetBlendState( m_blendState, blendFactor, 0xFFFFFFFF );
 		deviceContext->OMSetDepthStencilState( m_depthState, 0 );
+	}
+
+	void RenderLines::Draw( ID3D11DeviceContext* deviceContext, const RenderVertex* vertices, const int numVertices ) 
+	{
+		deviceContext->IASetInputLayout( m_vertexLayout );
+		deviceContext->VSSetShader( m_vertexShader, NULL, 0 );
+
+		SetupState( deviceContext );
+
+		// one draw per batch that fits the ring, lines are never split
+		ForEachStreamBatch( numVertices, MAX_RENDER_VERTICES, 2, [&]( const int first, const int count )
+		{
+			int vertexAllocOffset = 0;
+
+			{
+				utils::BufferWriter vertexWriter( deviceContext, m_vertexBuffer, sizeof(RenderVertex)*count, vertexAllocOffset );
+				if ( !vertexWriter.IsLocked() )
+					return;
+
+				memcpy( vertexWriter.GetData(), vertices + first, sizeof(RenderVertex)*count );
+			}
+
+			UINT stride = sizeof(RenderVertex);
+			UINT offsets = vertexAllocOffset;
+			deviceContext->IASetVertexBuffers( 0, 1, m_vertexBuffer->GetBufferPtr(), &stride, &offsets );
+
+			deviceContext->Draw( count, 0 );
+		} );
+	}
+
+	void RenderLines::DrawInstances( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances )
+	{
+		if ( numInstances <= 0 )
+			return;
+
+		if ( m_instanceShader )
+			DrawInstanced( deviceContext, instances, numInstances );
+		else
+			DrawExpanded( deviceContext, instances, numInstances );
+	}
+
+	void RenderLines::DrawExpanded( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances )
+	{
+		const auto& outlines = RenderOutlineTable::GetInstance();
+
+		int first = 0;
+		while ( first < numInstances )
+		{
+			// batch of instances that fits the expansion limit
+			int last = first;
+			int numVertices = 0;
+			while ( last < numInstances )
+			{
+				const int instanceVertices = 2 * outlines.GetNumPoints( instances[last].outline );
+				if ( numVertices + instanceVertices > EXPAND_BATCH_VERTICES )
+					break;
+
+				numVertices += instanceVertices;
+				++last;
+			}
+
+			// expand directly into the upload memory
+			if ( numVertices > 0 )
+			{
+				int vertexAllocOffset = 0;
+				bool uploaded = false;
+
+				{
+					utils::BufferWriter vertexWriter( deviceContext, m_vertexBuffer, sizeof(RenderVertex)*numVertices, vertexAllocOffset );
+					uploaded = vertexWriter.IsLocked();
+					if ( uploaded )
+						ExpandRenderInstances( instances + first, last - first, (RenderVertex*) vertexWriter.GetData() );
+				}
+
+				// the batch could not be uploaded, skip its draw
+				if ( !uploaded )
+				{
+					first = last;
+					continue;
+				}
+
+				UINT stride = sizeof(RenderVertex);
+				UINT offsets = vertexAllocOffset;
+				deviceContext->IASetInputLayout( m_vertexLayout );
+				deviceContext->IASetVertexBuffers( 0, 1, m_vertexBuffer->GetBufferPtr(), &stride, &offsets );
+				deviceContext->VSSetShader( m_vertexShader, NULL, 0 );
+
+				SetupState( deviceContext );
+
+				deviceContext->Draw( numVertices, 0 );
+			}
+
+			first = last;
+		}
+	}
+
+	void RenderLines::DrawInstanced( ID3D11DeviceContext* deviceContext, const RenderInstance* instances, const int numInstances )
+	{
+		// outlines are only ever added, upload again when the table grew
+		const auto& outlines = RenderOutlineTable::GetInstance();
+		const int numOutlines = outlines.GetNumOutlines();
+		if ( numOutlines != m_numUploadedOutlines )
+		{
+			OutlineConstants data;
+			memset( &data, 0, sizeof(data) );
+
+			for ( int i = 0; i < numOutlines; ++i )
+			{
+				const auto& outline = outlines.GetOutline( i );
+				for ( int j = 0; j < outline.m_numPoints; ++j )
+				{
+					data.points[i * RenderOutline::MAX_POINTS + j][0] = outline.m_x[j];
+					data.points[i * RenderOutline::MAX_POINTS + j][1] = outline.m_y[j];
+				}
+
+				data.info[i][0] = (float) outline.m_numPoints;
+				data.info[i][1] = outline.m_sizeScale;
+			}
+
+			deviceContext->UpdateSubresource( m_outlineConstants, 0, NULL, &data, 0, 0 );
+			m_numUploadedOutlines = numOutlines;
+		}
+
+		ForEachStreamBatch( numInstances, MAX_RENDER_INSTANCES, 1, [&]( const int first, const int count )
+		{
+			int instanceAllocOffset = 0;
+
+			{
+				utils::BufferWriter instanceWriter( deviceContext, m_instanceBuffer, sizeof(RenderInstance)*count, instanceAllocOffset );
+				if ( !instanceWriter.IsLocked() )
+					return;
+
+				memcpy( instanceWriter.GetData(), instances + first, sizeof(RenderInstance)*count );
+			}
+
+			UINT stride = sizeof(RenderInstance);
+			UINT offsets = instanceAllocOffset;
+			deviceContext->IASetInputLayout( m_instanceLayout );
+			deviceContext->IASetVertexBuffers( 0, 1, m_instanceBuffer->GetBufferPtr(), &stride, &offsets );
+			deviceContext->VSSetShader( m_instanceShader, NULL, 0 );
+			deviceContext->VSSetConstantBuffers( 0, 1, &m_outlineConstants );
+
+			SetupState( deviceContext );
 
-		deviceContext->Draw( numVertices, 0 );
+			deviceContext->DrawInstanced( 2 * RenderOutline::MAX_POINTS, count, 0, 0 );
+		} );
 	}
 
 } // app
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "renderer.h"
 #include "renderFont.h"
 #include "renderLines.h"
+#include "textLayout.h"
+#include "profiler.h"
 #include "utils.h"
 
 #pragma comment (lib, "dxguid.lib")
@@ -25,6 +27,7 @@ namespace app
 		, m_depthStencilView( nullptr )
 		, m_fontRenderer( nullptr )
 		, m_linesRenderer( nullptr )
+		, m_textBatcher( new TextBatcher() )
 	{
 	}
 
@@ -32,6 +35,7 @@ namespace app
 	{
 		delete m_fontRenderer;
 		delete m_linesRenderer;
+		delete m_textBatcher;
 		SAFE_RELEASE( m_backBufferView );
 		SAFE_RELEASE( m_deviceContext );
 		SAFE_RELEASE( m_depthStencil );
@@ -152,6 +156,8 @@ namespace app
 
 	void Renderer::Render( const RenderFrame& frame )
 	{
+		PROFILE_ZONE( "Renderer::Render" );
+
 		const FLOAT clearColor[4] = { 0.2f, 0.2f, 0.2f, 1.0f };
 		m_deviceContext->ClearRenderTargetView( m_backBufferView, clearColor );
 
@@ -170,12 +176,22 @@ namespace app
 				m_deviceContext->RSSetViewports( 1, &viewport );
 			}
 
-			// render lines
-			m_linesRenderer->Draw( m_deviceContext, frame.m_vertices, frame.GetNumVertices() );
+			// render outline instances
+			m_linesRenderer->DrawInstances( m_deviceContext, frame.GetInstances().data(), (int) frame.GetInstances().size() );
+
+			// render lines, one draw per vertex chunk
+			for ( int i = 0; i < frame.GetNumUsedChunks(); ++i )
+			{
+				int numVertices = 0;
+				const RenderVertex* vertices = frame.GetChunk( i, numVertices );
+				if ( numVertices > 0 )
+					m_linesRenderer->Draw( m_deviceContext, vertices, numVertices );
+			}
 
-			// render strings (on top)
-			for ( const auto& str : frame.m_strings )
-				m_fontRenderer->Draw( m_deviceContext, str.x, str.y, str.color, str.text.c_str() );
+			// render strings (on top), all of them in one batch
+			m_textBatcher->Build( frame );
+			const auto& quads = m_textBatcher->GetQuads();
+			m_fontRenderer->Draw( m_deviceContext, quads.data(), (int) quads.size() );
 		}
 
 		m_swapchain->Present( 0, 0 );
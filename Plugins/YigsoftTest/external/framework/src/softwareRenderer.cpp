@@ -0,0 +1,424 @@
+/// (C) Yigsoft 2023
+
+#include "softwareRenderer.h"
+#include "jobSystem.h"
+#include "profiler.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+	#include <emmintrin.h>
+	#define APP_SOFTWARE_RENDERER_SSE
+#endif
+
+namespace app
+{
+	namespace helper
+	{
+		/// lines per binning batch, batches are counted and filled in parallel
+		const int BIN_BATCH_LINES = 16 * 1024;
+
+		/// instances per expansion batch
+		const int INSTANCE_BATCH = 4 * 1024;
+
+		/// minor coordinates are clamped to this before the conversion to int, far outside of any tile
+		const float MINOR_LIMIT = (float)(1 << 20);
+
+		/// R8G8B8A8 back buffer clear color of the D3D11 renderer (0.2, 0.2, 0.2, 1)
+		const uint32_t CLEAR_COLOR = 0xFF333333;
+
+		/// run fn( index ) for every index, in parallel if there is a job system
+		template< typename Fn >
+		static inline void ForEachIndex(JobSystem* jobSystem, const int count, const Fn& fn)
+		{
+			if (!jobSystem)
+			{
+				for (int i = 0; i < count; ++i)
+					fn(i);
+				return;
+			}
+
+			jobSystem->ParallelFor(0, count, 1, [&fn](const int begin, const int end, const int)
+				{
+					for (int i = begin; i < end; ++i)
+						fn(i);
+				});
+		}
+
+		/// tiles that may contain pixels of the line, false for lines outside of the screen (or not finite)
+		static inline bool GetLineTiles(const RenderVertex* line, const int width, const int height, const int numTilesX, const int numTilesY, int& outX0, int& outY0, int& outX1, int& outY1)
+		{
+			const float minX = std::min(line[0].x, line[1].x);
+			const float maxX = std::max(line[0].x, line[1].x);
+			const float minY = std::min(line[0].y, line[1].y);
+			const float maxY = std::max(line[0].y, line[1].y);
+
+			// written so that NaN and infinite coordinates fail
+			if (!(maxX - minX <= FLT_MAX && maxY - minY <= FLT_MAX))
+				return false;
+
+			// one pixel of margin covers the pixel center rounding of the rasterizer
+			if (!(maxX + 1.0f >= 0.0f && minX - 1.0f < (float)width && maxY + 1.0f >= 0.0f && minY - 1.0f < (float)height))
+				return false;
+
+			outX0 = (int)std::max(minX - 1.0f, 0.0f) / SoftwareRenderer::TILE_SIZE;
+			outY0 = (int)std::max(minY - 1.0f, 0.0f) / SoftwareRenderer::TILE_SIZE;
+			outX1 = std::min((int)std::min(maxX + 1.0f, (float)(width - 1)) / SoftwareRenderer::TILE_SIZE, numTilesX - 1);
+			outY1 = std::min((int)std::min(maxY + 1.0f, (float)(height - 1)) / SoftwareRenderer::TILE_SIZE, numTilesY - 1);
+			return true;
+		}
+
+		/// clamp with the same results as the SSE max/min pair, NaN becomes the lower limit
+		static inline float ClampMinor(const float value)
+		{
+			const float low = (value > -MINOR_LIMIT) ? value : -MINOR_LIMIT;
+			return (low < MINOR_LIMIT) ? low : MINOR_LIMIT;
+		}
+
+		/// draw line stepping along its major axis, only pixels inside of the major and minor ranges are written
+		/// Pixels with their center in [ma, mb) along the major axis are drawn, the minor coordinate is sampled at the center.
+		/// The SSE and scalar paths do the same float operations in the same order, so they produce the same pixels.
+		static void DrawLineMajor(uint32_t* pixels, const size_t majorStride, const size_t minorStride, float ma, float na, float mb, float nb,
+			const int majorBegin, const int majorEnd, const int minorBegin, const int minorEnd, const uint32_t color)
+		{
+			if (ma > mb)
+			{
+				std::swap(ma, mb);
+				std::swap(na, nb);
+			}
+
+			const float slope = (nb - na) / (mb - ma);
+			const int first = (int)ceilf(std::max(ma - 0.5f, (float)majorBegin));
+			const int last = (int)ceilf(std::min(mb - 0.5f, (float)majorEnd));
+
+			int c = first;
+
+#if defined(APP_SOFTWARE_RENDERER_SSE)
+			const __m128 vHalf = _mm_set1_ps(0.5f);
+			const __m128 vMa = _mm_set1_ps(ma);
+			const __m128 vNa = _mm_set1_ps(na);
+			const __m128 vSlope = _mm_set1_ps(slope);
+			const __m128 vLow = _mm_set1_ps(-MINOR_LIMIT);
+			const __m128 vHigh = _mm_set1_ps(MINOR_LIMIT);
+			const __m128i vMinorBegin = _mm_set1_epi32(minorBegin - 1);
+			const __m128i vMinorEnd = _mm_set1_epi32(minorEnd);
+			const __m128i vLanes = _mm_setr_epi32(0, 1, 2, 3);
+
+			for (; c + 4 <= last; c += 4)
+			{
+				const __m128 vc = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(c), vLanes));
+				const __m128 t = _mm_sub_ps(_mm_add_ps(vc, vHalf), vMa);
+				const __m128 n = _mm_min_ps(_mm_max_ps(_mm_add_ps(vNa, _mm_mul_ps(t, vSlope)), vLow), vHigh);
+
+				// floor, the truncation rounds the negative values up
+				__m128i minor = _mm_cvttps_epi32(n);
+				minor = _mm_add_epi32(minor, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(minor), n)));
+
+				const __m128i inside = _mm_and_si128(_mm_cmpgt_epi32(minor, vMinorBegin), _mm_cmplt_epi32(minor, vMinorEnd));
+				const int mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+				if (!mask)
+					continue;
+
+				alignas(16) int rows[4];
+				_mm_store_si128((__m128i*)rows, minor);
+
+				for (int i = 0; i < 4; ++i)
+				{
+					if (mask & (1 << i))
+						pixels[(size_t)(c + i) * majorStride + (size_t)rows[i] * minorStride] = color;
+				}
+			}
+#endif
+
+			for (; c < last; ++c)
+			{
+				const float t = ((float)c + 0.5f) - ma;
+				const int minor = (int)floorf(ClampMinor(na + t * slope));
+				if (minor >= minorBegin && minor < minorEnd)
+					pixels[(size_t)c * majorStride + (size_t)minor * minorStride] = color;
+			}
+		}
+
+		/// blend of the font shader: src * srcAlpha + dst * (1 - srcAlpha), the shader output is already multiplied by the glyph alpha
+		static inline uint32_t BlendGlyph(const uint32_t dst, const uint32_t src, const uint32_t alpha)
+		{
+			uint32_t result = 0;
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				const uint32_t s = (src >> shift) & 0xFF;
+				const uint32_t d = (dst >> shift) & 0xFF;
+				const uint32_t value = (alpha * alpha * s + (255 - alpha) * 255 * d + (255 * 255) / 2) / (255 * 255);
+				result |= value << shift;
+			}
+
+			return result;
+		}
+	}
+
+	SoftwareRenderer::SoftwareRenderer(const int width, const int height)
+		: m_width(width)
+		, m_height(height)
+		, m_numTilesX((width + TILE_SIZE - 1) / TILE_SIZE)
+		, m_numTilesY((height + TILE_SIZE - 1) / TILE_SIZE)
+		, m_pixels((size_t)width * (size_t)height, helper::CLEAR_COLOR)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	void SoftwareRenderer::Render(const RenderFrame& frame, JobSystem* jobSystem)
+	{
+		PROFILE_ZONE("SoftwareRenderer::Render");
+
+		{
+			ScopedTimer timer;
+			PrepareLines(frame, jobSystem);
+			m_text.Build(frame);
+			m_stats.m_prepareTime = timer.GetElaspedTime();
+		}
+
+		{
+			ScopedTimer timer;
+			BinLines(jobSystem);
+			m_stats.m_binTime = timer.GetElaspedTime();
+		}
+
+		{
+			PROFILE_ZONE("SoftwareRenderer::Raster");
+
+			ScopedTimer timer;
+			helper::ForEachIndex(jobSystem, m_numTilesX * m_numTilesY, [this](const int tileIndex) { DrawTile(tileIndex); });
+			m_stats.m_rasterTime = timer.GetElaspedTime();
+		}
+
+		m_stats.m_numLines = (int)(m_vertices.size() / 2);
+		m_stats.m_numBinnedLines = m_tileStart.back();
+		m_stats.m_numGlyphs = m_text.GetStats().m_numGlyphs;
+		m_stats.m_numStrings = m_text.GetStats().m_numStrings;
+		m_stats.m_numCachedStrings = m_text.GetStats().m_numCacheHits;
+	}
+
+	void SoftwareRenderer::PrepareLines(const RenderFrame& frame, JobSystem* jobSystem)
+	{
+		PROFILE_ZONE("SoftwareRenderer::PrepareLines");
+
+		// instances are expanded in batches, every batch knows where its vertices go after the counting pass
+		const RenderInstance* instances = frame.GetInstances().data();
+		const int numInstances = (int)frame.GetInstances().size();
+		const int numBatches = (numInstances + helper::INSTANCE_BATCH - 1) / helper::INSTANCE_BATCH;
+
+		m_batchCounts.resize(numBatches + 1);
+		helper::ForEachIndex(jobSystem, numBatches, [this, instances, numInstances](const int batch)
+			{
+				const int first = batch * helper::INSTANCE_BATCH;
+				const int count = std::min(helper::INSTANCE_BATCH, numInstances - first);
+				m_batchCounts[batch] = CountRenderInstanceVertices(instances + first, count);
+			});
+
+		int numInstanceVertices = 0;
+		for (int i = 0; i < numBatches; ++i)
+		{
+			const int count = m_batchCounts[i];
+			m_batchCounts[i] = numInstanceVertices;
+			numInstanceVertices += count;
+		}
+
+		m_vertices.resize((size_t)numInstanceVertices + (size_t)frame.GetNumVertices());
+
+		RenderVertex* vertices = m_vertices.data();
+		helper::ForEachIndex(jobSystem, numBatches, [this, instances, numInstances, vertices](const int batch)
+			{
+				const int first = batch * helper::INSTANCE_BATCH;
+				const int count = std::min(helper::INSTANCE_BATCH, numInstances - first);
+				ExpandRenderInstances(instances + first, count, vertices + m_batchCounts[batch]);
+			});
+
+		// lines are drawn after the instances
+		RenderVertex* writePtr = vertices + numInstanceVertices;
+		for (int i = 0; i < frame.GetNumUsedChunks(); ++i)
+		{
+			int numVertices = 0;
+			const RenderVertex* chunk = frame.GetChunk(i, numVertices);
+			memcpy(writePtr, chunk, numVertices * sizeof(RenderVertex));
+			writePtr += numVertices;
+		}
+	}
+
+	void SoftwareRenderer::BinLines(JobSystem* jobSystem)
+	{
+		PROFILE_ZONE("SoftwareRenderer::BinLines");
+
+		// counting sort by tile: every batch counts its lines per tile, the prefix sum over (tile, batch) gives every
+		// batch its own write range in each tile so the batches fill the tiles in parallel and in the submission order
+		const int numLines = (int)(m_vertices.size() / 2);
+		const int numTiles = m_numTilesX * m_numTilesY;
+		const int numBatches = (numLines + helper::BIN_BATCH_LINES - 1) / helper::BIN_BATCH_LINES;
+
+		m_binOffsets.assign((size_t)numBatches * numTiles, 0);
+
+		const RenderVertex* vertices = m_vertices.data();
+		helper::ForEachIndex(jobSystem, numBatches, [this, vertices, numLines, numTiles](const int batch)
+			{
+				int* counts = &m_binOffsets[(size_t)batch * numTiles];
+				const int first = batch * helper::BIN_BATCH_LINES;
+				const int last = std::min(first + helper::BIN_BATCH_LINES, numLines);
+				for (int line = first; line < last; ++line)
+				{
+					int tx0, ty0, tx1, ty1;
+					if (!helper::GetLineTiles(vertices + 2 * line, m_width, m_height, m_numTilesX, m_numTilesY, tx0, ty0, tx1, ty1))
+						continue;
+
+					for (int ty = ty0; ty <= ty1; ++ty)
+						for (int tx = tx0; tx <= tx1; ++tx)
+							counts[ty * m_numTilesX + tx] += 1;
+				}
+			});
+
+		m_tileStart.resize(numTiles + 1);
+
+		int total = 0;
+		for (int tile = 0; tile < numTiles; ++tile)
+		{
+			m_tileStart[tile] = total;
+			for (int batch = 0; batch < numBatches; ++batch)
+			{
+				int& offset = m_binOffsets[(size_t)batch * numTiles + tile];
+				const int count = offset;
+				offset = total;
+				total += count;
+			}
+		}
+
+		m_tileStart[numTiles] = total;
+		m_tileLines.resize(total);
+
+		helper::ForEachIndex(jobSystem, numBatches, [this, vertices, numLines, numTiles](const int batch)
+			{
+				int* offsets = &m_binOffsets[(size_t)batch * numTiles];
+				const int first = batch * helper::BIN_BATCH_LINES;
+				const int last = std::min(first + helper::BIN_BATCH_LINES, numLines);
+				for (int line = first; line < last; ++line)
+				{
+					int tx0, ty0, tx1, ty1;
+					if (!helper::GetLineTiles(vertices + 2 * line, m_width, m_height, m_numTilesX, m_numTilesY, tx0, ty0, tx1, ty1))
+						continue;
+
+					for (int ty = ty0; ty <= ty1; ++ty)
+						for (int tx = tx0; tx <= tx1; ++tx)
+							m_tileLines[offsets[ty * m_numTilesX + tx]++] = (uint32_t)line;
+				}
+			});
+	}
+
+	void SoftwareRenderer::DrawTile(const int tileIndex)
+	{
+		const int tileX = tileIndex % m_numTilesX;
+		const int tileY = tileIndex / m_numTilesX;
+
+		const int x0 = tileX * TILE_SIZE;
+		const int y0 = tileY * TILE_SIZE;
+		const int x1 = std::min(x0 + TILE_SIZE, m_width);
+		const int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+		// tiles never overlap, every worker writes only its own pixels
+		uint32_t* pixels = m_pixels.data();
+		const size_t pitch = (size_t)m_width;
+
+		for (int y = y0; y < y1; ++y)
+			std::fill(pixels + y * pitch + x0, pixels + y * pitch + x1, helper::CLEAR_COLOR);
+
+		const RenderVertex* vertices = m_vertices.data();
+		const uint32_t* lines = m_tileLines.data();
+		for (int i = m_tileStart[tileIndex]; i < m_tileStart[tileIndex + 1]; ++i)
+		{
+			const RenderVertex* line = vertices + 2 * lines[i];
+			const float dx = line[1].x - line[0].x;
+			const float dy = line[1].y - line[0].y;
+
+			// lines write opaque vertex colors (float4(color.xyz,1) of the line shader)
+			const uint32_t color = line[0].color | 0xFF000000;
+
+			if (fabsf(dx) >= fabsf(dy))
+			{
+				if (dx != 0.0f)
+					helper::DrawLineMajor(pixels, 1, pitch, line[0].x, line[0].y, line[1].x, line[1].y, x0, x1, y0, y1, color);
+			}
+			else
+			{
+				helper::DrawLineMajor(pixels, pitch, 1, line[0].y, line[0].x, line[1].y, line[1].x, y0, y1, x0, x1, color);
+			}
+		}
+
+		const uint8_t* fontAlpha = Font::GetInstance().GetAlpha();
+		for (const auto& quad : m_text.GetQuads())
+		{
+			const int qx0 = std::max(quad.x, x0);
+			const int qy0 = std::max(quad.y, y0);
+			const int qx1 = std::min(quad.x + quad.width, x1);
+			const int qy1 = std::min(quad.y + quad.height, y1);
+
+			for (int y = qy0; y < qy1; ++y)
+			{
+				const uint8_t* src = fontAlpha + (quad.srcY + (y - quad.y)) * Font::TEXTURE_WIDTH + quad.srcX;
+				uint32_t* dst = pixels + y * pitch;
+				for (int x = qx0; x < qx1; ++x)
+				{
+					const uint32_t alpha = src[x - quad.x];
+					if (alpha)
+						dst[x] = helper::BlendGlyph(dst[x], quad.color | 0xFF000000, alpha);
+				}
+			}
+		}
+	}
+
+	uint64_t SoftwareRenderer::GetChecksum() const
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (const uint32_t pixel : m_pixels)
+		{
+			hash ^= pixel;
+			hash *= 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	bool SoftwareRenderer::WritePPM(const char* path) const
+	{
+		FILE* f = fopen(path, "wb");
+		if (!f)
+		{
+			fprintf(stderr, "Unable to write frame '%s'\n", path);
+			return false;
+		}
+
+		bool ok = (fprintf(f, "P6\n%d %d\n255\n", m_width, m_height) > 0);
+
+		std::vector< uint8_t > row((size_t)m_width * 3);
+		for (int y = 0; ok && y < m_height; ++y)
+		{
+			const uint32_t* src = m_pixels.data() + (size_t)y * m_width;
+			for (int x = 0; x < m_width; ++x)
+			{
+				row[x * 3 + 0] = (uint8_t)(src[x]);
+				row[x * 3 + 1] = (uint8_t)(src[x] >> 8);
+				row[x * 3 + 2] = (uint8_t)(src[x] >> 16);
+			}
+
+			ok = (1 == fwrite(row.data(), row.size(), 1, f));
+		}
+
+		if (0 != fclose(f))
+			ok = false;
+
+		if (!ok)
+			fprintf(stderr, "Failed to write frame '%s'\n", path);
+
+		return ok;
+	}
+
+} // app
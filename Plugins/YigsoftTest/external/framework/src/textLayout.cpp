@@ -0,0 +1,210 @@
+/// (C) Yigsoft 2023
+
+#include "textLayout.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fontData.inl"
+
+namespace app
+{
+	namespace helper
+	{
+#pragma pack(push, 1)
+		struct FontChunkInfo
+		{
+			unsigned char id;
+			int size;
+		};
+
+		struct FontCharInfo
+		{
+			unsigned int id;
+			unsigned short x;
+			unsigned short y;
+			unsigned short width;
+			unsigned short height;
+			short xOffset;
+			short yOffset;
+			short xAdvance;
+			char page;
+			char chnl;
+		};
+#pragma pack(pop)
+	}
+
+	Font Font::st_instance;
+
+	Font::Font()
+		: m_alpha(TEXTURE_WIDTH * TEXTURE_HEIGHT)
+		, m_valid(false)
+	{
+		memset(m_glyphs, 0, sizeof(m_glyphs));
+
+		// convert font image (hacky), only one of the three channels is used
+		static_assert(sizeof(app::font::TextureData) == 3 * TEXTURE_WIDTH * TEXTURE_HEIGHT, "Font texture size does not match");
+		for (int i = 0; i < TEXTURE_WIDTH * TEXTURE_HEIGHT; ++i)
+			m_alpha[i] = (uint8_t)(app::font::TextureData[i * 3] << 2);
+
+		m_valid = Parse();
+	}
+
+	// http://www.angelcode.com/products/bmfont/doc/file_format.html#bin
+	bool Font::Parse()
+	{
+		const unsigned char* data = &app::font::FontData[0];
+		const int size = sizeof(app::font::FontData);
+
+		if (data[0] != 'B' || data[1] != 'M' || data[2] != 'F' || data[3] != 3)
+		{
+			fprintf(stderr, "Font data invalid!\n");
+			return false;
+		}
+
+		int pos = 4; // past header
+		while (pos < size)
+		{
+			const auto* chunk = (const helper::FontChunkInfo*)(data + pos);
+			if (chunk->id == 4 /* chars */)
+			{
+				const int numChars = chunk->size / (int)sizeof(helper::FontCharInfo);
+				const auto* charData = (const helper::FontCharInfo*)(data + pos + sizeof(helper::FontChunkInfo));
+				for (int i = 0; i < numChars; ++i, ++charData)
+				{
+					if (charData->id >= 256)
+						continue;
+
+					auto& glyph = m_glyphs[charData->id];
+					glyph.x = (int16_t)charData->x;
+					glyph.y = (int16_t)charData->y;
+					glyph.width = (int16_t)charData->width;
+					glyph.height = (int16_t)charData->height;
+					glyph.xOffset = charData->xOffset;
+					glyph.yOffset = charData->yOffset;
+					glyph.xAdvance = charData->xAdvance;
+				}
+			}
+
+			pos += sizeof(helper::FontChunkInfo) + chunk->size;
+		}
+
+		return true;
+	}
+
+	//-----
+
+	uint64_t TextBatcher::HashText(const char* text, const int length)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (int i = 0; i < length; ++i)
+		{
+			hash ^= (unsigned char)text[i];
+			hash *= 0x100000001B3ull;
+		}
+
+		return hash;
+	}
+
+	TextBatcher::TextBatcher(const int maxCachedLayouts, const THashFunc hashFunc)
+		: m_font(Font::GetInstance())
+		, m_hashFunc(hashFunc)
+		, m_maxCachedLayouts(maxCachedLayouts)
+		, m_buildIndex(0)
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	void TextBatcher::Layout(const char* text, const int length, std::vector< GlyphQuad >& outQuads) const
+	{
+		int curX = 0;
+		for (int i = 0; i < length; ++i)
+		{
+			const auto& glyph = m_font.GetGlyph((unsigned char)text[i]);
+			if (!glyph.xAdvance)
+				continue;
+
+			// space and control characters only advance
+			if (text[i] > 32)
+			{
+				GlyphQuad quad;
+				quad.x = curX + glyph.xOffset;
+				quad.y = glyph.yOffset;
+				quad.width = glyph.width;
+				quad.height = glyph.height;
+				quad.srcX = glyph.x;
+				quad.srcY = glyph.y;
+				quad.color = 0;
+				outQuads.push_back(quad);
+			}
+
+			curX += glyph.xAdvance;
+		}
+	}
+
+	void TextBatcher::Build(const RenderFrame& frame)
+	{
+		m_buildIndex += 1;
+		m_quads.clear();
+
+		int numCacheHits = 0;
+		for (const auto& str : frame.GetStrings())
+		{
+			const char* text = frame.GetText(str);
+			const uint64_t hash = m_hashFunc(text, str.textLength);
+
+			// entries created just now have m_lastUsed 0
+			auto& layout = m_cache[hash];
+			if (layout.m_lastUsed && layout.m_text.size() == (size_t)str.textLength && 0 == memcmp(layout.m_text.data(), text, str.textLength))
+			{
+				numCacheHits += 1;
+			}
+			else
+			{
+				// new text (or a hash collision, the newer text wins)
+				layout.m_text.assign(text, str.textLength);
+				layout.m_quads.clear();
+				Layout(text, str.textLength, layout.m_quads);
+			}
+
+			layout.m_lastUsed = m_buildIndex;
+
+			for (const auto& cached : layout.m_quads)
+			{
+				GlyphQuad quad = cached;
+				quad.x += str.x;
+				quad.y += str.y;
+				quad.color = str.color;
+				m_quads.push_back(quad);
+			}
+		}
+
+		TrimCache();
+
+		m_stats.m_numStrings = (int)frame.GetStrings().size();
+		m_stats.m_numGlyphs = (int)m_quads.size();
+		m_stats.m_numCacheHits = numCacheHits;
+		m_stats.m_numCachedLayouts = (int)m_cache.size();
+	}
+
+	void TextBatcher::TrimCache()
+	{
+		if ((int)m_cache.size() <= m_maxCachedLayouts)
+			return;
+
+		// strings that change every frame (timings) fill the cache, keep only what the last frame used
+		for (auto it = m_cache.begin(); it != m_cache.end(); )
+		{
+			if (it->second.m_lastUsed != m_buildIndex)
+				it = m_cache.erase(it);
+			else
+				++it;
+		}
+	}
+
+	void TextBatcher::ClearCache()
+	{
+		m_cache.clear();
+	}
+
+} // app
@@ -107,7 +107,7 @@ namespace app
 		BufferInfo::BufferInfo( ID3D11Buffer* buffer, ID3D11Buffer* copyBuffer, int size )
 			: m_buffer( buffer )
 			, m_size( size )
-			, m_offset( 0 )
+			, m_ring( size )
 			, m_copyLockOffset( -1 )
 			, m_copyLockSize( -1 )
 			, m_copyBuffer( copyBuffer )
@@ -122,17 +122,23 @@ namespace app
 
 		void* BufferInfo::Lock( ID3D11DeviceContext* context, int size, int& outOffset )
 		{
-			if ( m_offset + size > m_size )
-				outOffset = 0;
-			else
-				outOffset = m_offset;
-
-			m_offset = outOffset + size;
+			// callers split larger uploads into batches (ForEachStreamBatch), a range larger than the ring is a bug in the caller
+			outOffset = m_ring.Allocate( size );
+			if ( outOffset < 0 )
+			{
+				fprintf( stderr, "Upload of %d bytes does not fit the buffer (%d bytes)\n", size, m_ring.GetCapacity() );
+				return nullptr;
+			}
 
 			// copy to temporary buffer
 			D3D11_MAPPED_SUBRESOURCE mapData;
 			HRESULT hRet = context->Map( m_copyBuffer, 0, D3D11_MAP_WRITE, 0, &mapData );
-			assert( SUCCEEDED(hRet) );
+			if ( FAILED(hRet) )
+			{
+				fprintf( stderr, "Failed to map upload buffer: 0x%08X\n", hRet );
+				outOffset = -1;
+				return nullptr;
+			}
 
 			m_copyLockOffset = outOffset;
 			m_copyLockSize = size;
@@ -243,9 +249,16 @@ namespace app
 			, m_endPtr( nullptr )
 		{
 			m_writePtr = (unsigned char*) m_buffer->Lock( context, size, outOffset );
-			m_endPtr = m_writePtr + size;
-
 			m_lockOffset = outOffset;
+
+			// nothing to unlock, the writes are skipped
+			if ( m_writePtr == nullptr )
+			{
+				m_buffer = nullptr;
+				return;
+			}
+
+			m_endPtr = m_writePtr + size;
 		}
 
 		BufferWriter::~BufferWriter()
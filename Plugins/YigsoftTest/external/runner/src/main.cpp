@@ -0,0 +1,556 @@
+/// (C) Yigsoft 2023
+
+/// Headless simulation runner
+/// Runs the physics test app without a window or renderer and reports the tick timings.
+
+#include "frameworkCore.h"
+#include "jobSystem.h"
+#include "physicsComparison.h"
+#include "profiler.h"
+#include "softwareRenderer.h"
+#include "testApp.h"
+#include "testKernels.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+namespace runner
+{
+	/// app configuration of the compare mode
+	struct Variant
+	{
+		std::string			m_name; // as given on the command line
+		test::Broadphase	m_broadphase;
+		test::CollisionSolver	m_collisionSolver;
+	};
+
+	struct Options
+	{
+		int			m_numBodies = 1000;
+		int			m_scenario = 0;
+		int			m_numTicks = 500;
+		int			m_numWarmupTicks = 10;
+		float		m_timeDelta = 1.0f / 60.0f;
+		unsigned	m_seed = 1;
+		int			m_numWorkers = 0;
+		test::Broadphase	m_broadphase = test::Broadphase::Grid;
+		test::CollisionSolver	m_collisionSolver = test::CollisionSolver::Sequential;
+		float		m_skin = test::NeighbourList::DEFAULT_SKIN;
+		const char*	m_tracePath = nullptr;
+		const char*	m_loadPath = nullptr;
+		const char*	m_savePath = nullptr;
+		const char*	m_renderPath = nullptr;
+		test::SimdLevel	m_simdLevel = test::SimdLevel::AVX512; // clamped to the supported one
+		std::vector< Variant >	m_compare; // run side by side, the first one is the baseline
+		bool		m_check = false; // fail if a compared variant diverges from the baseline
+	};
+
+	struct TickStats
+	{
+		double	m_mean;
+		double	m_p50;
+		double	m_p99;
+		double	m_max;
+		double	m_total;
+	};
+
+	namespace helper
+	{
+		static void PrintUsage(const char* exeName)
+		{
+			fprintf(stderr, "Usage: %s [options]\n", exeName);
+			fprintf(stderr, "  --bodies N        number of bodies (default 1000), the body limit is raised to fit\n");
+			fprintf(stderr, "  --scenario N      scenario index (default 0)\n");
+			fprintf(stderr, "  --ticks N         number of measured ticks (default 500)\n");
+			fprintf(stderr, "  --warmup N        number of ticks run before measuring (default 10)\n");
+			fprintf(stderr, "  --dt SECONDS      time step (default 1/60)\n");
+			fprintf(stderr, "  --seed N          random seed for the initial scene (default 1)\n");
+			fprintf(stderr, "  --workers N       job system workers including the main thread, 0 - one per hardware thread (default 0)\n");
+			fprintf(stderr, "  --broadphase X    grid, lists or brute (default grid)\n");
+			fprintf(stderr, "  --collision X     sequential or jacobi (parallel, same result for any number of workers), default sequential\n");
+			fprintf(stderr, "  --skin DISTANCE   skin of the neighbour lists (default %.1f)\n", test::NeighbourList::DEFAULT_SKIN);
+			fprintf(stderr, "  --trace FILE      capture zones of the measured ticks as Chrome trace JSON (timings include the capture)\n");
+			fprintf(stderr, "  --load FILE       start from a scene snapshot instead of generating one (--bodies, --scenario and --seed are ignored)\n");
+			fprintf(stderr, "  --save FILE       save the scene after the warmup, loading it with --warmup 0 repeats the measured ticks\n");
+			fprintf(stderr, "  --render FILE     draw every measured tick with the software renderer (timed apart from the tick), last frame is written as PPM\n");
+			fprintf(stderr, "  --simd X          scalar, sse2, avx2 or avx512, limit of the batch kernels (default: best supported)\n");
+			fprintf(stderr, "  --compare X,Y,..  step one app per variant on the same scene and compare the tick times and positions with the first one,\n");
+			fprintf(stderr, "                    variant is a broadphase optionally followed by /jacobi, e.g. grid,grid/jacobi\n");
+			fprintf(stderr, "  --check           with --compare, exit with an error if any variant diverges from the first one\n");
+		}
+
+		static bool ParseBroadphase(const char* value, test::Broadphase& outBroadphase)
+		{
+			if (0 == strcmp(value, "grid"))
+				outBroadphase = test::Broadphase::Grid;
+			else if (0 == strcmp(value, "lists"))
+				outBroadphase = test::Broadphase::NeighbourLists;
+			else if (0 == strcmp(value, "brute"))
+				outBroadphase = test::Broadphase::BruteForce;
+			else
+			{
+				fprintf(stderr, "Unknown broadphase '%s'\n", value);
+				return false;
+			}
+
+			return true;
+		}
+
+		static bool ParseSimdLevel(const char* value, test::SimdLevel& outLevel)
+		{
+			for (int level = (int)test::SimdLevel::Scalar; level <= (int)test::SimdLevel::AVX512; ++level)
+			{
+				if (0 == strcmp(value, test::kernels::GetLevelName((test::SimdLevel)level)))
+				{
+					outLevel = (test::SimdLevel)level;
+					return true;
+				}
+			}
+
+			fprintf(stderr, "Unknown SIMD level '%s'\n", value);
+			return false;
+		}
+
+		static const char* GetBroadphaseName(const test::Broadphase broadphase)
+		{
+			if (broadphase == test::Broadphase::Grid)
+				return "grid";
+			else if (broadphase == test::Broadphase::NeighbourLists)
+				return "lists";
+
+			return "brute";
+		}
+
+		static bool ParseCollisionSolver(const char* value, test::CollisionSolver& outSolver)
+		{
+			if (0 == strcmp(value, "sequential"))
+				outSolver = test::CollisionSolver::Sequential;
+			else if (0 == strcmp(value, "jacobi"))
+				outSolver = test::CollisionSolver::Jacobi;
+			else
+			{
+				fprintf(stderr, "Unknown collision solver '%s'\n", value);
+				return false;
+			}
+
+			return true;
+		}
+
+		/// comma separated variants, BROADPHASE[/SOLVER]
+		static bool ParseVariantList(const char* value, std::vector< Variant >& outVariants)
+		{
+			outVariants.clear();
+
+			const char* start = value;
+			for (;;)
+			{
+				const char* end = strchr(start, ',');
+
+				Variant variant;
+				variant.m_name = end ? std::string(start, end) : std::string(start);
+				variant.m_collisionSolver = test::CollisionSolver::Sequential;
+
+				const size_t separator = variant.m_name.find('/');
+				const std::string broadphase = variant.m_name.substr(0, separator);
+				if (!ParseBroadphase(broadphase.c_str(), variant.m_broadphase))
+					return false;
+
+				if (separator != std::string::npos && !ParseCollisionSolver(variant.m_name.c_str() + separator + 1, variant.m_collisionSolver))
+					return false;
+
+				outVariants.push_back(variant);
+
+				if (!end)
+					return true;
+
+				start = end + 1;
+			}
+		}
+
+		static bool ParseOptions(const int argc, char** argv, Options& outOptions)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char* name = argv[i];
+				if (0 == strcmp(name, "--help") || 0 == strcmp(name, "-h"))
+					return false;
+
+				// flags, no value
+				if (0 == strcmp(name, "--check"))
+				{
+					outOptions.m_check = true;
+					continue;
+				}
+
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "Missing value for '%s'\n", name);
+					return false;
+				}
+
+				const char* value = argv[++i];
+
+				if (0 == strcmp(name, "--bodies"))
+					outOptions.m_numBodies = atoi(value);
+				else if (0 == strcmp(name, "--scenario"))
+					outOptions.m_scenario = atoi(value);
+				else if (0 == strcmp(name, "--ticks"))
+					outOptions.m_numTicks = atoi(value);
+				else if (0 == strcmp(name, "--warmup"))
+					outOptions.m_numWarmupTicks = atoi(value);
+				else if (0 == strcmp(name, "--dt"))
+					outOptions.m_timeDelta = (float)atof(value);
+				else if (0 == strcmp(name, "--seed"))
+					outOptions.m_seed = (unsigned)strtoul(value, nullptr, 10);
+				else if (0 == strcmp(name, "--workers"))
+					outOptions.m_numWorkers = atoi(value);
+				else if (0 == strcmp(name, "--broadphase"))
+				{
+					if (!ParseBroadphase(value, outOptions.m_broadphase))
+						return false;
+				}
+				else if (0 == strcmp(name, "--collision"))
+				{
+					if (!ParseCollisionSolver(value, outOptions.m_collisionSolver))
+						return false;
+				}
+				else if (0 == strcmp(name, "--skin"))
+					outOptions.m_skin = (float)atof(value);
+				else if (0 == strcmp(name, "--trace"))
+					outOptions.m_tracePath = value;
+				else if (0 == strcmp(name, "--load"))
+					outOptions.m_loadPath = value;
+				else if (0 == strcmp(name, "--save"))
+					outOptions.m_savePath = value;
+				else if (0 == strcmp(name, "--render"))
+					outOptions.m_renderPath = value;
+				else if (0 == strcmp(name, "--simd"))
+				{
+					if (!ParseSimdLevel(value, outOptions.m_simdLevel))
+						return false;
+				}
+				else if (0 == strcmp(name, "--compare"))
+				{
+					if (!ParseVariantList(value, outOptions.m_compare))
+						return false;
+				}
+				else
+				{
+					fprintf(stderr, "Unknown option '%s'\n", name);
+					return false;
+				}
+			}
+
+			if (outOptions.m_numBodies < 0 || outOptions.m_numTicks <= 0 || outOptions.m_numWarmupTicks < 0 || outOptions.m_timeDelta <= 0.0f || outOptions.m_numWorkers < 0 || outOptions.m_skin < 0.0f)
+			{
+				fprintf(stderr, "Invalid option value\n");
+				return false;
+			}
+
+			if (!outOptions.m_compare.empty() && (outOptions.m_savePath || outOptions.m_renderPath || outOptions.m_tracePath))
+			{
+				fprintf(stderr, "--compare can't be combined with --save, --render or --trace\n");
+				return false;
+			}
+
+			if (outOptions.m_check && outOptions.m_compare.empty())
+			{
+				fprintf(stderr, "--check needs --compare\n");
+				return false;
+			}
+
+			return true;
+		}
+
+		static double Percentile(const std::vector< double >& sortedTimes, const double fraction)
+		{
+			// nearest rank
+			const size_t count = sortedTimes.size();
+			size_t rank = (size_t)(fraction * (double)count + 0.999999);
+			if (rank < 1)
+				rank = 1;
+			if (rank > count)
+				rank = count;
+
+			return sortedTimes[rank - 1];
+		}
+
+		static TickStats ComputeStats(std::vector< double > times)
+		{
+			TickStats stats;
+			stats.m_total = 0.0;
+			for (const double time : times)
+				stats.m_total += time;
+
+			std::sort(times.begin(), times.end());
+
+			stats.m_mean = stats.m_total / (double)times.size();
+			stats.m_p50 = Percentile(times, 0.50);
+			stats.m_p99 = Percentile(times, 0.99);
+			stats.m_max = times.back();
+			return stats;
+		}
+	}
+
+	/// A/B mode, every app variant runs the same scene, see test::RunComparison
+	static int RunCompare(const Options& options)
+	{
+		app::JobSystem jobSystem(options.m_numWorkers);
+
+		app::AppInitContext initContext;
+		initContext.m_width = (uint32_t)app::Resolution::WIDTH;
+		initContext.m_height = (uint32_t)app::Resolution::HEIGHT;
+		initContext.m_device = nullptr;
+		initContext.m_deviceContext = nullptr;
+		initContext.m_jobSystem = &jobSystem;
+
+		std::vector< std::unique_ptr< test::App > > simulations;
+		std::vector< test::ComparedApp > apps;
+		for (const auto& variant : options.m_compare)
+		{
+			simulations.emplace_back(new test::App());
+
+			test::App& simulation = *simulations.back();
+			if (!simulation.OnInit(initContext))
+			{
+				fprintf(stderr, "Failed to initialize the simulation\n");
+				return 1;
+			}
+
+			simulation.SetBroadphase(variant.m_broadphase);
+			simulation.SetCollisionSolver(variant.m_collisionSolver);
+			simulation.SetNeighbourSkin(options.m_skin);
+
+			// every variant loads its own copy of the scene
+			if (options.m_loadPath && !simulation.LoadSnapshot(options.m_loadPath))
+				return 1;
+
+			test::ComparedApp compared;
+			compared.m_app = &simulation;
+			compared.m_name = variant.m_name.c_str();
+			apps.push_back(compared);
+		}
+
+		test::ComparisonSettings settings;
+		settings.m_numBodies = options.m_numBodies;
+		settings.m_scenario = options.m_scenario;
+		settings.m_seed = options.m_seed;
+		settings.m_numTicks = options.m_numTicks;
+		settings.m_numWarmupTicks = options.m_numWarmupTicks;
+		settings.m_timeDelta = options.m_timeDelta;
+
+		if (options.m_loadPath)
+		{
+			settings.m_numBodies = simulations[0]->GetNumBodies();
+			settings.m_scenario = simulations[0]->GetScenario();
+			settings.m_seed = simulations[0]->GetSeed();
+			settings.m_resetScene = false;
+		}
+
+		std::vector< test::ComparisonResult > results;
+		if (!test::RunComparison(apps, settings, results))
+			return 1;
+
+		printf("workers:     %d\n", jobSystem.GetNumWorkers());
+		printf("simd:        %s\n", test::kernels::GetLevelName(test::kernels::GetLevel()));
+		test::PrintComparison(stdout, settings, results);
+
+		if (options.m_check)
+		{
+			int numDiverged = 0;
+			for (const auto& result : results)
+			{
+				if (result.m_divergedTick >= 0)
+				{
+					fprintf(stderr, "'%s' diverged from '%s' at tick %d\n", result.m_name, results[0].m_name, result.m_divergedTick);
+					++numDiverged;
+				}
+			}
+
+			if (numDiverged)
+				return 1;
+		}
+
+		return 0;
+	}
+
+	static int Run(const Options& options)
+	{
+		app::JobSystem jobSystem(options.m_numWorkers);
+
+		app::AppInitContext initContext;
+		initContext.m_width = (uint32_t)app::Resolution::WIDTH;
+		initContext.m_height = (uint32_t)app::Resolution::HEIGHT;
+		initContext.m_device = nullptr;
+		initContext.m_deviceContext = nullptr;
+		initContext.m_jobSystem = &jobSystem;
+
+		test::App simulation;
+		if (!simulation.OnInit(initContext))
+		{
+			fprintf(stderr, "Failed to initialize the simulation\n");
+			return 1;
+		}
+
+		if (options.m_loadPath)
+		{
+			if (!simulation.LoadSnapshot(options.m_loadPath))
+				return 1;
+		}
+		else
+		{
+			// the scene depends only on the seed and scenario
+			simulation.SetNumBodies(0);
+			simulation.SetScenario(options.m_scenario);
+			simulation.SetSeed(options.m_seed);
+			if (options.m_numBodies > simulation.GetMaxBodies())
+				simulation.SetMaxBodies(options.m_numBodies);
+			simulation.SetNumBodies(options.m_numBodies);
+		}
+
+		simulation.SetBroadphase(options.m_broadphase);
+		simulation.SetCollisionSolver(options.m_collisionSolver);
+		simulation.SetNeighbourSkin(options.m_skin);
+
+		const int numBodies = simulation.GetNumBodies();
+		if (!options.m_loadPath && numBodies != options.m_numBodies)
+			fprintf(stderr, "Warning: running with %d bodies instead of %d\n", numBodies, options.m_numBodies);
+
+		for (int i = 0; i < options.m_numWarmupTicks; ++i)
+			simulation.OnTick(options.m_timeDelta);
+
+		if (options.m_savePath && !simulation.SaveSnapshot(options.m_savePath))
+			return 1;
+
+		const test::NeighbourListStats warmupLists = simulation.GetNeighbourListStats();
+
+		std::vector< double > tickTimes;
+		tickTimes.reserve(options.m_numTicks);
+
+		std::vector< double > renderTimes;
+		std::unique_ptr< app::RenderFrame > frame;
+		std::unique_ptr< app::SoftwareRenderer > renderer;
+		if (options.m_renderPath)
+		{
+			renderTimes.reserve(options.m_numTicks);
+			frame.reset(new app::RenderFrame());
+			renderer.reset(new app::SoftwareRenderer());
+		}
+
+		test::SimCounters totalCounters;
+
+		app::Profiler::SetThreadName("Main");
+		app::Profiler::SetEnabled(options.m_tracePath != nullptr);
+
+		for (int i = 0; i < options.m_numTicks; ++i)
+		{
+			app::Profiler::MarkFrame();
+
+			app::ScopedTimer timer;
+			simulation.OnTick(options.m_timeDelta);
+			tickTimes.push_back(timer.GetElaspedTime());
+
+			totalCounters.Add(simulation.GetCounters());
+
+			if (renderer)
+			{
+				app::ScopedTimer renderTimer;
+				frame->Reset();
+				simulation.OnRender(*frame);
+				renderer->Render(*frame, &jobSystem);
+				renderTimes.push_back(renderTimer.GetElaspedTime());
+			}
+		}
+
+		app::Profiler::SetEnabled(false);
+
+		const auto stats = helper::ComputeStats(tickTimes);
+		const double bodiesPerSecond = (double)numBodies * (double)options.m_numTicks / stats.m_total;
+
+		printf("bodies:      %d\n", numBodies);
+		printf("scenario:    %d\n", simulation.GetScenario());
+		printf("broadphase:  %s\n", helper::GetBroadphaseName(options.m_broadphase));
+		printf("collisions:  %s\n", (options.m_collisionSolver == test::CollisionSolver::Jacobi) ? "jacobi" : "sequential");
+		printf("workers:     %d\n", jobSystem.GetNumWorkers());
+		printf("simd:        %s\n", test::kernels::GetLevelName(test::kernels::GetLevel()));
+		printf("ticks:       %d (dt %.6f, seed %llu)\n", options.m_numTicks, options.m_timeDelta, (unsigned long long)simulation.GetSeed());
+		printf("tick mean:   %.3f ms\n", 1000.0 * stats.m_mean);
+		printf("tick p50:    %.3f ms\n", 1000.0 * stats.m_p50);
+		printf("tick p99:    %.3f ms\n", 1000.0 * stats.m_p99);
+		printf("tick max:    %.3f ms\n", 1000.0 * stats.m_max);
+		printf("bodies/s:    %.0f\n", bodiesPerSecond);
+
+		// per tick averages of the measured ticks
+		const double numTicks = (double)options.m_numTicks;
+		printf("pairs:       %.0f per tick\n", (double)totalCounters.m_numPairs / numTicks);
+		printf("overlaps:    %.0f tests, %.0f hits per tick\n", (double)totalCounters.m_numOverlapTests / numTicks, (double)totalCounters.m_numOverlaps / numTicks);
+		printf("attractors:  %.0f hits per tick\n", (double)totalCounters.m_numAttractorHits / numTicks);
+		printf("corrections: %.0f per tick\n", (double)totalCounters.m_numCorrections / numTicks);
+		printf("candidates:  %.1f avg, %d max per body\n", numBodies ? (double)totalCounters.m_numNeighbours / (numTicks * numBodies) : 0.0, totalCounters.m_maxNeighbours);
+
+		if (options.m_broadphase == test::Broadphase::NeighbourLists)
+		{
+			// only the measured ticks
+			const test::NeighbourListStats lists = simulation.GetNeighbourListStats();
+			const int numBuilds = lists.m_numBuilds - warmupLists.m_numBuilds;
+			const int numUpdates = lists.m_numUpdates - warmupLists.m_numUpdates;
+			const double buildTime = lists.m_buildTime - warmupLists.m_buildTime;
+
+			printf("list skin:   %.2f\n", lists.m_skin);
+			printf("rebuilds:    %d of %d ticks (%.3f ms each)\n", numBuilds, numUpdates, numBuilds ? 1000.0 * buildTime / numBuilds : 0.0);
+			printf("neighbours:  %.1f avg, %d max, %.1f avg in collision range\n", numBodies ? (double)lists.m_numEntries / numBodies : 0.0, lists.m_maxNeighbours,
+				numBodies ? (double)lists.m_numCollisionEntries / numBodies : 0.0);
+		}
+
+		if (renderer)
+		{
+			const auto renderStats = helper::ComputeStats(renderTimes);
+			const auto& lastFrame = renderer->GetStats(); // phases and sizes of the last frame only
+
+			printf("render mean: %.3f ms (OnRender and software raster)\n", 1000.0 * renderStats.m_mean);
+			printf("render p50:  %.3f ms\n", 1000.0 * renderStats.m_p50);
+			printf("render p99:  %.3f ms\n", 1000.0 * renderStats.m_p99);
+			printf("raster:      %.3f ms prepare, %.3f ms bin, %.3f ms tiles\n", 1000.0 * lastFrame.m_prepareTime, 1000.0 * lastFrame.m_binTime, 1000.0 * lastFrame.m_rasterTime);
+			printf("lines:       %d (%d tile references)\n", lastFrame.m_numLines, lastFrame.m_numBinnedLines);
+			printf("text:        %d glyphs, %d of %d strings from the layout cache\n", lastFrame.m_numGlyphs, lastFrame.m_numCachedStrings, lastFrame.m_numStrings);
+			printf("frame:       %s (checksum %016llx)\n", options.m_renderPath, (unsigned long long)renderer->GetChecksum());
+
+			if (!renderer->WritePPM(options.m_renderPath))
+				return 1;
+		}
+
+		if (options.m_tracePath)
+		{
+			if (!app::Profiler::ExportChromeTrace(options.m_tracePath))
+				return 1;
+
+			printf("trace:       %s\n", options.m_tracePath);
+		}
+
+		return 0;
+	}
+
+} // runner
+
+int main(int argc, char** argv)
+{
+	runner::Options options;
+	if (!runner::helper::ParseOptions(argc, argv, options))
+	{
+		runner::helper::PrintUsage(argv[0]);
+		return 1;
+	}
+
+	test::kernels::SetLevel(options.m_simdLevel);
+
+	if (!options.m_compare.empty())
+		return runner::RunCompare(options);
+
+	return runner::Run(options);
+}
@@ -0,0 +1,930 @@
+/// (C) Yigsoft 2023
+
+/// Unit tests of the framework pieces that the benchmarks can not verify
+/// Every case runs on its own, ctest starts the binary once per case name.
+
+#include "frameworkCore.h"
+#include "jobSystem.h"
+#include "physicsTestApp.h"
+#include "random.h"
+#include "softwareRenderer.h"
+#include "textLayout.h"
+#include "testBodyStore.h"
+#include "testKernels.h"
+#include "testNarrowphase.h"
+#include "testShape.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <functional>
+#include <limits>
+
+/// report the failed condition and fail the case
+#define CHECK(cond) \
+	do { if (!(cond)) { fprintf(stderr, "%s(%d): CHECK failed: %s\n", __FILE__, __LINE__, #cond); return false; } } while (0)
+
+namespace tests
+{
+	/// single test, returns false on failure (the details are printed by CHECK)
+	struct Case
+	{
+		std::string				m_name;
+		std::function<bool()>	m_run;
+	};
+
+	namespace helper
+	{
+		/// run ParallelFor over [begin, end) and check that every index was visited exactly once by a valid worker
+		static bool CheckCoverage(app::JobSystem& jobSystem, const int begin, const int end, const int grainSize)
+		{
+			std::vector< std::atomic<int> > visits(end > begin ? end - begin : 0);
+			for (auto& count : visits)
+				count.store(0);
+
+			std::atomic<int> badWorkerIndex(0);
+			jobSystem.ParallelFor(begin, end, grainSize, [&](const int rangeBegin, const int rangeEnd, const int workerIndex)
+				{
+					if (workerIndex < 0 || workerIndex >= jobSystem.GetNumWorkers())
+						badWorkerIndex.fetch_add(1);
+
+					for (int i = rangeBegin; i < rangeEnd; ++i)
+						visits[i - begin].fetch_add(1);
+				});
+
+			CHECK(badWorkerIndex.load() == 0);
+			for (const auto& count : visits)
+				CHECK(count.load() == 1);
+
+			return true;
+		}
+	}
+
+	static void AddJobSystemCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "JobSystem.ParallelForCoversRange", []()
+			{
+				app::JobSystem jobSystem(4);
+
+				// exact multiple, remainder, one chunk, bigger grain than the range, empty range
+				CHECK(helper::CheckCoverage(jobSystem, 0, 1000, 10));
+				CHECK(helper::CheckCoverage(jobSystem, 5, 1002, 7));
+				CHECK(helper::CheckCoverage(jobSystem, 0, 3, 1));
+				CHECK(helper::CheckCoverage(jobSystem, 0, 50, 100));
+				CHECK(helper::CheckCoverage(jobSystem, 10, 10, 4));
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.InlinePool", []()
+			{
+				// no threads at all, everything runs in place as worker 0
+				app::JobSystem jobSystem(1);
+				CHECK(jobSystem.GetNumWorkers() == 1);
+				CHECK(helper::CheckCoverage(jobSystem, 0, 100, 3));
+
+				int maxWorkerIndex = -1;
+				jobSystem.ParallelFor(0, 100, 1, [&](const int, const int, const int workerIndex)
+					{
+						maxWorkerIndex = (workerIndex > maxWorkerIndex) ? workerIndex : maxWorkerIndex;
+					});
+
+				CHECK(maxWorkerIndex == 0);
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.NestedParallelFor", []()
+			{
+				app::JobSystem jobSystem(4);
+
+				// the inner loops keep the worker index of the chunk that started them
+				std::atomic<int> total(0);
+				std::atomic<int> mismatches(0);
+				jobSystem.ParallelFor(0, 16, 1, [&](const int begin, const int end, const int outerWorker)
+					{
+						for (int i = begin; i < end; ++i)
+						{
+							jobSystem.ParallelFor(0, 64, 8, [&](const int innerBegin, const int innerEnd, const int innerWorker)
+								{
+									if (innerWorker < 0 || innerWorker >= jobSystem.GetNumWorkers())
+										mismatches.fetch_add(1);
+
+									total.fetch_add(innerEnd - innerBegin);
+								});
+						}
+
+						if (jobSystem.GetCurrentWorkerIndex() != outerWorker)
+							mismatches.fetch_add(1);
+					});
+
+				CHECK(total.load() == 16 * 64);
+				CHECK(mismatches.load() == 0);
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.ExternalThreadsTakeTurns", []()
+			{
+				app::JobSystem jobSystem(3);
+
+				// a different outside thread per call, like the engine tasks that tick the app, all of them run as worker 0
+				for (int round = 0; round < 4; ++round)
+				{
+					bool covered = false;
+					int outsideIndex = -1;
+					std::thread caller([&]()
+						{
+							covered = helper::CheckCoverage(jobSystem, 0, 500, 16);
+							jobSystem.ParallelFor(0, 1, 1, [&](const int, const int, const int workerIndex) { outsideIndex = workerIndex; });
+						});
+					caller.join();
+
+					CHECK(covered);
+					CHECK(outsideIndex == 0);
+				}
+
+				// the binding ends with the call
+				CHECK(jobSystem.GetCurrentWorkerIndex() == 0);
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.ConcurrentOutsideCallers", []()
+			{
+				app::JobSystem jobSystem(3);
+
+				// two outside threads at the same time, the second one waits for its turn as worker 0 (in release builds too),
+				// so no chunk ever sees its worker scratch changed by another chunk
+				std::atomic<int> numCorrupted(0);
+				std::atomic<int> numChunks(0);
+				auto caller = [&](const int token)
+				{
+					for (int round = 0; round < 50; ++round)
+					{
+						jobSystem.ParallelFor(0, 64, 4, [&](const int begin, const int end, const int workerIndex)
+							{
+								std::vector< int >& scratch = jobSystem.GetScratch(workerIndex).GetArray< int >();
+								scratch.assign(256, token + begin);
+								std::this_thread::yield();
+
+								for (const int value : scratch)
+									if (value != token + begin)
+										numCorrupted.fetch_add(1);
+
+								numChunks.fetch_add(end > begin ? 1 : 0);
+							});
+					}
+				};
+
+				std::thread first(caller, 1000);
+				std::thread second(caller, 2000);
+				first.join();
+				second.join();
+
+				CHECK(numCorrupted.load() == 0);
+				CHECK(numChunks.load() == 2 * 50 * 16);
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.TaskGroupWait", []()
+			{
+				for (const int numWorkers : { 1, 4 })
+				{
+					app::JobSystem jobSystem(numWorkers);
+
+					// tasks launched one by one, some launch more tasks into their own group and wait for them
+					const int NUM_TASKS = 100;
+					std::atomic<int> numDone(0);
+					std::atomic<int> numNestedDone(0);
+					std::atomic<int> badWorkerIndex(0);
+
+					app::TaskGroup group;
+					for (int i = 0; i < NUM_TASKS; ++i)
+					{
+						jobSystem.Run(group, [&, i](const int workerIndex)
+							{
+								if (workerIndex < 0 || workerIndex >= jobSystem.GetNumWorkers() || workerIndex != jobSystem.GetCurrentWorkerIndex())
+									badWorkerIndex.fetch_add(1);
+
+								if ((i % 10) == 0)
+								{
+									app::TaskGroup nested;
+									for (int j = 0; j < 5; ++j)
+										jobSystem.Run(nested, [&](const int) { numNestedDone.fetch_add(1); });
+
+									jobSystem.Wait(nested);
+									if (!nested.IsDone())
+										badWorkerIndex.fetch_add(1);
+								}
+
+								numDone.fetch_add(1);
+							});
+					}
+
+					jobSystem.Wait(group);
+					CHECK(group.IsDone());
+					CHECK(numDone.load() == NUM_TASKS);
+					CHECK(numNestedDone.load() == (NUM_TASKS / 10) * 5);
+					CHECK(badWorkerIndex.load() == 0);
+
+					// an empty group is done right away
+					app::TaskGroup empty;
+					jobSystem.Wait(empty);
+					CHECK(empty.IsDone());
+				}
+
+				return true;
+			} });
+
+		cases.push_back({ "JobSystem.ScratchBuffer", []()
+			{
+				app::ScratchBuffer scratch;
+
+				// aligned, distinct, and the same memory again after a reset
+				int* first = scratch.AllocArray< int >(10);
+				double* second = scratch.AllocArray< double >(3);
+				void* aligned = scratch.Alloc(24, 64);
+				CHECK(((size_t)second % alignof(double)) == 0);
+				CHECK(((size_t)aligned % 64) == 0);
+				CHECK((void*)(first + 10) <= (void*)second);
+
+				// bigger than a block gets its own
+				unsigned char* big = scratch.AllocArray< unsigned char >(256 * 1024);
+				memset(big, 1, 256 * 1024);
+
+				scratch.Reset();
+				CHECK(scratch.AllocArray< int >(10) == first);
+
+				// one kept array per element type
+				std::vector< int >& ints = scratch.GetArray< int >();
+				ints.assign(100, 7);
+				std::vector< float >& floats = scratch.GetArray< float >();
+				floats.assign(3, 1.0f);
+
+				CHECK(&scratch.GetArray< int >() == &ints);
+				CHECK(scratch.GetArray< int >().size() == 100);
+				CHECK(scratch.GetArray< float >().size() == 3);
+
+				scratch.Reset();
+				CHECK(scratch.GetArray< int >().size() == 100);
+				return true;
+			} });
+	}
+
+	static void AddTripleBufferCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "TripleBuffer.WaitAcquire", []()
+			{
+				app::TripleBuffer< int > buffer;
+
+				// nothing published, the wait times out and the consumer keeps its slot
+				buffer.GetReadBuffer() = -1;
+				CHECK(!buffer.WaitAcquire(0.001));
+				CHECK(buffer.GetReadBuffer() == -1);
+
+				// the consumer sleeps until the producer publishes, every frame is seen in order or skipped, never twice
+				const int NUM_FRAMES = 200;
+				std::thread producer([&]()
+					{
+						for (int i = 0; i < NUM_FRAMES; ++i)
+						{
+							buffer.GetWriteBuffer() = i;
+							buffer.Publish();
+						}
+					});
+
+				int last = -1;
+				while (last != NUM_FRAMES - 1)
+				{
+					if (!buffer.WaitAcquire(1.0))
+						break;
+
+					const int value = buffer.GetReadBuffer();
+					if (value <= last)
+						break;
+
+					last = value;
+				}
+
+				producer.join();
+				CHECK(last == NUM_FRAMES - 1);
+				CHECK(!buffer.WaitAcquire(0.0));
+				return true;
+			} });
+	}
+
+	namespace helper
+	{
+		/// body pair at given offset of B from A, the pair is (2k, 2k+1)
+		static void AddOverlapPair(test::BodyStore& store, const int typeA, const float sizeA, const int typeB, const float sizeB, const float dx, const float dy)
+		{
+			const float x = 800.0f;
+			const float y = 450.0f;
+			store.Add(typeA, sizeA, 0xFFFFFFFF, x, y, 0.0f, 0.0f);
+			store.Add(typeB, sizeB, 0xFFFFFFFF, x + dx, y + dy, 0.0f, 0.0f);
+		}
+
+		/// scalar decision of the full overlap test, the reference of the batches
+		static bool TestOverlapScalar(const test::BodyStore& store, const int a, const int b)
+		{
+			const auto* geometry = store.m_shapes.GetGeometry();
+			const auto& shapeA = geometry[store.m_shape[a]];
+			const auto& shapeB = geometry[store.m_shape[b]];
+			return test::shape::TestOverlap(shapeA.m_type, shapeA.m_size, store.m_x[a], store.m_y[a], shapeB.m_type, shapeB.m_size, store.m_x[b], store.m_y[b]);
+		}
+	}
+
+	static void AddNarrowphaseCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "Narrowphase.BatchMatchesScalar", []()
+			{
+				test::BodyStore store;
+				const app::Random random(11);
+				uint64_t counter = 0;
+
+				const float sizes[] = { test::MinSize, 9.0f, test::MaxSize };
+				for (int typeA = 0; typeA < test::shape::NUM_TYPES; ++typeA)
+				{
+					for (int typeB = 0; typeB < test::shape::NUM_TYPES; ++typeB)
+					{
+						for (const float sizeA : sizes)
+						{
+							for (const float sizeB : sizes)
+							{
+								// coincident centers and a hair apart
+								helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, 0.0f, 0.0f);
+								helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, 1e-6f, -1e-6f);
+
+								const int numBodies = store.GetNumBodies();
+								const float reach = test::shape::GetOverlapReach(
+									store.m_shapes.GetGeometry()[store.m_shape[numBodies - 2]].m_bound,
+									store.m_shapes.GetGeometry()[store.m_shape[numBodies - 1]].m_bound);
+
+								for (int i = 0; i < 24; ++i)
+								{
+									const float angle = 6.2831853f * random.GetFloat(counter++);
+									const float dirX = cosf(angle);
+									const float dirY = sinf(angle);
+
+									// around the bounding circle reject
+									const float nearBound = reach * (0.97f + 0.06f * random.GetFloat(counter++));
+									helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, dirX * nearBound, dirY * nearBound);
+									helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, dirX * reach, dirY * reach);
+
+									// anywhere inside the reach
+									const float inside = reach * random.GetFloat(counter++);
+									helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, dirX * inside, dirY * inside);
+
+									// touching, find where the scalar decision flips along the direction and sample a few ulps around it
+									float low = 0.0f;
+									float high = reach;
+									for (int step = 0; step < 40; ++step)
+									{
+										const float mid = 0.5f * (low + high);
+										helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, dirX * mid, dirY * mid);
+										const int last = store.GetNumBodies() - 2;
+										const bool overlaps = helper::TestOverlapScalar(store, last, last + 1);
+										store.Truncate(last);
+
+										(overlaps ? low : high) = mid;
+									}
+
+									float distance = low;
+									for (int ulp = 0; ulp < 6; ++ulp)
+									{
+										helper::AddOverlapPair(store, typeA, sizeA, typeB, sizeB, dirX * distance, dirY * distance);
+										distance = nextafterf(distance, 2.0f * reach);
+									}
+								}
+							}
+						}
+					}
+				}
+
+				const int numPairs = store.GetNumBodies() / 2;
+				std::vector< test::OverlapPair > pairs(numPairs);
+				std::vector< char > expected(numPairs);
+				int numOverlaps = 0;
+				for (int i = 0; i < numPairs; ++i)
+				{
+					pairs[i].m_a = 2 * i;
+					pairs[i].m_b = 2 * i + 1;
+					expected[i] = helper::TestOverlapScalar(store, 2 * i, 2 * i + 1) ? 1 : 0;
+					numOverlaps += expected[i];
+				}
+
+				// the set has to exercise both decisions
+				CHECK(numOverlaps > numPairs / 10);
+				CHECK(numOverlaps < numPairs * 9 / 10);
+
+				test::ShapeArrays shapes;
+				shapes.m_shape = store.m_shape.data();
+				shapes.m_geometry = store.m_shapes.GetGeometry();
+				shapes.m_x = store.m_x.data();
+				shapes.m_y = store.m_y.data();
+
+				// every level the CPU supports, each one against the scalar test
+				const test::SimdLevel supported = test::kernels::GetSupportedLevel();
+				const test::SimdLevel previous = test::kernels::GetLevel();
+				bool matches = true;
+				for (int level = (int)test::SimdLevel::Scalar; level <= (int)supported && matches; ++level)
+				{
+					test::kernels::SetLevel((test::SimdLevel)level);
+
+					// everything at once
+					std::unique_ptr< bool[] > overlaps(new bool[numPairs]);
+					test::shape::TestOverlapBatch(shapes, pairs.data(), numPairs, overlaps.get());
+					for (int i = 0; i < numPairs; ++i)
+						if (overlaps[i] != (expected[i] != 0))
+						{
+							fprintf(stderr, "%s: pair %d differs\n", test::kernels::GetLevelName((test::SimdLevel)level), i);
+							matches = false;
+						}
+
+					// partial batches, the padding lanes must not leak into the results
+					for (int count = 1; count <= 2 * test::shape::GetOverlapBatchWidth() + 1; ++count)
+					{
+						for (int first = 0; first + count <= numPairs; first += 97)
+						{
+							test::shape::TestOverlapBatch(shapes, pairs.data() + first, count, overlaps.get());
+							for (int i = 0; i < count; ++i)
+								matches &= (overlaps[i] == (expected[first + i] != 0));
+						}
+					}
+				}
+
+				test::kernels::SetLevel(previous);
+				CHECK(matches);
+				return true;
+			} });
+	}
+
+	namespace helper
+	{
+		/// batches ForEachStreamBatch produces, as (first, count) pairs
+		static std::vector< std::pair< int, int > > GetStreamBatches(const int numElements, const int maxBatch, const int granularity)
+		{
+			std::vector< std::pair< int, int > > batches;
+			app::ForEachStreamBatch(numElements, maxBatch, granularity, [&](const int first, const int count)
+				{
+					batches.push_back(std::make_pair(first, count));
+				});
+
+			return batches;
+		}
+	}
+
+	static void AddStreamCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "Stream.ForEachStreamBatch", []()
+			{
+				// exact multiple
+				auto batches = helper::GetStreamBatches(300, 100, 1);
+				CHECK(batches.size() == 3);
+				CHECK(batches[0] == std::make_pair(0, 100));
+				CHECK(batches[1] == std::make_pair(100, 100));
+				CHECK(batches[2] == std::make_pair(200, 100));
+
+				// remainder in a shorter last batch
+				batches = helper::GetStreamBatches(250, 100, 1);
+				CHECK(batches.size() == 3);
+				CHECK(batches[2] == std::make_pair(200, 50));
+
+				// everything fits one batch
+				batches = helper::GetStreamBatches(40, 100, 1);
+				CHECK(batches.size() == 1);
+				CHECK(batches[0] == std::make_pair(0, 40));
+
+				// the batch is rounded down to whole lines, a line is never split
+				batches = helper::GetStreamBatches(14, 5, 2);
+				CHECK(batches.size() == 4);
+				CHECK(batches[0] == std::make_pair(0, 4));
+				CHECK(batches[3] == std::make_pair(12, 2));
+
+				// nothing to do, or a batch smaller than one primitive
+				CHECK(helper::GetStreamBatches(0, 100, 1).empty());
+				CHECK(helper::GetStreamBatches(10, 1, 2).empty());
+				return true;
+			} });
+
+		cases.push_back({ "Stream.StreamRing", []()
+			{
+				app::StreamRing ring(100);
+				CHECK(ring.GetCapacity() == 100);
+
+				// front to back
+				CHECK(ring.Allocate(30) == 0);
+				CHECK(ring.Allocate(30) == 30);
+				CHECK(ring.Allocate(40) == 60);
+
+				// full, the next range wraps around
+				CHECK(ring.Allocate(10) == 0);
+
+				// a range that does not fit the rest starts over instead of being split
+				CHECK(ring.Allocate(80) == 10);
+				CHECK(ring.Allocate(20) == 0);
+
+				// larger than the ring, the failed allocations leave the ring as it was
+				CHECK(ring.Allocate(101) == -1);
+				CHECK(ring.Allocate(-1) == -1);
+				CHECK(ring.Allocate(10) == 20);
+
+				// the whole ring
+				CHECK(ring.Allocate(100) == 0);
+
+				ring.Reset();
+				CHECK(ring.Allocate(5) == 0);
+
+				// no capacity, nothing fits
+				app::StreamRing empty;
+				CHECK(empty.Allocate(1) == -1);
+				CHECK(empty.Allocate(0) == 0);
+				return true;
+			} });
+	}
+
+	namespace helper
+	{
+		/// quads of the string laid out glyph by glyph from the font, the reference of the batcher
+		static void LayoutString(const app::RenderFrame& frame, const app::RenderString& str, std::vector< app::GlyphQuad >& outQuads)
+		{
+			const app::Font& font = app::Font::GetInstance();
+			const char* text = frame.GetText(str);
+
+			int x = str.x;
+			for (int i = 0; i < str.textLength; ++i)
+			{
+				const auto& glyph = font.GetGlyph((unsigned char)text[i]);
+				if (glyph.xAdvance && text[i] > ' ')
+				{
+					app::GlyphQuad quad;
+					quad.x = x + glyph.xOffset;
+					quad.y = str.y + glyph.yOffset;
+					quad.width = glyph.width;
+					quad.height = glyph.height;
+					quad.srcX = glyph.x;
+					quad.srcY = glyph.y;
+					quad.color = str.color;
+					outQuads.push_back(quad);
+				}
+
+				x += glyph.xAdvance;
+			}
+		}
+
+		static bool QuadsMatch(const std::vector< app::GlyphQuad >& quads, const app::RenderFrame& frame)
+		{
+			std::vector< app::GlyphQuad > expected;
+			for (const auto& str : frame.GetStrings())
+				LayoutString(frame, str, expected);
+
+			if (quads.size() != expected.size())
+				return false;
+
+			for (size_t i = 0; i < quads.size(); ++i)
+			{
+				const auto& a = quads[i];
+				const auto& b = expected[i];
+				if (a.x != b.x || a.y != b.y || a.width != b.width || a.height != b.height || a.srcX != b.srcX || a.srcY != b.srcY || a.color != b.color)
+					return false;
+			}
+
+			return true;
+		}
+
+		/// every text lands in the same cache entry
+		static uint64_t CollidingHash(const char*, const int)
+		{
+			return 42;
+		}
+	}
+
+	static void AddTextCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "Text.BuildOrderAndOffsets", []()
+			{
+				CHECK(app::Font::GetInstance().IsValid());
+
+				app::RenderFrame frame;
+				frame.AddString(10, 20, 0xFF112233, "Bodies: %d", 3000);
+				frame.AddString(300, 5, 0xFF445566, "help line");
+				frame.AddString(-4, 700, 0xFF778899, "Bodies: %d", 3000); // same text, other place and color
+				frame.AddString(50, 50, 0xFFFFFFFF, ""); // no quads
+
+				app::TextBatcher batcher;
+				batcher.Build(frame);
+
+				CHECK(batcher.GetStats().m_numStrings == 4);
+				CHECK(batcher.GetStats().m_numGlyphs == (int)batcher.GetQuads().size());
+				CHECK(batcher.GetQuads().size() > 0);
+				CHECK(helper::QuadsMatch(batcher.GetQuads(), frame));
+				return true;
+			} });
+
+		cases.push_back({ "Text.CacheHitMatchesLayout", []()
+			{
+				app::RenderFrame frame;
+				for (int i = 0; i < 10; ++i)
+					frame.AddString(5 * i, 17 * i, 0xFF000000 + i, "label %d", i % 3);
+
+				app::TextBatcher cached;
+				cached.Build(frame);
+				cached.Build(frame);
+
+				// everything but the first build of each text comes from the cache
+				CHECK(cached.GetStats().m_numCacheHits == 10);
+				CHECK(cached.GetStats().m_numCachedLayouts == 3);
+
+				app::TextBatcher fresh;
+				fresh.Build(frame);
+				CHECK(fresh.GetQuads().size() == cached.GetQuads().size());
+				CHECK(0 == memcmp(fresh.GetQuads().data(), cached.GetQuads().data(), sizeof(app::GlyphQuad) * fresh.GetQuads().size()));
+				CHECK(helper::QuadsMatch(cached.GetQuads(), frame));
+				return true;
+			} });
+
+		cases.push_back({ "Text.HashCollisionRelayout", []()
+			{
+				app::TextBatcher batcher(256, &helper::CollidingHash);
+
+				app::RenderFrame first;
+				first.AddString(10, 10, 0xFFFFFFFF, "first text");
+				batcher.Build(first);
+				CHECK(helper::QuadsMatch(batcher.GetQuads(), first));
+
+				// different text under the same key is not taken from the cache
+				app::RenderFrame second;
+				second.AddString(10, 10, 0xFFFFFFFF, "other");
+				batcher.Build(second);
+				CHECK(batcher.GetStats().m_numCacheHits == 0);
+				CHECK(helper::QuadsMatch(batcher.GetQuads(), second));
+
+				// also within one frame, the texts take turns in the entry
+				app::RenderFrame mixed;
+				mixed.AddString(0, 0, 0xFFFFFFFF, "other");
+				mixed.AddString(0, 20, 0xFFFFFFFF, "first text");
+				mixed.AddString(0, 40, 0xFFFFFFFF, "other");
+				batcher.Build(mixed);
+				CHECK(batcher.GetStats().m_numCacheHits == 1);
+				CHECK(batcher.GetStats().m_numCachedLayouts == 1);
+				CHECK(helper::QuadsMatch(batcher.GetQuads(), mixed));
+				return true;
+			} });
+
+		cases.push_back({ "Text.TrimCache", []()
+			{
+				app::TextBatcher batcher(2);
+
+				// over the limit, but all of them were used by the last build
+				app::RenderFrame abc;
+				abc.AddString(0, 0, 0xFFFFFFFF, "a");
+				abc.AddString(0, 0, 0xFFFFFFFF, "b");
+				abc.AddString(0, 0, 0xFFFFFFFF, "c");
+				batcher.Build(abc);
+				CHECK(batcher.GetStats().m_numCachedLayouts == 3);
+
+				// b and c were not used, they go
+				app::RenderFrame ad;
+				ad.AddString(0, 0, 0xFFFFFFFF, "a");
+				ad.AddString(0, 0, 0xFFFFFFFF, "d");
+				batcher.Build(ad);
+				CHECK(batcher.GetStats().m_numCacheHits == 1);
+				CHECK(batcher.GetStats().m_numCachedLayouts == 2);
+
+				app::RenderFrame ab;
+				ab.AddString(0, 0, 0xFFFFFFFF, "a");
+				ab.AddString(0, 0, 0xFFFFFFFF, "b");
+				batcher.Build(ab);
+				CHECK(batcher.GetStats().m_numCacheHits == 1); // b was laid out again
+				CHECK(batcher.GetStats().m_numCachedLayouts == 2); // d is gone now
+
+				// under the limit nothing is dropped
+				app::TextBatcher large(8);
+				large.Build(abc);
+				large.Build(ad);
+				large.Build(abc);
+				CHECK(large.GetStats().m_numCacheHits == 3);
+				CHECK(large.GetStats().m_numCachedLayouts == 4);
+				return true;
+			} });
+
+		cases.push_back({ "Text.AddStringArena", []()
+			{
+				const int maxLength = app::RenderFrame::MAX_STRING_LENGTH;
+				const std::string longText(3 * maxLength, 'x');
+
+				// the arena grows many times, earlier strings have to stay readable at their offsets
+				app::RenderFrame frame;
+				std::vector< std::string > expected;
+				for (int i = 0; i < 200; ++i)
+				{
+					if (i % 50 == 7)
+					{
+						frame.AddString(0, i, 0xFFFFFFFF, "%s", longText.c_str());
+						expected.push_back(longText.substr(0, maxLength));
+					}
+					else
+					{
+						frame.AddString(0, i, 0xFFFFFFFF, "string %d %s", i, longText.c_str() + longText.size() - (size_t)(i * 5));
+						expected.push_back(std::string("string ") + std::to_string(i) + " " + std::string((size_t)(i * 5), 'x'));
+						if ((int)expected.back().size() > maxLength)
+							expected.back().resize(maxLength);
+					}
+				}
+
+				const auto& strings = frame.GetStrings();
+				CHECK(strings.size() == expected.size());
+				for (size_t i = 0; i < strings.size(); ++i)
+				{
+					const char* text = frame.GetText(strings[i]);
+					CHECK(strings[i].textLength == (int)expected[i].size());
+					CHECK(0 == memcmp(text, expected[i].data(), expected[i].size()));
+					CHECK(text[strings[i].textLength] == 0);
+				}
+
+				// reset frames start the arena over
+				frame.Reset();
+				frame.AddString(0, 0, 0xFFFFFFFF, "again");
+				CHECK(frame.GetStrings().size() == 1);
+				CHECK(frame.GetStrings()[0].textOffset == 0);
+				CHECK(0 == strcmp(frame.GetText(frame.GetStrings()[0]), "again"));
+				return true;
+			} });
+	}
+
+	static void AddRenderCases(std::vector< Case >& cases)
+	{
+		cases.push_back({ "Render.InstancesMatchEdges", []()
+			{
+				// the same shapes drawn as lines (the old path) and as outline instances
+				app::RenderFrame lines;
+				app::RenderFrame instances;
+
+				const app::Random random(7);
+				const int NUM_SHAPES = 3000;
+				for (int i = 0; i < NUM_SHAPES; ++i)
+				{
+					const int type = i % test::shape::NUM_TYPES;
+					const float size = test::MinSize + (test::MaxSize - test::MinSize) * random.GetFloat(3 * i);
+					const float x = 1700.0f * random.GetFloat(3 * i + 1) - 50.0f;
+					const float y = 1000.0f * random.GetFloat(3 * i + 2) - 50.0f;
+					const app::TColor color = (app::TColor)random.GetBits(i);
+
+					lines.SetColor(color);
+					test::shape::RenderEdges(type, size, x, y, lines);
+
+					instances.SetColor(color);
+					test::shape::Render(type, size, x, y, instances);
+				}
+
+				const auto& rendered = instances.GetInstances();
+				CHECK((int)rendered.size() == NUM_SHAPES);
+
+				std::vector< app::RenderVertex > expanded(app::CountRenderInstanceVertices(rendered.data(), (int)rendered.size()));
+				const int numExpanded = app::ExpandRenderInstances(rendered.data(), (int)rendered.size(), expanded.data());
+				CHECK(numExpanded == (int)expanded.size());
+				CHECK(numExpanded == lines.GetNumVertices());
+
+				// byte for byte, the vertices of the chunks follow each other
+				int offset = 0;
+				for (int chunk = 0; chunk < lines.GetNumUsedChunks(); ++chunk)
+				{
+					int numVertices = 0;
+					const app::RenderVertex* vertices = lines.GetChunk(chunk, numVertices);
+					CHECK(0 == memcmp(vertices, expanded.data() + offset, sizeof(app::RenderVertex) * numVertices));
+					offset += numVertices;
+				}
+
+				CHECK(offset == numExpanded);
+				return true;
+			} });
+
+		cases.push_back({ "Render.SoftwareWorkersMatch", []()
+			{
+				// instances, lines crossing tiles, lines off the screen or with NaN and strings
+				app::RenderFrame frame;
+
+				const app::Random random(13);
+				for (int i = 0; i < 2000; ++i)
+				{
+					const float size = test::MinSize + (test::MaxSize - test::MinSize) * random.GetFloat(3 * i);
+					frame.SetColor((app::TColor)random.GetBits(i));
+					test::shape::Render(i % test::shape::NUM_TYPES, size, 1700.0f * random.GetFloat(3 * i + 1) - 50.0f, 1000.0f * random.GetFloat(3 * i + 2) - 50.0f, frame);
+				}
+
+				for (int i = 0; i < 500; ++i)
+				{
+					const uint64_t first = 10000 + 4 * i;
+					frame.SetColor((app::TColor)random.GetBits(first));
+					frame.AddLine(1800.0f * random.GetFloat(first) - 100.0f, 1100.0f * random.GetFloat(first + 1) - 100.0f,
+						1800.0f * random.GetFloat(first + 2) - 100.0f, 1100.0f * random.GetFloat(first + 3) - 100.0f);
+				}
+
+				const float nan = std::numeric_limits< float >::quiet_NaN();
+				frame.AddLine(-500.0f, -500.0f, -100.0f, -300.0f);
+				frame.AddLine(5000.0f, 100.0f, 6000.0f, 200.0f);
+				frame.AddLine(nan, 100.0f, 300.0f, 200.0f);
+				frame.AddLine(100.0f, 100.0f, 300.0f, nan);
+				frame.AddLine(-1e30f, 200.0f, 1e30f, 210.0f);
+
+				for (int i = 0; i < 20; ++i)
+					frame.AddString(40 * i, 30 * i, 0xFF00FF00 + i, "string %d crossing the tiles", i);
+
+				app::SoftwareRenderer inlineRenderer;
+				inlineRenderer.Render(frame);
+
+				app::JobSystem jobSystem(4);
+				app::SoftwareRenderer parallelRenderer;
+				parallelRenderer.Render(frame, &jobSystem);
+
+				CHECK(inlineRenderer.GetStats().m_numLines == parallelRenderer.GetStats().m_numLines);
+				CHECK(inlineRenderer.GetChecksum() == parallelRenderer.GetChecksum());
+
+				// drawing the frame again reuses the buffers and has to give the same pixels
+				parallelRenderer.Render(frame, &jobSystem);
+				CHECK(inlineRenderer.GetChecksum() == parallelRenderer.GetChecksum());
+				return true;
+			} });
+
+		cases.push_back({ "Render.SoftwareKnownPixels", []()
+			{
+				// pixels with their center in [start, end) along the major axis, the minor axis is floored
+				app::RenderFrame frame;
+				frame.SetColor(0x000000FF);
+				frame.AddLine(10.0f, 100.25f, 150.0f, 100.25f); // crosses two tile borders
+				frame.SetColor(0x0000FF00);
+				frame.AddLine(200.5f, 80.0f, 200.5f, 20.0f); // drawn from the bottom
+
+				app::SoftwareRenderer renderer(256, 128);
+				renderer.Render(frame);
+
+				const uint32_t* pixels = renderer.GetPixels();
+				const int pitch = renderer.GetWidth();
+				const uint32_t clear = pixels[0];
+
+				for (int x = 0; x < renderer.GetWidth(); ++x)
+				{
+					const uint32_t expected = (x >= 10 && x < 150) ? 0xFF0000FF : clear;
+					CHECK(pixels[100 * pitch + x] == expected);
+					CHECK(pixels[99 * pitch + x] == clear);
+					CHECK(pixels[101 * pitch + x] == clear);
+				}
+
+				for (int y = 0; y < renderer.GetHeight(); ++y)
+				{
+					const uint32_t expected = (y >= 20 && y < 80) ? 0xFF00FF00 : clear;
+					CHECK(pixels[y * pitch + 200] == expected);
+					CHECK(pixels[y * pitch + 199] == clear);
+					CHECK(pixels[y * pitch + 201] == clear);
+				}
+
+				return true;
+			} });
+	}
+
+} // tests
+
+int main(int argc, char** argv)
+{
+	std::vector< tests::Case > cases;
+	tests::AddJobSystemCases(cases);
+	tests::AddTripleBufferCases(cases);
+	tests::AddNarrowphaseCases(cases);
+	tests::AddStreamCases(cases);
+	tests::AddTextCases(cases);
+	tests::AddRenderCases(cases);
+
+	// no arguments: list the cases, otherwise run the named ones
+	if (argc < 2)
+	{
+		for (const auto& testCase : cases)
+			printf("%s\n", testCase.m_name.c_str());
+		return 0;
+	}
+
+	int numFailed = 0;
+	for (int i = 1; i < argc; ++i)
+	{
+		const tests::Case* found = nullptr;
+		for (const auto& testCase : cases)
+			if (testCase.m_name == argv[i])
+				found = &testCase;
+
+		if (!found)
+		{
+			fprintf(stderr, "Unknown test '%s'\n", argv[i]);
+			numFailed += 1;
+			continue;
+		}
+
+		const bool passed = found->m_run();
+		printf("%s: %s\n", found->m_name.c_str(), passed ? "passed" : "FAILED");
+		numFailed += passed ? 0 : 1;
+	}
+
+	return numFailed ? 1 : 0;
+}